@@ -0,0 +1,221 @@
+#include "arch/i386/cpu/fpu.h"
+#include "arch/i386/cpu/smp.h"
+#include "arch/i386/cpu/sse.h"
+#include "arch/i386/memory/paging.h"
+#include "lib/std/memory.h"
+#include "proc/process.h"
+
+namespace arch {
+namespace cpu {
+
+namespace {
+
+using arch::memory::switch_page_directory;
+using lib::std::kfree;
+using lib::std::kmalloc_aligned;
+using lib::std::memcpy;
+using lib::std::memset;
+
+constexpr uint32_t CR0_MONITOR = 0x2;
+constexpr uint32_t CR0_EMULATE = 0x4;
+constexpr uint32_t CR0_TASK_SWITCHED = 0x8;
+
+constexpr uint32_t FNSAVE_SIZE = 108;
+
+// XSAVE areas need the most alignment
+constexpr uint32_t FPU_STATE_ALIGNMENT = 64;
+
+// Which components XRSTOR should load from an XSAVE area rather than reset
+constexpr uint32_t XSTATE_BV_OFFSET = 0x200;
+constexpr uint64_t LEGACY_COMPONENTS = 0x3;
+
+constexpr uint32_t DEFAULT_MXCSR = 0x1F80;
+
+uint32_t fpu_state_size;
+char *initial_fpu_state;
+
+// Whose registers each CPU's FPU holds, or nullptr
+struct process *fpu_owners[MAX_CPUS];
+
+uint32_t read_cr0(void) {
+  uint32_t cr0;
+  asm volatile("mov %%cr0, %0" : "=r"(cr0));
+  return cr0;
+}
+
+void write_cr0(uint32_t cr0) { asm volatile("mov %0, %%cr0" : : "r"(cr0)); }
+
+char is_task_switched(void) { return (read_cr0() & CR0_TASK_SWITCHED) != 0; }
+
+void set_task_switched(void) { write_cr0(read_cr0() | CR0_TASK_SWITCHED); }
+
+void save_fpu(char *state) {
+  if (is_xsaveopt_enabled) {
+    asm volatile("xsaveopt (%0)"
+                 :
+                 : "r"(state), "a"(0xFFFFFFFF), "d"(0xFFFFFFFF)
+                 : "memory");
+  } else if (is_xsave_enabled) {
+    asm volatile("xsave (%0)"
+                 :
+                 : "r"(state), "a"(0xFFFFFFFF), "d"(0xFFFFFFFF)
+                 : "memory");
+  } else if (is_sse_enabled) {
+    asm volatile("fxsave (%0)" : : "r"(state) : "memory");
+  } else {
+    // fnsave resets the FPU afterwards, but the registers should stay loaded
+    asm volatile("fnsave (%0)\n"
+                 "frstor (%0)"
+                 :
+                 : "r"(state)
+                 : "memory");
+  }
+}
+
+void restore_fpu(char *state) {
+  if (is_xsave_enabled) {
+    asm volatile("xrstor (%0)"
+                 :
+                 : "r"(state), "a"(0xFFFFFFFF), "d"(0xFFFFFFFF)
+                 : "memory");
+  } else if (is_sse_enabled) {
+    asm volatile("fxrstor (%0)" : : "r"(state) : "memory");
+  } else {
+    asm volatile("frstor (%0)" : : "r"(state) : "memory");
+  }
+}
+
+char *allocate_fpu_state(void) {
+  char *state = (char *)kmalloc_aligned(fpu_state_size, FPU_STATE_ALIGNMENT);
+  memcpy(initial_fpu_state, state, fpu_state_size);
+  return state;
+}
+
+// Brings the saved state up to date if it's live in this CPU's registers and
+// may have changed
+void flush_fpu_state(struct process *proc) {
+  if (fpu_owners[get_cpu_id()] == proc && !is_task_switched()) {
+    save_fpu(proc->fpu_state);
+  }
+}
+
+} // namespace
+
+void init_fpu(char is_bootstrap) {
+  // Run FPU instructions rather than trap to emulate them, and have WAIT
+  // respect CR0.TS too
+  write_cr0((read_cr0() & ~CR0_EMULATE) | CR0_MONITOR);
+
+  if (is_bootstrap) {
+    if (is_xsave_enabled) {
+      fpu_state_size = get_xsave_size();
+    } else if (is_sse_enabled) {
+      fpu_state_size = LEGACY_FPU_STATE_SIZE;
+    } else {
+      fpu_state_size = FNSAVE_SIZE;
+    }
+
+    initial_fpu_state =
+        (char *)kmalloc_aligned(fpu_state_size, FPU_STATE_ALIGNMENT);
+    memset(initial_fpu_state, fpu_state_size, 0);
+
+    asm volatile("clts\n"
+                 "fninit");
+    if (is_sse_enabled) {
+      uint32_t mxcsr = DEFAULT_MXCSR;
+      asm volatile("ldmxcsr %0" : : "m"(mxcsr));
+    }
+    save_fpu(initial_fpu_state);
+  }
+
+  set_task_switched();
+}
+
+void init_fpu_state(struct process *proc) {
+  proc->fpu_state = nullptr;
+  proc->fpu_cpu = MAX_CPUS;
+}
+
+void copy_fpu_state(struct process *from, struct process *to) {
+  init_fpu_state(to);
+  if (from->fpu_state) {
+    flush_fpu_state(from);
+    to->fpu_state = allocate_fpu_state();
+    memcpy(from->fpu_state, to->fpu_state, fpu_state_size);
+  }
+}
+
+void free_fpu_state(struct process *proc) {
+  for (uint32_t i = 0; i < MAX_CPUS; i++) {
+    if (fpu_owners[i] == proc) {
+      fpu_owners[i] = nullptr;
+    }
+  }
+  if (proc->fpu_state) {
+    kfree(proc->fpu_state);
+  }
+}
+
+void switch_fpu(struct process *proc) {
+  uint32_t cpu_id = get_cpu_id();
+  if (fpu_owners[cpu_id] == proc && proc->fpu_cpu == cpu_id) {
+    // Nothing else has used the FPU since this process did
+    asm volatile("clts");
+  } else if (!is_task_switched()) {
+    set_task_switched();
+  }
+}
+
+void release_fpu(void) {
+  if (is_task_switched()) {
+    return;
+  }
+
+  // The save area might not be mapped in the process's page tables
+  struct process *owner = fpu_owners[get_cpu_id()];
+  if (owner) {
+    switch_page_directory(base_page_directory);
+    save_fpu(owner->fpu_state);
+  }
+  set_task_switched();
+}
+
+void handle_fpu_trap(void) {
+  uint32_t cpu_id = get_cpu_id();
+  struct process *current_process = proc::get_currently_executing_process();
+
+  switch_page_directory(base_page_directory);
+  asm volatile("clts");
+
+  // Whatever was loaded was saved when its process was switched out
+  if (!current_process->fpu_state) {
+    current_process->fpu_state = allocate_fpu_state();
+  }
+  restore_fpu(current_process->fpu_state);
+  fpu_owners[cpu_id] = current_process;
+  current_process->fpu_cpu = cpu_id;
+
+  switch_page_directory(current_process->page_dir);
+}
+
+void get_legacy_fpu_state(struct process *proc, char *dest) {
+  if (proc->fpu_state) {
+    flush_fpu_state(proc);
+    memcpy(proc->fpu_state, dest, LEGACY_FPU_STATE_SIZE);
+  } else {
+    memcpy(initial_fpu_state, dest, LEGACY_FPU_STATE_SIZE);
+  }
+}
+
+void set_legacy_fpu_state(struct process *proc, char *src) {
+  if (!proc->fpu_state) {
+    proc->fpu_state = allocate_fpu_state();
+  }
+  memcpy(src, proc->fpu_state, LEGACY_FPU_STATE_SIZE);
+  if (is_xsave_enabled) {
+    *(uint64_t *)(proc->fpu_state + XSTATE_BV_OFFSET) |= LEGACY_COMPONENTS;
+  }
+}
+
+} // namespace cpu
+} // namespace arch
@@ -0,0 +1,55 @@
+#ifndef ARCH_I386_CPU_FPU_H
+#define ARCH_I386_CPU_FPU_H
+
+#include <stdint.h>
+
+#include "proc/process.h"
+
+namespace arch {
+namespace cpu {
+
+namespace {
+
+using proc::process;
+
+} // namespace
+
+// The FXSAVE layout of the x87 and SSE registers, which XSAVE starts with too
+constexpr uint32_t LEGACY_FPU_STATE_SIZE = 0x200;
+
+// FPU, SSE and AVX registers are switched lazily. Each CPU keeps the last
+// process's registers loaded and sets CR0.TS whenever it runs a process whose
+// registers aren't, so its first FPU instruction traps and loads them.
+// Processes that never touch the FPU never pay for saving or loading it.
+//
+// Gets this CPU's FPU ready to trap. The bootstrap CPU also works out how big
+// the save areas are and saves the clean state new processes start with.
+void init_fpu(char is_bootstrap);
+
+// Gives a newly created process a clean FPU
+void init_fpu_state(struct process *proc);
+
+// Gives a forked process a copy of its parent's FPU state
+void copy_fpu_state(struct process *from, struct process *to);
+
+void free_fpu_state(struct process *proc);
+
+// Called by the scheduler before it runs a process on this CPU
+void switch_fpu(struct process *proc);
+
+// Called by the scheduler when this CPU stops running its process. Saves the
+// process's FPU state if it was used, since it could run on another CPU next.
+void release_fpu(void);
+
+// Loads the running process's FPU state, for the device not available trap
+void handle_fpu_trap(void);
+
+// Copies out the part of a process's FPU state that FXSAVE would have saved,
+// or sets it, for snapshots. Only makes sense when SSE is enabled.
+void get_legacy_fpu_state(struct process *proc, char *dest);
+void set_legacy_fpu_state(struct process *proc, char *src);
+
+} // namespace cpu
+} // namespace arch
+
+#endif
@@ -25,5 +25,27 @@ void set_msr(uint32_t msr, struct cpu_msr value) {
                : "m"(msr), "m"(value.low), "m"(value.high));
 }
 
+uint64_t read_tsc(void) {
+  uint32_t low, high;
+  asm volatile("rdtsc" : "=a"(low), "=d"(high));
+  return ((uint64_t)high << 32) | low;
+}
+
+char has_sysenter(void) {
+  uint32_t features;
+  asm volatile("mov $0x1, %%eax\n"
+               "cpuid"
+               : "=d"(features)
+               :
+               : "eax", "ebx", "ecx");
+  return (features >> 11) & 0x1;
+}
+
+void setup_sysenter(uint32_t code_selector, uint32_t stack, uint32_t entry) {
+  set_msr(SYSENTER_CS_MSR, {code_selector, 0});
+  set_msr(SYSENTER_ESP_MSR, {stack, 0});
+  set_msr(SYSENTER_EIP_MSR, {entry, 0});
+}
+
 } // namespace cpu
 } // namespace arch
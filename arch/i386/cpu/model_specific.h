@@ -8,6 +8,11 @@ namespace cpu {
 
 constexpr uint32_t APIC_BASE_MSR = 0x1B;
 
+// Where SYSENTER takes the kernel's code selector, stack and entry point from
+constexpr uint32_t SYSENTER_CS_MSR = 0x174;
+constexpr uint32_t SYSENTER_ESP_MSR = 0x175;
+constexpr uint32_t SYSENTER_EIP_MSR = 0x176;
+
 struct cpu_msr {
   uint32_t low;
   uint32_t high;
@@ -17,6 +22,17 @@ struct cpu_msr get_msr(uint32_t msr);
 
 void set_msr(uint32_t msr, struct cpu_msr value);
 
+// Returns the time stamp counter, which counts CPU cycles since reset
+uint64_t read_tsc(void);
+
+// Returns 1 if the CPU has SYSENTER and SYSEXIT
+char has_sysenter(void);
+
+// Makes SYSENTER on this CPU jump to entry with esp set to stack. SYSEXIT
+// returns to the user selectors, which have to follow code_selector in the
+// GDT: kernel code, kernel data, user code and then user data.
+void setup_sysenter(uint32_t code_selector, uint32_t stack, uint32_t entry);
+
 } // namespace cpu
 } // namespace arch
 
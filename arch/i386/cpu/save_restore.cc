@@ -1,16 +1,17 @@
 #include "arch/i386/cpu/save_restore.h"
+#include "arch/i386/cpu/smp.h"
 #include "arch/i386/memory/gdt.h"
 #include "arch/i386/memory/paging.h"
 #include "lib/std/stdio.h"
 #include "proc/process.h"
+#include "proc/rusage.h"
 
 namespace arch {
 namespace cpu {
 
 namespace {
 
-using arch::memory::flush_tss;
-using arch::memory::main_tss;
+using arch::memory::set_kernel_stack;
 using proc::process;
 using proc::tls_segment;
 
@@ -20,21 +21,37 @@ extern "C" uint32_t stack_top;
 
 extern "C" __attribute__((cdecl)) void save_processor_state(uint32_t call_addr,
                                                             uint32_t esp) {
+  // Kernel threads already hold the lock
+  char locked = lock_kernel();
+
   uint32_t *page_dir = nullptr;
   char is_userspace = 1;
   uint32_t kernel_stack_top = 0;
   if (esp > (uint32_t)&stack_top) {
-    arch::memory::set_page_directory(base_page_directory);
+    arch::memory::switch_page_directory(base_page_directory);
 
     struct process *current_process = proc::get_currently_executing_process();
     if (current_process) {
-      current_process->esp = esp;
+      // Kernel threads never leave kernel mode
+      if (current_process->is_kernel_thread) {
+        proc::account_system_time(current_process);
+        current_process->esp = esp;
+      } else if (current_process->in_syscall) {
+        // A syscall giving up the CPU at cond_resched. Interrupts are off in
+        // syscalls, so nothing else gets here. The userspace registers stay
+        // put for when it returns.
+        proc::account_system_time(current_process);
+        current_process->syscall_esp = esp;
+      } else {
+        proc::account_user_time(current_process);
+        current_process->esp = esp;
+      }
       page_dir = current_process->page_dir;
       kernel_stack_top = current_process->kernel_stack_top;
     }
   } else {
     is_userspace = 0;
-    kernel_stack_top = (uint32_t)&stack_top;
+    kernel_stack_top = get_scheduler_stack_top();
   }
 
   void (*kernel_entry)(char) = (void (*)(char))call_addr;
@@ -42,24 +59,20 @@ extern "C" __attribute__((cdecl)) void save_processor_state(uint32_t call_addr,
 
   // Just in case we pop back into userspace
   if (page_dir) {
-    arch::memory::set_page_directory(page_dir);
-    restore_processor_state(esp, kernel_stack_top);
+    arch::memory::switch_page_directory(page_dir);
+    restore_processor_state(esp, kernel_stack_top, locked);
   } else {
-    restore_processor_state(esp, kernel_stack_top);
+    restore_processor_state(esp, kernel_stack_top, locked);
   }
 }
 
-void restore_processor_state(uint32_t esp, uint32_t kernel_stack_top) {
-  main_tss.esp0 = kernel_stack_top;
-  flush_tss();
+void restore_processor_state(uint32_t esp, uint32_t kernel_stack_top,
+                             char unlock) {
+  set_kernel_stack(kernel_stack_top);
+  if (unlock) {
+    unlock_kernel();
+  }
   asm volatile("mov %0, %%esp\n"
-               "mov is_sse_enabled, %%eax\n"
-               "test %%eax, %%eax\n"
-               "jz sse_disabled\n"
-               "pop %%ecx\n"
-               "fxrstor (%%esp)\n"
-               "mov %%ecx, %%esp\n"
-               "sse_disabled:\n"
                "popal\n"
                "sti\n"
                "iret"
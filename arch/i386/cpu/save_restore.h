@@ -17,8 +17,9 @@ extern "C" __attribute__((cdecl)) void save_process_state(uint32_t call_addr,
 } // namespace
 
 // Restores the state of a suspended process given the stack pointer where it
-// left off.
-void restore_processor_state(uint32_t esp, uint32_t kernel_stack_top);
+// left off. Releases the kernel lock on the way out if unlock is set.
+void restore_processor_state(uint32_t esp, uint32_t kernel_stack_top,
+                             char unlock);
 
 // Creates an ISR named "entry_name" that saves the processor state and calls
 // "exit_name". Note that this macro screens context switches from the kernel
@@ -27,15 +28,6 @@ void restore_processor_state(uint32_t esp, uint32_t kernel_stack_top);
   asm("" #entry_name ":\n"                                                     \
       "cli\n"                                                                  \
       "pushal\n"                                                               \
-      "mov is_sse_enabled, %eax\n"                                             \
-      "test %eax, %eax\n"                                                      \
-      "jz sse_disabled\n"                                                      \
-      "mov %esp, %ecx\n"                                                       \
-      "and $0xFFFFFFF0, %esp\n"                                                \
-      "sub $0x200, %esp\n"                                                     \
-      "fxsave (%esp)\n"                                                        \
-      "push %ecx\n"                                                            \
-      "sse_disabled:\n"                                                        \
       "mov %esp, %ecx\n"                                                       \
       "push %ecx\n"                                                            \
       "push $" #exit_name "\n"                                                 \
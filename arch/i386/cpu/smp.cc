@@ -0,0 +1,194 @@
+#include "arch/i386/cpu/smp.h"
+#include "arch/i386/cpu/fpu.h"
+#include "arch/i386/cpu/sse.h"
+#include "arch/i386/interrupts/apic.h"
+#include "arch/i386/memory/gdt.h"
+#include "arch/interrupts/interrupts.h"
+#include "io/i386/io.h"
+#include "lib/std/memory.h"
+#include "lib/std/spinlock.h"
+#include "lib/std/stdio.h"
+
+extern "C" {
+// Hands out CPU ids as CPUs come up, used by the trampoline
+volatile uint32_t next_cpu_id = 1;
+}
+
+namespace arch {
+namespace cpu {
+
+namespace {
+
+using arch::interrupts::broadcast_init_ipi;
+using arch::interrupts::broadcast_startup_ipi;
+using arch::interrupts::enable_local_apic;
+using arch::interrupts::get_local_apic_id;
+using lib::std::memcpy;
+using lib::std::printk;
+using lib::std::spin_lock;
+using lib::std::spin_unlock;
+using lib::std::spinlock;
+
+extern "C" uint32_t stack_top;
+extern "C" char ap_stacks[];
+
+// Where the other CPUs start, in real mode. It has to be below 1MB and page
+// aligned.
+constexpr uint32_t TRAMPOLINE_ADDRESS = 0x8000;
+
+constexpr uint32_t NO_CPU = 0xFFFFFFFF;
+
+// How long to give the other CPUs to come up, in port 0x80 writes, which take
+// about a microsecond each
+constexpr uint32_t INIT_DELAY = 10000;
+constexpr uint32_t STARTUP_DELAY = 200;
+constexpr uint32_t BOOT_TIMEOUT = 100000;
+
+struct spinlock kernel_lock;
+volatile uint32_t kernel_lock_owner = NO_CPU;
+
+volatile uint32_t num_cpus = 1;
+uint8_t local_apic_ids[MAX_CPUS];
+void (*secondary_entry)(void);
+
+extern "C" void ap_trampoline(void);
+extern "C" void ap_trampoline_end(void);
+
+// Copied to TRAMPOLINE_ADDRESS, so it can only refer to itself relative to
+// that. Switches to protected mode with a temporary GDT, turns on paging with
+// the kernel's page directory, takes an id and calls ap_main on that CPU's
+// scheduler stack.
+asm(".pushsection .text\n"
+    ".code16\n"
+    "ap_trampoline:\n"
+    "cli\n"
+    "xor %ax, %ax\n"
+    "mov %ax, %ds\n"
+    "lgdtl 0x8000 + ap_trampoline_gdt_descriptor - ap_trampoline\n"
+    "mov %cr0, %eax\n"
+    "or $0x1, %eax\n"
+    "mov %eax, %cr0\n"
+    "ljmpl $0x08, $0x8000 + ap_trampoline_protected - ap_trampoline\n"
+    ".code32\n"
+    "ap_trampoline_protected:\n"
+    "mov $0x10, %ax\n"
+    "mov %ax, %ds\n"
+    "mov %ax, %es\n"
+    "mov %ax, %ss\n"
+    "mov %ax, %fs\n"
+    "mov %ax, %gs\n"
+    "mov $base_page_directory, %eax\n"
+    "mov %eax, %cr3\n"
+    "mov %cr0, %eax\n"
+    "or $0x80000000, %eax\n"
+    "mov %eax, %cr0\n"
+    "mov $1, %eax\n"
+    "lock xadd %eax, next_cpu_id\n"
+    "cmp $8, %eax\n" // MAX_CPUS
+    "jae ap_trampoline_halt\n"
+    "mov %eax, %ebx\n"
+    "shl $14, %eax\n" // CPU_STACK_SIZE
+    "lea ap_stacks(%eax), %esp\n"
+    "xor %ebp, %ebp\n"
+    "push %ebx\n"
+    "mov $ap_main, %eax\n"
+    "call *%eax\n"
+    "ap_trampoline_halt:\n"
+    "cli\n"
+    "hlt\n"
+    "jmp ap_trampoline_halt\n"
+    ".align 8\n"
+    "ap_trampoline_gdt:\n"
+    ".quad 0x0000000000000000\n"
+    ".quad 0x00CF9A000000FFFF\n"
+    ".quad 0x00CF92000000FFFF\n"
+    "ap_trampoline_gdt_descriptor:\n"
+    ".word 23\n"
+    ".long 0x8000 + ap_trampoline_gdt - ap_trampoline\n"
+    "ap_trampoline_end:\n"
+    ".popsection");
+
+void io_delay(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    io::out(0x80, 0);
+  }
+}
+
+} // namespace
+
+// Where the other CPUs land once they're in protected mode with paging on
+extern "C" void ap_main(uint32_t cpu_id) {
+  arch::memory::setup_gdt(cpu_id);
+  arch::interrupts::load_interrupt_table();
+  if (is_sse_enabled) {
+    enable_sse();
+  }
+  init_fpu(0);
+  enable_local_apic(0);
+  local_apic_ids[cpu_id] = get_local_apic_id();
+
+  __atomic_add_fetch(&num_cpus, 1, __ATOMIC_SEQ_CST);
+
+  lock_kernel();
+  printk("CPU %d online\n", cpu_id);
+  secondary_entry();
+}
+
+uint32_t get_cpu_id(void) { return arch::memory::get_gdt_cpu(); }
+
+uint32_t get_num_cpus(void) { return num_cpus; }
+
+uint32_t get_cpu_stack_top(uint32_t cpu_id) {
+  if (cpu_id == 0) {
+    return (uint32_t)&stack_top;
+  }
+  return (uint32_t)ap_stacks + cpu_id * CPU_STACK_SIZE;
+}
+
+extern "C" uint32_t get_scheduler_stack_top(void) {
+  return get_cpu_stack_top(get_cpu_id());
+}
+
+void send_cpu_interrupt(uint32_t cpu_id, uint8_t interrupt_number) {
+  arch::interrupts::send_ipi(local_apic_ids[cpu_id], interrupt_number);
+}
+
+char lock_kernel(void) {
+  uint32_t cpu_id = get_cpu_id();
+  if (kernel_lock_owner == cpu_id) {
+    return 0;
+  }
+  spin_lock(&kernel_lock);
+  kernel_lock_owner = cpu_id;
+  return 1;
+}
+
+void unlock_kernel(void) {
+  kernel_lock_owner = NO_CPU;
+  spin_unlock(&kernel_lock);
+}
+
+void start_secondary_cpus(void (*entry)(void)) {
+  secondary_entry = entry;
+  local_apic_ids[0] = get_local_apic_id();
+
+  memcpy((char *)ap_trampoline, (char *)TRAMPOLINE_ADDRESS,
+         (uint32_t)ap_trampoline_end - (uint32_t)ap_trampoline);
+
+  broadcast_init_ipi();
+  io_delay(INIT_DELAY);
+  broadcast_startup_ipi(TRAMPOLINE_ADDRESS >> 12);
+  io_delay(STARTUP_DELAY);
+  broadcast_startup_ipi(TRAMPOLINE_ADDRESS >> 12);
+
+  // We can't tell how many CPUs there are without ACPI, so give them all
+  // some time to check in
+  for (uint32_t i = 0; i < BOOT_TIMEOUT && num_cpus < MAX_CPUS; i += 100) {
+    io_delay(100);
+  }
+
+  printk("%d CPUs online\n", num_cpus);
+}
+
+} // namespace cpu
+} // namespace arch
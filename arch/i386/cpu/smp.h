@@ -0,0 +1,49 @@
+#ifndef ARCH_I386_CPU_SMP_H
+#define ARCH_I386_CPU_SMP_H
+
+#include <stdint.h>
+
+namespace arch {
+namespace cpu {
+
+constexpr uint32_t MAX_CPUS = 8;
+
+// Every CPU's scheduler runs on a stack of this size, see boot.s
+constexpr uint32_t CPU_STACK_SIZE = 16384;
+
+// Returns the CPU we're running on. The bootstrap CPU is 0 and the others are
+// numbered in the order they come up.
+uint32_t get_cpu_id(void);
+
+// Returns how many CPUs are running
+uint32_t get_num_cpus(void);
+
+// Returns the top of the stack a CPU's scheduler runs on
+uint32_t get_cpu_stack_top(uint32_t cpu_id);
+
+extern "C" uint32_t get_scheduler_stack_top(void);
+
+// Sends an interrupt to another CPU
+void send_cpu_interrupt(uint32_t cpu_id, uint8_t interrupt_number);
+
+// The kernel itself runs on one CPU at a time, and everything it shares
+// between CPUs, like the process list and run queues, is protected by this
+// lock. It's held from the moment a CPU enters the kernel until it goes back
+// to userspace or idles, so user code is all that runs in parallel.
+//
+// Returns 0 without doing anything if this CPU already holds the lock, so
+// nested entries can tell whether they should release it.
+char lock_kernel(void);
+
+void unlock_kernel(void);
+
+// Sends INIT and STARTUP interrupts to every other CPU and waits for them to
+// come up. This CPU's local APIC should already be enabled. Each one sets
+// itself up and then calls entry with the kernel lock held, which shouldn't
+// return.
+void start_secondary_cpus(void (*entry)(void));
+
+} // namespace cpu
+} // namespace arch
+
+#endif
@@ -5,6 +5,32 @@ namespace arch {
 namespace cpu {
 
 char is_sse_enabled;
+char is_xsave_enabled;
+char is_xsaveopt_enabled;
+
+namespace {
+
+constexpr uint32_t CPUID_XSAVE = 1 << 26;
+constexpr uint32_t CPUID_AVX = 1 << 28;
+constexpr uint32_t CPUID_XSAVEOPT = 0x1;
+
+constexpr uint32_t CR4_OSXSAVE = 1 << 18;
+
+// State components in XCR0. x87 has to be on, and AVX needs SSE.
+constexpr uint32_t XCR0_X87 = 0x1;
+constexpr uint32_t XCR0_SSE = 0x2;
+constexpr uint32_t XCR0_AVX = 0x4;
+
+uint32_t xcr0;
+
+void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *eax, uint32_t *ebx,
+           uint32_t *ecx, uint32_t *edx) {
+  asm volatile("cpuid"
+               : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+               : "a"(leaf), "c"(subleaf));
+}
+
+} // namespace
 
 void maybe_enable_sse(void) {
   asm volatile("mov $0x1, %%eax\n"
@@ -19,19 +45,58 @@ void maybe_enable_sse(void) {
   lib::std::printk("Checking SSE...\n");
 
   if (is_sse_enabled) {
-    asm volatile("mov %%cr0, %%eax\n"
-                 "and $0xFFFB, %%ax\n"
-                 "or $0x2, %%ax\n"
-                 "mov %%eax, %%cr0\n"
-                 "mov %%cr4, %%eax\n"
-                 "or $0x600, %%ax\n"
-                 "mov %%eax, %%cr4"
-                 :
-                 :
-                 : "eax", "edx");
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0x1, 0, &eax, &ebx, &ecx, &edx);
+    if (ecx & CPUID_XSAVE) {
+      is_xsave_enabled = 1;
+      xcr0 = XCR0_X87 | XCR0_SSE;
+      if (ecx & CPUID_AVX) {
+        xcr0 |= XCR0_AVX;
+      }
+      cpuid(0xD, 1, &eax, &ebx, &ecx, &edx);
+      is_xsaveopt_enabled = eax & CPUID_XSAVEOPT;
+    }
+
+    enable_sse();
     lib::std::printk("SSE enabled!\n");
+    if (xcr0 & XCR0_AVX) {
+      lib::std::printk("AVX enabled!\n");
+    }
+  }
+}
+
+void enable_sse(void) {
+  asm volatile("mov %%cr0, %%eax\n"
+               "and $0xFFFB, %%ax\n"
+               "or $0x2, %%ax\n"
+               "mov %%eax, %%cr0\n"
+               "mov %%cr4, %%eax\n"
+               "or $0x600, %%ax\n"
+               "mov %%eax, %%cr4"
+               :
+               :
+               : "eax", "edx");
+
+  if (is_xsave_enabled) {
+    asm volatile("mov %%cr4, %%eax\n"
+                 "or %0, %%eax\n"
+                 "mov %%eax, %%cr4\n"
+                 "xor %%ecx, %%ecx\n"
+                 "xor %%edx, %%edx\n"
+                 "mov %1, %%eax\n"
+                 "xsetbv"
+                 :
+                 : "i"(CR4_OSXSAVE), "m"(xcr0)
+                 : "eax", "ecx", "edx");
   }
 }
 
+uint32_t get_xsave_size(void) {
+  // Subleaf 0 reports the size for whatever's turned on in XCR0 right now
+  uint32_t eax, ebx, ecx, edx;
+  cpuid(0xD, 0, &eax, &ebx, &ecx, &edx);
+  return ebx;
+}
+
 } // namespace cpu
 } // namespace arch
@@ -1,13 +1,28 @@
 #ifndef ARCH_CPU_SSE_H
 #define ARCH_CPU_SSE_H
 
+#include <stdint.h>
+
 namespace arch {
 namespace cpu {
 
 extern "C" char is_sse_enabled;
 
+// Set if the CPU has XSAVE, in which case AVX is turned on too if it's there
+extern char is_xsave_enabled;
+
+// Set if XSAVEOPT can skip saving registers that haven't changed
+extern char is_xsaveopt_enabled;
+
 void maybe_enable_sse(void);
 
+// Turns SSE on for this CPU. Other CPUs call this if the bootstrap CPU found
+// SSE, since fxsave and fxrstor fault without it.
+void enable_sse(void);
+
+// Returns how much room XSAVE needs for everything enable_sse turned on
+uint32_t get_xsave_size(void);
+
 } // namespace cpu
 } // namespace arch
 
@@ -1,5 +1,7 @@
 #include "arch/i386/interrupts/apic.h"
 #include "arch/i386/cpu/model_specific.h"
+#include "arch/i386/interrupts/idt.h"
+#include "arch/interrupts/interrupts.h"
 
 namespace arch {
 namespace interrupts {
@@ -8,6 +10,56 @@ namespace {
 
 using arch::cpu::cpu_msr;
 
+// Register offsets from the local APIC's base address
+constexpr uint32_t APIC_ID = 0x20;
+constexpr uint32_t APIC_TASK_PRIORITY = 0x80;
+constexpr uint32_t APIC_EOI = 0xB0;
+constexpr uint32_t APIC_SPURIOUS_VECTOR = 0xF0;
+constexpr uint32_t APIC_COMMAND_LOW = 0x300;
+constexpr uint32_t APIC_COMMAND_HIGH = 0x310;
+constexpr uint32_t APIC_TIMER = 0x320;
+constexpr uint32_t APIC_LINT0 = 0x350;
+constexpr uint32_t APIC_LINT1 = 0x360;
+constexpr uint32_t APIC_TIMER_INITIAL_COUNT = 0x380;
+constexpr uint32_t APIC_TIMER_CURRENT_COUNT = 0x390;
+constexpr uint32_t APIC_TIMER_DIVIDE = 0x3E0;
+
+constexpr uint32_t APIC_GLOBAL_ENABLE = 0x800;
+constexpr uint32_t APIC_SOFTWARE_ENABLE = 0x100;
+
+// Local vector table entries
+constexpr uint32_t LVT_MASKED = 0x10000;
+constexpr uint32_t LVT_NMI = 0x400;
+constexpr uint32_t LVT_TIMER_PERIODIC = 0x20000;
+
+// Timer divide configuration for dividing the bus clock by 16
+constexpr uint32_t TIMER_DIVIDE_BY_16 = 0x3;
+
+// Interrupt command bits
+constexpr uint32_t ICR_INIT = 0x500;
+constexpr uint32_t ICR_STARTUP = 0x600;
+constexpr uint32_t ICR_DELIVERY_PENDING = 0x1000;
+constexpr uint32_t ICR_ASSERT = 0x4000;
+constexpr uint32_t ICR_ALL_BUT_SELF = 0xC0000;
+
+uint32_t apic_base;
+
+volatile uint32_t *apic_register(uint32_t offset) {
+  return (volatile uint32_t *)(apic_base + offset);
+}
+
+void send_command(uint8_t destination, uint32_t command) {
+  *apic_register(APIC_COMMAND_HIGH) = (uint32_t)destination << 24;
+  *apic_register(APIC_COMMAND_LOW) = command;
+  while (*apic_register(APIC_COMMAND_LOW) & ICR_DELIVERY_PENDING) {
+    asm volatile("pause");
+  }
+}
+
+// Spurious interrupts don't get an end of interrupt
+__attribute__((interrupt)) void
+spurious_interrupt(struct interrupt_frame *frame) {}
+
 } // namespace
 
 void disable_apic(void) {
@@ -16,5 +68,67 @@ void disable_apic(void) {
   arch::cpu::set_msr(arch::cpu::APIC_BASE_MSR, value);
 }
 
+void enable_local_apic(char is_bootstrap) {
+  struct cpu_msr value = arch::cpu::get_msr(arch::cpu::APIC_BASE_MSR);
+  value.low |= APIC_GLOBAL_ENABLE;
+  arch::cpu::set_msr(arch::cpu::APIC_BASE_MSR, value);
+  apic_base = value.low & 0xFFFFF000;
+
+  if (is_bootstrap) {
+    register_interrupt_handler(APIC_SPURIOUS_INTERRUPT, INTERRUPT_GATE, 0,
+                               (void *)spurious_interrupt);
+
+    // Device interrupts come through the IOAPIC, so the PIC's virtual wire
+    // isn't needed
+    *apic_register(APIC_LINT0) = LVT_MASKED;
+    *apic_register(APIC_LINT1) = LVT_NMI;
+  } else {
+    *apic_register(APIC_LINT0) = LVT_MASKED;
+    *apic_register(APIC_LINT1) = LVT_MASKED;
+  }
+  *apic_register(APIC_TIMER) = LVT_MASKED;
+
+  *apic_register(APIC_TASK_PRIORITY) = 0;
+  *apic_register(APIC_SPURIOUS_VECTOR) =
+      APIC_SOFTWARE_ENABLE | APIC_SPURIOUS_INTERRUPT;
+}
+
+uint8_t get_local_apic_id(void) { return *apic_register(APIC_ID) >> 24; }
+
+void apic_end_interrupt(void) { *apic_register(APIC_EOI) = 0; }
+
+void start_apic_timer(uint8_t interrupt_number, uint32_t counts,
+                      char periodic) {
+  *apic_register(APIC_TIMER_DIVIDE) = TIMER_DIVIDE_BY_16;
+  *apic_register(APIC_TIMER) =
+      interrupt_number | (periodic ? LVT_TIMER_PERIODIC : 0);
+  *apic_register(APIC_TIMER_INITIAL_COUNT) = counts;
+}
+
+void stop_apic_timer(void) {
+  *apic_register(APIC_TIMER_INITIAL_COUNT) = 0;
+  *apic_register(APIC_TIMER) = LVT_MASKED;
+}
+
+uint32_t read_apic_timer(void) {
+  return *apic_register(APIC_TIMER_CURRENT_COUNT);
+}
+
+void send_ipi(uint8_t apic_id, uint8_t interrupt_number) {
+  send_command(apic_id, ICR_ASSERT | interrupt_number);
+}
+
+void broadcast_ipi(uint8_t interrupt_number) {
+  send_command(0, ICR_ALL_BUT_SELF | ICR_ASSERT | interrupt_number);
+}
+
+void broadcast_init_ipi(void) {
+  send_command(0, ICR_ALL_BUT_SELF | ICR_ASSERT | ICR_INIT);
+}
+
+void broadcast_startup_ipi(uint8_t page) {
+  send_command(0, ICR_ALL_BUT_SELF | ICR_ASSERT | ICR_STARTUP | page);
+}
+
 } // namespace interrupts
 } // namespace arch
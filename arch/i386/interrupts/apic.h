@@ -1,11 +1,46 @@
 #ifndef ARCH_I386_INTERRUPTS_APIC_H
 #define ARCH_I386_INTERRUPTS_APIC_H
 
+#include <stdint.h>
+
 namespace arch {
 namespace interrupts {
 
+constexpr uint8_t APIC_SPURIOUS_INTERRUPT = 0xFF;
+
 void disable_apic(void);
 
+// Turns on this CPU's local APIC, with its timer stopped. Only the bootstrap
+// CPU takes NMIs.
+void enable_local_apic(char is_bootstrap);
+
+uint8_t get_local_apic_id(void);
+
+// Acknowledges an interrupt delivered by the local APIC
+void apic_end_interrupt(void);
+
+// Starts this CPU's timer counting down from counts, at a sixteenth of the
+// bus clock. It interrupts when it reaches zero, and starts over if periodic.
+void start_apic_timer(uint8_t interrupt_number, uint32_t counts,
+                      char periodic);
+
+void stop_apic_timer(void);
+
+// Returns how many counts are left before the timer goes off
+uint32_t read_apic_timer(void);
+
+// Sends an interrupt to the CPU with the given local APIC id
+void send_ipi(uint8_t apic_id, uint8_t interrupt_number);
+
+// Sends an interrupt to every CPU but this one
+void broadcast_ipi(uint8_t interrupt_number);
+
+// Resets every other CPU, for starting them up
+void broadcast_init_ipi(void);
+
+// Starts every other CPU executing real mode code at page * 0x1000
+void broadcast_startup_ipi(uint8_t page);
+
 } // namespace interrupts
 } // namespace arch
 
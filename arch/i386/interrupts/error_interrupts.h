@@ -1,6 +1,8 @@
 #ifndef ARCH_I386_INTERRUPTS_ERROR_INTERRUPTS_H
 #define ARCH_I386_INTERRUPTS_ERROR_INTERRUPTS_H
 
+#include "arch/i386/cpu/fpu.h"
+#include "arch/i386/cpu/smp.h"
 #include "arch/i386/interrupts/idt.h"
 #include "arch/i386/memory/gdt.h"
 #include "lib/std/stdio.h"
@@ -11,6 +13,8 @@ namespace arch {
 namespace interrupts {
 
 namespace {
+using arch::cpu::lock_kernel;
+using arch::cpu::unlock_kernel;
 using arch::memory::USER_CODE_SELECTOR;
 using lib::std::panic;
 using lib::std::print_error;
@@ -19,6 +23,7 @@ using proc::kill_current_process;
 
 static inline void handle_fault(struct interrupt_frame *frame, char *message) {
   if (frame->code_segment == USER_CODE_SELECTOR) {
+    lock_kernel();
     print_error(message);
     kill_current_process();
   } else {
@@ -44,9 +49,19 @@ __attribute__((interrupt)) void invalid_opcode(struct interrupt_frame *frame) {
   handle_fault(frame, (char *)"Invalid opcode!");
 }
 
+// CR0.TS is set, so the running process is using the FPU for the first time
+// since it was switched in. The kernel never uses it.
 __attribute__((interrupt)) void
 device_not_available(struct interrupt_frame *frame) {
-  handle_fault(frame, (char *)"Device not available!");
+  if (frame->code_segment != USER_CODE_SELECTOR) {
+    panic((char *)"Device not available!");
+  }
+
+  char locked = lock_kernel();
+  arch::cpu::handle_fpu_trap();
+  if (locked) {
+    unlock_kernel();
+  }
 }
 
 __attribute__((interrupt)) void double_fault(struct interrupt_frame *frame,
@@ -44,7 +44,7 @@ void register_error_interrupts(void) {
   register_interrupt_handler_internal(4, TRAP_GATE, 0, (void *)overflow);
   register_interrupt_handler_internal(5, TRAP_GATE, 0, (void *)range_exceeded);
   register_interrupt_handler_internal(6, TRAP_GATE, 0, (void *)invalid_opcode);
-  register_interrupt_handler_internal(7, TRAP_GATE, 0,
+  register_interrupt_handler_internal(7, INTERRUPT_GATE, 0,
                                       (void *)device_not_available);
   register_interrupt_handler_internal(8, TRAP_GATE, 0, (void *)double_fault);
   register_interrupt_handler_internal(10, TRAP_GATE, 0, (void *)invalid_tss);
@@ -85,5 +85,7 @@ void initialize_interrupts(void) {
   flush_idt();
 }
 
+void load_interrupt_table(void) { flush_idt(); }
+
 } // namespace interrupts
 } // namespace arch
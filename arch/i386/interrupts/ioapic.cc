@@ -0,0 +1,67 @@
+#include "arch/i386/interrupts/ioapic.h"
+
+#include <stdint.h>
+
+namespace arch {
+namespace interrupts {
+
+namespace {
+
+constexpr uint32_t IOAPIC_BASE = 0xFEC00000;
+
+// Registers are reached indirectly, by writing the register number to the
+// select register and then accessing the window
+constexpr uint32_t IOAPIC_SELECT = 0x00;
+constexpr uint32_t IOAPIC_WINDOW = 0x10;
+
+constexpr uint8_t IOAPIC_VERSION = 0x01;
+// Each input gets two registers, low and then high
+constexpr uint8_t IOAPIC_REDIRECTION_TABLE = 0x10;
+
+constexpr uint32_t REDIRECTION_MASKED = 0x10000;
+
+uint32_t num_inputs;
+
+uint32_t read_register(uint8_t index) {
+  *(volatile uint32_t *)(IOAPIC_BASE + IOAPIC_SELECT) = index;
+  return *(volatile uint32_t *)(IOAPIC_BASE + IOAPIC_WINDOW);
+}
+
+void write_register(uint8_t index, uint32_t value) {
+  *(volatile uint32_t *)(IOAPIC_BASE + IOAPIC_SELECT) = index;
+  *(volatile uint32_t *)(IOAPIC_BASE + IOAPIC_WINDOW) = value;
+}
+
+void write_redirection(uint8_t input, uint32_t low, uint32_t high) {
+  // Mask it while it's half written
+  write_register(IOAPIC_REDIRECTION_TABLE + 2 * input, REDIRECTION_MASKED);
+  write_register(IOAPIC_REDIRECTION_TABLE + 2 * input + 1, high);
+  write_register(IOAPIC_REDIRECTION_TABLE + 2 * input, low);
+}
+
+} // namespace
+
+void init_ioapic(void) {
+  num_inputs = ((read_register(IOAPIC_VERSION) >> 16) & 0xFF) + 1;
+  for (uint32_t i = 0; i < num_inputs; i++) {
+    write_redirection(i, REDIRECTION_MASKED, 0);
+  }
+}
+
+void ioapic_route_irq(uint8_t irq, uint8_t interrupt_number, uint8_t apic_id) {
+  if (irq >= num_inputs) {
+    return;
+  }
+
+  // Fixed delivery to a physical APIC id, edge triggered, active high
+  write_redirection(irq, interrupt_number, (uint32_t)apic_id << 24);
+}
+
+void ioapic_mask_irq(uint8_t irq) {
+  if (irq < num_inputs) {
+    write_redirection(irq, REDIRECTION_MASKED, 0);
+  }
+}
+
+} // namespace interrupts
+} // namespace arch
@@ -0,0 +1,23 @@
+#ifndef ARCH_I386_INTERRUPTS_IOAPIC_H
+#define ARCH_I386_INTERRUPTS_IOAPIC_H
+
+#include <stdint.h>
+
+namespace arch {
+namespace interrupts {
+
+// Masks every IOAPIC input. We don't parse the ACPI tables, so this assumes
+// the standard IOAPIC address and that ISA IRQs other than the PIT's are wired
+// straight to the matching IOAPIC inputs, which is true of most PCs and QEMU.
+void init_ioapic(void);
+
+// Delivers an ISA IRQ to a CPU as interrupt_number. It's edge triggered and
+// active high like on the PIC, and needs an apic_end_interrupt.
+void ioapic_route_irq(uint8_t irq, uint8_t interrupt_number, uint8_t apic_id);
+
+void ioapic_mask_irq(uint8_t irq);
+
+} // namespace interrupts
+} // namespace arch
+
+#endif
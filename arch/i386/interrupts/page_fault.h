@@ -1,6 +1,7 @@
 #ifndef ARCH_INTERRUPTS_PAGE_FAULT_H
 #define ARCH_INTERRUPTS_PAGE_FAULT_H
 
+#include "arch/i386/cpu/smp.h"
 #include "arch/i386/memory/paging.h"
 #include "lib/std/stdio.h"
 #include "proc/process.h"
@@ -10,6 +11,8 @@ namespace interrupts {
 
 namespace {
 
+using arch::cpu::lock_kernel;
+using arch::cpu::unlock_kernel;
 using arch::memory::PAGE_SIZE;
 using arch::memory::set_page_directory;
 using arch::memory::swap_in_page;
@@ -28,8 +31,13 @@ uint32_t page_fault_addr;
 
 __attribute__((interrupt)) void page_fault(struct interrupt_frame *frame,
                                            uint32_t error_code) {
-  asm volatile("cli\n"
-               "mov %%cr2, %0\n"
+  asm volatile("cli");
+
+  // Before touching the globals below, which every CPU shares. This doesn't
+  // disturb esi or edi, which the call preserves.
+  char locked = lock_kernel();
+
+  asm volatile("mov %%cr2, %0\n"
                "mov %%esi, %1\n"
                "mov %%edi, %2"
                : "=r"(page_fault_addr), "=m"(esi), "=m"(edi));
@@ -46,6 +54,9 @@ __attribute__((interrupt)) void page_fault(struct interrupt_frame *frame,
       kill_current_process();
     } else {
       set_page_directory(page_dir);
+      if (locked) {
+        unlock_kernel();
+      }
       asm volatile("mov %0, %%esi\n"
                    "mov %1, %%edi\n"
                    "sti"
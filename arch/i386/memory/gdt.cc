@@ -1,4 +1,5 @@
 #include "arch/i386/memory/gdt.h"
+#include "arch/i386/cpu/smp.h"
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 
@@ -7,16 +8,22 @@ namespace memory {
 
 namespace {
 
+using arch::cpu::MAX_CPUS;
 using lib::std::memset;
 
-struct gdt_descriptor descriptor;
+struct gdt_descriptor descriptors[MAX_CPUS];
 
-struct gdt_entry gdt_table[GDT_TABLE_SIZE];
+struct gdt_entry gdt_tables[MAX_CPUS][GDT_TABLE_SIZE];
+
+struct tss tsses[MAX_CPUS];
+
+// What set_tls last loaded on each CPU
+struct tls_segment loaded_tls[MAX_CPUS];
 
 // Loads GDT.
 // Also sets code segment (using jmp) and the data segments (using mov).
-void load_gdt(void) {
-  void *descriptor_address = &descriptor;
+void load_gdt(struct gdt_descriptor *descriptor) {
+  void *descriptor_address = descriptor;
   asm volatile("lgdt (%0)\n"
                "jmp $0x08,$reload_data\n"
                "reload_data:\n"
@@ -39,11 +46,19 @@ void load_tls(uint16_t selector) {
                : "r"(selector));
 }
 
-extern "C" uint32_t stack_top;
+struct gdt_entry *current_gdt_table(void) { return gdt_tables[get_gdt_cpu()]; }
 
-} // namespace
+// Userspace can load fs and gs itself, so checking our own bookkeeping isn't
+// enough to know the TLS segment is still in them
+char is_tls_loaded(uint16_t selector) {
+  uint16_t fs, gs;
+  asm volatile("mov %%fs, %0\n"
+               "mov %%gs, %1"
+               : "=r"(fs), "=r"(gs));
+  return fs == selector && gs == selector;
+}
 
-struct tss main_tss;
+} // namespace
 
 constexpr uint8_t NULL_SEGMENT = 0x00;
 constexpr uint8_t USER_CODE_SEGMENT = 0xFA;
@@ -69,13 +84,17 @@ void populate_gdt_entry(gdt_entry *entry, uint64_t base, uint32_t limit,
   entry->access = access;
 }
 
-void setup_gdt(void) {
-  descriptor.size = GDT_TABLE_SIZE * sizeof(struct gdt_entry) - 1;
-  descriptor.addr = (uint32_t)gdt_table;
+void setup_gdt(uint32_t cpu_id) {
+  struct gdt_descriptor *descriptor = &descriptors[cpu_id];
+  struct gdt_entry *gdt_table = gdt_tables[cpu_id];
+  struct tss *cpu_tss = &tsses[cpu_id];
+
+  descriptor->size = GDT_TABLE_SIZE * sizeof(struct gdt_entry) - 1;
+  descriptor->addr = (uint32_t)gdt_table;
 
-  memset((char *)&main_tss, sizeof(struct tss), 0);
-  main_tss.esp0 = (uint32_t)&stack_top;
-  main_tss.ss0 = DATA_SELECTOR;
+  memset((char *)cpu_tss, sizeof(struct tss), 0);
+  cpu_tss->esp0 = arch::cpu::get_cpu_stack_top(cpu_id);
+  cpu_tss->ss0 = DATA_SELECTOR;
 
   populate_gdt_entry(gdt_table, 0, 0, 0, NULL_SEGMENT);
   populate_gdt_entry(gdt_table + 1, 0, 0xFFFFF, FOUR_KB_BLOCKS | PROTECTED_MODE,
@@ -86,21 +105,41 @@ void setup_gdt(void) {
                      USER_CODE_SEGMENT);
   populate_gdt_entry(gdt_table + 4, 0, 0xFFFFF, FOUR_KB_BLOCKS | PROTECTED_MODE,
                      USER_DATA_SEGMENT);
-  populate_gdt_entry(gdt_table + 5, (uint32_t)&main_tss, sizeof(struct tss), 0,
+  populate_gdt_entry(gdt_table + 5, (uint32_t)cpu_tss, sizeof(struct tss), 0,
                      TSS_SEGMENT);
 
-  load_gdt();
+  load_gdt(descriptor);
   flush_tss();
 }
 
+uint32_t get_gdt_cpu(void) {
+  struct gdt_descriptor loaded;
+  asm volatile("sgdt %0" : "=m"(loaded));
+  return (loaded.addr - (uint32_t)gdt_tables) / sizeof(gdt_tables[0]);
+}
+
+struct tss *get_tss(void) { return &tsses[get_gdt_cpu()]; }
+
 void set_tls(struct tls_segment &tls) {
-  populate_gdt_entry(gdt_table + tls.gdt_index, tls.segment_base, tls.limit,
-                     FOUR_KB_BLOCKS | PROTECTED_MODE, USER_DATA_SEGMENT);
-  load_tls(tls.gdt_index * sizeof(struct gdt_entry) | 0x3);
+  struct tls_segment *loaded = &loaded_tls[get_gdt_cpu()];
+  uint16_t selector = tls.gdt_index * sizeof(struct gdt_entry) | 0x3;
+  if (loaded->gdt_index == tls.gdt_index &&
+      loaded->segment_base == tls.segment_base && loaded->limit == tls.limit &&
+      is_tls_loaded(selector)) {
+    return;
+  }
+
+  populate_gdt_entry(current_gdt_table() + tls.gdt_index, tls.segment_base,
+                     tls.limit, FOUR_KB_BLOCKS | PROTECTED_MODE,
+                     USER_DATA_SEGMENT);
+  load_tls(selector);
+  *loaded = tls;
 }
 
+void set_kernel_stack(uint32_t stack_top) { get_tss()->esp0 = stack_top; }
+
 void flush_tss(void) {
-  gdt_table[5].access =
+  current_gdt_table()[5].access =
       TSS_SEGMENT; // This needs to be done to clear the busy bit
   asm volatile("movl %0, %%eax\n"
                "ltr %%ax\n"
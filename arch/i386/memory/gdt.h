@@ -61,8 +61,6 @@ struct __attribute__((packed)) tls_segment {
   uint32_t useable : 1;
 };
 
-extern struct tss main_tss;
-
 constexpr uint16_t GDT_TABLE_SIZE = 9;
 constexpr uint16_t TLS_ENTRY_OFFSET = 6;
 constexpr uint8_t CODE_SELECTOR = 0x8;
@@ -73,11 +71,25 @@ constexpr uint8_t TSS_SELECTOR = 0x2B;
 
 constexpr uint8_t SYSCALL_GATE_SELECTOR = 0x18;
 
-// Initializes a flat GDT.
-void setup_gdt(void);
+// Initializes a flat GDT and a TSS for a CPU. Every CPU has its own, since
+// they hold the CPU's TLS segments and kernel stack.
+void setup_gdt(uint32_t cpu_id);
+
+// Returns the id of the CPU whose GDT is loaded, which is the one we're on
+uint32_t get_gdt_cpu(void);
 
+// Returns this CPU's TSS
+struct tss *get_tss(void);
+
+// Loads a TLS segment into this CPU's GDT and fs and gs. Does nothing if
+// they already hold it, like when a process is resumed on the CPU it left.
 void set_tls(struct tls_segment &tls);
 
+// Points this CPU's TSS at the kernel stack to take the next interrupt from
+// userspace on. The CPU reads esp0 from memory every time, so there's no need
+// to reload the TSS.
+void set_kernel_stack(uint32_t stack_top);
+
 void flush_tss(void);
 
 } // namespace memory
@@ -6,6 +6,7 @@
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 #include "lib/std/string.h"
+#include "proc/elf_loader.h"
 #include "proc/process.h"
 
 namespace arch {
@@ -26,7 +27,8 @@ using lib::std::memset;
 using lib::std::panic;
 using lib::std::print_error;
 using lib::std::strlen;
-using proc::get_currently_executing_process;
+using proc::find_process_by_page_dir;
+using proc::invalidate_exec_image;
 using proc::kill_current_process;
 using proc::process;
 
@@ -62,6 +64,7 @@ void unmap_memory_range(uint32_t *page_directory, void *virtual_addr,
   void *current_addr = virtual_addr;
   while (current_addr < virtual_addr + len) {
     *get_page_table_entry(page_directory, current_addr) = 0;
+    current_addr += PAGE_SIZE;
   }
 }
 
@@ -143,19 +146,12 @@ void *virtual_to_physical(uint32_t *page_dir, void *virtual_addr) {
   uint32_t *page_table_entry = get_page_table_entry(page_dir, virtual_addr);
 
   if (!(*page_table_entry & PRESENT)) {
-    struct process *current_process = get_currently_executing_process();
-    while (current_process->page_dir != page_dir) {
-      current_process = current_process->next;
-      if (current_process == get_currently_executing_process()) {
-        break;
-      }
-    }
-
-    if (current_process->page_dir != page_dir) {
+    struct process *owner = find_process_by_page_dir(page_dir);
+    if (!owner) {
       return nullptr;
     }
 
-    if (!swap_in_page(current_process,
+    if (!swap_in_page(owner,
                       (void *)((uint32_t)virtual_addr & (~(PAGE_SIZE - 1))))) {
       return nullptr;
     }
@@ -279,16 +275,28 @@ char swap_in_page(struct process *proc, void *virtual_addr) {
   map_memory_segment(proc, (uint32_t)actual_addr, (uint32_t)virtual_addr,
                      PAGE_SIZE, user_read_write, FILE_BACKED);
 
+  // Pages past the end of the file backed region (e.g. an ELF bss) are just
+  // zero filled.
   uint32_t offset = (uint32_t)virtual_addr - (uint32_t)current_mapping->mapping;
-  size_t read_len = current_mapping->mapping_len - offset < PAGE_SIZE
-                        ? current_mapping->mapping_len - offset
-                        : PAGE_SIZE;
+  size_t read_len = 0;
+  if (offset < current_mapping->file_len) {
+    read_len = current_mapping->file_len - offset < PAGE_SIZE
+                   ? current_mapping->file_len - offset
+                   : PAGE_SIZE;
+  }
   offset += current_mapping->offset;
-  uint32_t read_size =
-      read_fat32(current_file->inode, offset, (uint8_t *)actual_addr, read_len);
-  if (!read_size) {
-    return 0;
-  } else if (read_size < PAGE_SIZE) {
+  uint32_t read_size = 0;
+  if (read_len) {
+    proc->usage.major_faults++;
+    read_size = read_fat32(current_file->inode, offset, (uint8_t *)actual_addr,
+                           read_len);
+    if (!read_size) {
+      return 0;
+    }
+  } else {
+    proc->usage.minor_faults++;
+  }
+  if (read_size < PAGE_SIZE) {
     memset((char *)actual_addr + read_size, PAGE_SIZE - read_size, 0);
   }
 
@@ -302,6 +310,7 @@ void flush_pages(uint32_t *page_dir, struct file_mapping *mapping,
   if (start_addr) {
     current_addr = start_addr;
   }
+  char written = 0;
   while (current_addr < mapping->mapping + mapping->mapping_len &&
          (!stop_addr || current_addr < stop_addr)) {
     uint32_t *page_table_entry = get_page_table_entry(page_dir, current_addr);
@@ -319,6 +328,11 @@ void flush_pages(uint32_t *page_dir, struct file_mapping *mapping,
                              ? mapping->mapping_len - offset
                              : PAGE_SIZE;
       offset += mapping->offset;
+      if (!written) {
+        // The file is changing under any cached copy of it
+        invalidate_exec_image(backing_file->inode);
+        written = 1;
+      }
       write_fat32(backing_file->path, offset, (uint8_t *)actual_addr,
                   write_len);
       *page_table_entry ^= DIRTY;
@@ -55,6 +55,22 @@ static void inline set_page_directory(uint32_t *page_directory) {
   asm volatile("mov %0, %%cr3" : : "r"(page_directory));
 }
 
+// Returns the page directory in the CR3 register.
+static inline uint32_t *get_page_directory(void) {
+  uint32_t *page_directory;
+  asm volatile("mov %%cr3, %0" : "=r"(page_directory));
+  return page_directory;
+}
+
+// Like set_page_directory, but leaves CR3 alone if it's already there, which
+// saves flushing the TLB. For moving between address spaces, not for flushing
+// after changing the page tables.
+static void inline switch_page_directory(uint32_t *page_directory) {
+  if (get_page_directory() != page_directory) {
+    set_page_directory(page_directory);
+  }
+}
+
 // Sets the page flag in the CR0 register and then "refreshes" the MMU by
 // copying CR3 and copying it back.
 static void inline enable_paging(void) {
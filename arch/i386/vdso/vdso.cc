@@ -0,0 +1,177 @@
+// The vDSO, a tiny shared library mapped into every process so it can read the
+// clocks and its pid without a syscall. It's built on its own and linked into
+// the kernel as a blob, so it can't use anything from the kernel but headers.
+
+#include <stdint.h>
+
+#include "arch/i386/vdso/vdso.h"
+#include "lib/math.h"
+#include "lib/std/seqlock.h"
+#include "lib/std/time.h"
+
+namespace {
+
+using arch::vdso::PROCESS_DATA_ADDRESS;
+using arch::vdso::process_data;
+using arch::vdso::VVAR_ADDRESS;
+using lib::divide_by_u32;
+using lib::multiply_shift;
+using lib::std::clock_data;
+using lib::std::read_seqcount_begin;
+using lib::std::read_seqcount_retry;
+using lib::std::time;
+using lib::std::VDSO_CLOCK_TSC;
+
+constexpr uint32_t CLOCK_REALTIME = 0;
+constexpr uint32_t CLOCK_MONOTONIC = 1;
+constexpr uint32_t CLOCK_MONOTONIC_RAW = 4;
+constexpr uint32_t CLOCK_REALTIME_COARSE = 5;
+constexpr uint32_t CLOCK_MONOTONIC_COARSE = 6;
+constexpr uint32_t CLOCK_BOOTTIME = 7;
+
+constexpr uint32_t SYS_GETTIMEOFDAY = 0x4E;
+constexpr uint32_t SYS_CLOCK_GETTIME = 0x109;
+constexpr uint32_t SYS_CLOCK_GETRES = 0x10A;
+
+constexpr uint32_t NANOSECONDS_PER_SECOND = 1000000000;
+
+struct timeval {
+  uint32_t seconds;
+  uint32_t microseconds;
+};
+
+// The sequence's fences keep the compiler from caching anything in here across
+// reads
+const struct clock_data *get_clock_data(void) {
+  return (const struct clock_data *)VVAR_ADDRESS;
+}
+
+uint32_t syscall(uint32_t number, uint32_t arg1, uint32_t arg2) {
+  uint32_t ret;
+  asm volatile("int $0x80"
+               : "=a"(ret)
+               : "a"(number), "b"(arg1), "c"(arg2)
+               : "memory");
+  return ret;
+}
+
+uint64_t read_tsc(void) {
+  uint32_t low;
+  uint32_t high;
+  asm volatile("rdtsc" : "=a"(low), "=d"(high));
+  return ((uint64_t)high << 32) | low;
+}
+
+// Reads a clock the same way the kernel's read_clock does. Returns 0 if it
+// needs a syscall.
+char read_clock(uint32_t clock_id, struct time *now) {
+  const struct clock_data *data = get_clock_data();
+  uint32_t sequence;
+  do {
+    sequence = read_seqcount_begin(&data->seq);
+
+    struct time offset = {0, 0};
+    if (clock_id == CLOCK_REALTIME || clock_id == CLOCK_REALTIME_COARSE) {
+      offset = data->boot_time;
+    }
+
+    if (clock_id == CLOCK_REALTIME_COARSE ||
+        clock_id == CLOCK_MONOTONIC_COARSE) {
+      *now = data->coarse_time;
+    } else if (data->vdso_mode == VDSO_CLOCK_TSC) {
+      uint64_t counts = read_tsc() - data->clocksource_start;
+      uint64_t nanos = data->clocksource_start_nanos +
+                       multiply_shift(counts, data->mult, data->shift);
+      now->seconds =
+          divide_by_u32(nanos, NANOSECONDS_PER_SECOND, &now->nanoseconds);
+    } else {
+      return 0;
+    }
+
+    now->seconds += offset.seconds;
+    now->nanoseconds += offset.nanoseconds;
+    if (now->nanoseconds >= NANOSECONDS_PER_SECOND) {
+      now->seconds++;
+      now->nanoseconds -= NANOSECONDS_PER_SECOND;
+    }
+  } while (read_seqcount_retry(&data->seq, sequence));
+
+  return 1;
+}
+
+char is_vdso_clock(uint32_t clock_id) {
+  return clock_id == CLOCK_REALTIME || clock_id == CLOCK_MONOTONIC ||
+         clock_id == CLOCK_MONOTONIC_RAW || clock_id == CLOCK_BOOTTIME ||
+         clock_id == CLOCK_REALTIME_COARSE ||
+         clock_id == CLOCK_MONOTONIC_COARSE;
+}
+
+} // namespace
+
+// glibc makes its syscalls through here once it's found it in AT_SYSINFO,
+// which the kernel only hands out if it set up SYSENTER. SYSENTER keeps neither
+// the user stack nor a return address, so ebp carries the stack and the kernel
+// comes back to just past the sysenter, with SYSEXIT or with an iret if it
+// switched processes. SYSEXIT takes ecx and edx, so they come back off the
+// stack along with ebp, which the kernel reads the sixth argument from.
+asm(".pushsection .text\n"
+    ".globl __kernel_vsyscall\n"
+    ".type __kernel_vsyscall, @function\n"
+    "__kernel_vsyscall:\n"
+    "push %ecx\n"
+    "push %edx\n"
+    "push %ebp\n"
+    "mov %esp, %ebp\n"
+    "sysenter\n"
+    // VSYSCALL_RETURN_OFFSET bytes in
+    "pop %ebp\n"
+    "pop %edx\n"
+    "pop %ecx\n"
+    "ret\n"
+    ".size __kernel_vsyscall, . - __kernel_vsyscall\n"
+    ".popsection");
+
+extern "C" {
+
+int __vdso_clock_gettime(uint32_t clock_id, struct time *tp) {
+  if (!is_vdso_clock(clock_id) || !read_clock(clock_id, tp)) {
+    return syscall(SYS_CLOCK_GETTIME, clock_id, (uint32_t)tp);
+  }
+  return 0;
+}
+
+int __vdso_gettimeofday(struct timeval *tv, void *tz) {
+  if (tz) {
+    return syscall(SYS_GETTIMEOFDAY, (uint32_t)tv, (uint32_t)tz);
+  }
+
+  struct time now;
+  if (!read_clock(CLOCK_REALTIME, &now)) {
+    return syscall(SYS_GETTIMEOFDAY, (uint32_t)tv, 0);
+  }
+  if (tv) {
+    tv->seconds = now.seconds;
+    tv->microseconds = now.nanoseconds / 1000;
+  }
+  return 0;
+}
+
+uint32_t __vdso_time(uint32_t *tloc) {
+  // Seconds only move with the tick anyway
+  struct time now;
+  read_clock(CLOCK_REALTIME_COARSE, &now);
+  if (tloc) {
+    *tloc = now.seconds;
+  }
+  return now.seconds;
+}
+
+int __vdso_clock_getres(uint32_t clock_id, struct time *res) {
+  return syscall(SYS_CLOCK_GETRES, clock_id, (uint32_t)res);
+}
+
+uint32_t __vdso_getpid(void) {
+  return ((const volatile struct process_data *)PROCESS_DATA_ADDRESS)->pid;
+}
+
+} // extern "C"
@@ -0,0 +1,26 @@
+#ifndef ARCH_I386_VDSO_VDSO_H
+#define ARCH_I386_VDSO_VDSO_H
+
+#include <stdint.h>
+
+namespace arch {
+namespace vdso {
+
+// Every process has the kernel's clock data, a page of its own and then the
+// vDSO image mapped read only here, just under the top of userspace
+constexpr uint32_t VVAR_ADDRESS = 0xBFFD0000;
+constexpr uint32_t PROCESS_DATA_ADDRESS = VVAR_ADDRESS + 0x1000;
+constexpr uint32_t VDSO_ADDRESS = VVAR_ADDRESS + 0x2000;
+
+// Where SYSENTER returns to, from the start of __kernel_vsyscall
+constexpr uint32_t VSYSCALL_RETURN_OFFSET = 7;
+
+// What the vDSO knows about the process it's mapped into
+struct process_data {
+  uint32_t pid;
+};
+
+} // namespace vdso
+} // namespace arch
+
+#endif
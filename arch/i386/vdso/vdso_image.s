@@ -0,0 +1,13 @@
+# The built vDSO, page aligned so it can be mapped straight into processes
+
+.section .rodata
+.balign 4096
+.globl vdso_image_start
+vdso_image_start:
+.incbin "arch/vdso/vdso.so"
+.globl vdso_image_end
+vdso_image_end:
+.balign 4096
+
+# Nothing here needs an executable stack
+.section .note.GNU-stack,"",@progbits
@@ -13,6 +13,9 @@ void register_interrupt_handler(uint8_t interrupt_number, uint8_t type,
 // Initialize IDT and some exception handling interrupts.
 void initialize_interrupts(void);
 
+// Points another CPU at the IDT set up by initialize_interrupts
+void load_interrupt_table(void);
+
 } // namespace interrupts
 } // namespace arch
 
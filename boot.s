@@ -4,6 +4,7 @@
 .set MAGIC, 0x1BADB002
 .set CHECKSUM, -(MAGIC + FLAGS)
 .set STACK_SIZE, 16384
+.set MAX_CPUS, 8
 
 .section .multiboot
 .align 4
@@ -13,6 +14,11 @@
 
 .section .bss, "aw", @nobits
 .align 16
+# Scheduler stacks for every CPU but the first. They sit below stack_top so
+# interrupts can tell them apart from process kernel stacks.
+.global ap_stacks
+ap_stacks:
+.skip STACK_SIZE * (MAX_CPUS - 1)
 .global stack_bottom
 stack_bottom:
 .skip STACK_SIZE
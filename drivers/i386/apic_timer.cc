@@ -0,0 +1,258 @@
+#include <stdint.h>
+
+#include "arch/i386/cpu/save_restore.h"
+#include "arch/i386/cpu/smp.h"
+#include "arch/i386/interrupts/apic.h"
+#include "arch/i386/interrupts/idt.h"
+#include "arch/interrupts/interrupts.h"
+#include "drivers/i386/apic_timer.h"
+#include "drivers/i386/pit.h"
+#include "lib/math.h"
+#include "lib/std/stdio.h"
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/process.h"
+#include "proc/smp.h"
+
+namespace drivers {
+
+namespace {
+
+using arch::cpu::get_cpu_id;
+using arch::interrupts::apic_end_interrupt;
+using arch::interrupts::INTERRUPT_GATE;
+using arch::interrupts::read_apic_timer;
+using arch::interrupts::register_interrupt_handler;
+using arch::interrupts::start_apic_timer;
+using arch::interrupts::stop_apic_timer;
+using lib::divide;
+using lib::multiply;
+using lib::std::add_time;
+using lib::std::next_timer_deadline;
+using lib::std::printk;
+using lib::std::register_tick_device;
+using lib::std::run_timers;
+using lib::std::system_time;
+using lib::std::tick;
+using lib::std::tick_device;
+using lib::std::time;
+using lib::std::time_before;
+using proc::advance_process_queue;
+using proc::execute_processes;
+using proc::get_currently_executing_process;
+using proc::kick_cpu;
+using proc::resume_running_process;
+using proc::tick_other_cpus;
+
+// How long to count the timer against the PIT, about 10ms
+constexpr uint16_t CALIBRATION_PIT_COUNTS = 11932;
+
+constexpr uint32_t MIN_ONESHOT_COUNTS = 16;
+// Keeps a one shot's length under a second, so it fits in nanoseconds
+constexpr uint64_t MAX_ONESHOT_NANOS = 500000000;
+
+constexpr uint32_t BOOTSTRAP_CPU = 0;
+
+uint8_t timer_irq_num;
+
+// Timer counts per second
+uint64_t timer_frequency;
+
+struct time tick_size;
+uint32_t max_oneshot_counts;
+
+// The timer always runs as a one shot, set for the next tick or timer
+// deadline, whichever comes first. Whether the scheduler wants ticks, and when
+// the next one is due.
+char ticking;
+struct time next_tick;
+
+// Counts in the current one shot, how many of them are already in system_time,
+// and when it goes off
+uint32_t event_counts;
+uint32_t accounted_counts;
+struct time event_expiry;
+
+struct time counts_to_time(uint32_t counts) {
+  uint64_t nanos = multiply((uint64_t)counts, (uint64_t)1000000000);
+  nanos = divide(nanos, timer_frequency);
+
+  struct time ret;
+  ret.seconds = 0;
+  ret.nanoseconds = nanos;
+  return ret;
+}
+
+uint32_t time_to_counts(const struct time &start, const struct time &end) {
+  if (!time_before(start, end)) {
+    return MIN_ONESHOT_COUNTS;
+  }
+
+  uint32_t seconds = end.seconds - start.seconds;
+  if (seconds > 1) {
+    return max_oneshot_counts;
+  }
+
+  uint64_t nanos = multiply((uint64_t)seconds, (uint64_t)1000000000) +
+                   end.nanoseconds - start.nanoseconds;
+  uint64_t counts = divide(multiply(nanos, timer_frequency), 1000000000) + 1;
+  if (counts > max_oneshot_counts) {
+    return max_oneshot_counts;
+  }
+  if (counts < MIN_ONESHOT_COUNTS) {
+    return MIN_ONESHOT_COUNTS;
+  }
+  return counts;
+}
+
+void account_elapsed_counts(void) {
+  // A one shot stops at zero once it's expired
+  uint32_t elapsed = event_counts - read_apic_timer();
+  if (elapsed > accounted_counts) {
+    struct time elapsed_time = counts_to_time(elapsed - accounted_counts);
+    tick(elapsed_time);
+    accounted_counts = elapsed;
+  }
+}
+
+// Sets deadline to the next tick or timer, whichever is first. Returns 0 if
+// there's neither.
+char next_event(struct time *deadline) {
+  char has_deadline = next_timer_deadline(deadline);
+  if (ticking && (!has_deadline || time_before(next_tick, *deadline))) {
+    *deadline = next_tick;
+    return 1;
+  }
+  return has_deadline;
+}
+
+// Only the bootstrap CPU can reach its timer, and system_time should be
+// current
+void program_next_event(void) {
+  struct time deadline;
+  uint32_t counts = next_event(&deadline)
+                        ? time_to_counts(system_time, deadline)
+                        : max_oneshot_counts;
+  start_apic_timer(timer_irq_num, counts, 0);
+
+  event_counts = counts;
+  accounted_counts = 0;
+  event_expiry = add_time(system_time, counts_to_time(counts));
+}
+
+// Brings the one shot forward if the next event is now earlier. A later one
+// shot is left alone, it'll just go off early and reprogram. This is the
+// common case, so avoid touching the timer at all.
+void update_next_event(void) {
+  struct time deadline;
+  if (!next_event(&deadline) || !time_before(deadline, event_expiry)) {
+    return;
+  }
+
+  // The bootstrap CPU picks the tick mode again whenever it goes back to its
+  // scheduler, which reprograms the timer
+  if (get_cpu_id() != BOOTSTRAP_CPU) {
+    kick_cpu(BOOTSTRAP_CPU);
+    return;
+  }
+
+  account_elapsed_counts();
+  program_next_event();
+}
+
+void timer_set_periodic(void) {
+  if (!ticking) {
+    ticking = 1;
+    next_tick = add_time(system_time, tick_size);
+  }
+  update_next_event();
+}
+
+void timer_set_oneshot(void) {
+  ticking = 0;
+  update_next_event();
+}
+
+void timer_update_time(void) {
+  // Other CPUs can't read the timer, so they get time as of the last
+  // interrupt
+  if (get_cpu_id() == BOOTSTRAP_CPU) {
+    account_elapsed_counts();
+  }
+}
+
+struct tick_device apic_tick_device = {timer_set_periodic, timer_set_oneshot,
+                                       update_next_event, timer_update_time};
+
+extern "C" void apic_timer_handler(char is_userspace) {
+  apic_end_interrupt();
+
+  account_elapsed_counts();
+
+  char is_tick = 0;
+  if (ticking && !time_before(system_time, next_tick)) {
+    is_tick = 1;
+    next_tick = add_time(next_tick, tick_size);
+
+    // Skip ticks we're too late for rather than fire them back to back
+    if (!time_before(system_time, next_tick)) {
+      next_tick = add_time(system_time, tick_size);
+    }
+  }
+
+  run_timers();
+  program_next_event();
+
+  // Timer deadlines are only for this CPU, whoever they wake gets kicked
+  if (is_tick) {
+    tick_other_cpus();
+  }
+
+  if (is_userspace) {
+    advance_process_queue();
+    if (!resume_running_process(get_currently_executing_process())) {
+      execute_processes();
+    }
+  }
+}
+
+extern "C" void apic_timer_interrupt(void);
+
+SAVE_PROCESSOR_STATE(apic_timer_interrupt, apic_timer_handler)
+
+// Counts how far the timer gets in a known number of PIT counts
+void calibrate(void) {
+  start_apic_timer(timer_irq_num, 0xFFFFFFFF, 0);
+  pit_wait(CALIBRATION_PIT_COUNTS);
+  uint32_t elapsed = 0xFFFFFFFF - read_apic_timer();
+  stop_apic_timer();
+
+  timer_frequency =
+      divide(multiply((uint64_t)elapsed, PIT_FREQUENCY_NUMERATOR),
+             multiply(PIT_FREQUENCY_DENOMINATOR, CALIBRATION_PIT_COUNTS));
+}
+
+} // namespace
+
+void init_apic_timer(uint8_t irq_num, uint32_t period) {
+  timer_irq_num = irq_num;
+
+  register_interrupt_handler(irq_num, INTERRUPT_GATE, 0,
+                             (void *)apic_timer_interrupt);
+
+  calibrate();
+  printk("APIC timer: %d Hz\n", (uint32_t)timer_frequency);
+
+  tick_size =
+      counts_to_time(divide(multiply(timer_frequency, period), 1000000));
+  max_oneshot_counts =
+      divide(multiply(timer_frequency, MAX_ONESHOT_NANOS), 1000000000);
+
+  register_tick_device(&apic_tick_device);
+
+  ticking = 1;
+  next_tick = add_time(system_time, tick_size);
+  program_next_event();
+}
+
+} // namespace drivers
@@ -0,0 +1,17 @@
+#ifndef DRIVERS_I386_APIC_TIMER_H
+#define DRIVERS_I386_APIC_TIMER_H
+
+#include <stdint.h>
+
+namespace drivers {
+
+// Calibrates the bootstrap CPU's local APIC timer against the PIT and makes it
+// the tick device, ticking every period microseconds. It runs as a one shot
+// programmed for each tick or timer deadline, so timers don't wait for the
+// tick. It keeps system_time, so the other CPUs only ever change it through
+// the bootstrap CPU.
+void init_apic_timer(uint8_t irq_num, uint32_t period);
+
+} // namespace drivers
+
+#endif
@@ -1,7 +1,10 @@
 #include <stdint.h>
 
+#include "arch/i386/cpu/smp.h"
+#include "arch/i386/interrupts/apic.h"
 #include "arch/i386/interrupts/idt.h"
-#include "arch/i386/interrupts/pic.h"
+#include "arch/i386/interrupts/ioapic.h"
+#include "arch/i386/memory/paging.h"
 #include "arch/interrupts/interrupts.h"
 #include "drivers/i386/keyboard.h"
 #include "io/i386/io.h"
@@ -11,9 +14,12 @@ namespace drivers {
 
 namespace {
 
+using arch::cpu::lock_kernel;
+using arch::cpu::unlock_kernel;
+using arch::interrupts::apic_end_interrupt;
 using arch::interrupts::interrupt_frame;
-using arch::interrupts::pic_get_mask;
-using arch::interrupts::pic_set_mask;
+using arch::memory::get_page_directory;
+using arch::memory::set_page_directory;
 using io::in;
 using io::out;
 
@@ -27,17 +33,28 @@ constexpr uint8_t KEYBOARD_ENABLE_ONE = 0xAE;
 constexpr uint8_t KEYBOARD_ENABLE_TWO = 0xA8;
 constexpr uint8_t KEYBOARD_ENABLE_INTERRUPT_ONE = 0x1;
 constexpr uint8_t KEYBOARD_ENABLE_INTERRUPT_TWO = 0x2;
-constexpr uint16_t KEYBOARD_INTERRUPT_MASK = ~0x2;
+constexpr uint8_t KEYBOARD_IRQ = 1;
 
 __attribute__((interrupt)) void
 keyboard_interrupt(struct interrupt_frame *frame) {
+  char locked = lock_kernel();
+
+  // The local APIC is only mapped in the kernel's page directory
+  uint32_t *page_directory = get_page_directory();
+  set_page_directory(base_page_directory);
+
   uint8_t keycode = in(KEYBOARD_DATA_PORT);
   if (keycode > 0x58) {
     io::key_release(keycode - 0x80);
   } else {
     io::key_press(keycode);
   }
-  arch::interrupts::end_interrupt(keyboard_irq_num);
+  apic_end_interrupt();
+
+  set_page_directory(page_directory);
+  if (locked) {
+    unlock_kernel();
+  }
 }
 
 } // namespace
@@ -64,8 +81,9 @@ void init_keyboard(uint8_t irq_num) {
   out(KEYBOARD_DATA_PORT,
       KEYBOARD_ENABLE_INTERRUPT_ONE | KEYBOARD_ENABLE_INTERRUPT_TWO);
 
-  // Unmask keyboard IRQ
-  pic_set_mask(pic_get_mask() & KEYBOARD_INTERRUPT_MASK);
+  // Unmask keyboard IRQ, delivered to this CPU
+  arch::interrupts::ioapic_route_irq(
+      KEYBOARD_IRQ, irq_num, arch::interrupts::get_local_apic_id());
 }
 
 } // namespace drivers
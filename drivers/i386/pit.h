@@ -5,7 +5,13 @@
 
 namespace drivers {
 
-void init_pit(uint8_t irq_num, uint16_t period);
+// The PIT runs at 3579545 / 3 Hz
+constexpr uint64_t PIT_FREQUENCY_NUMERATOR = 3579545;
+constexpr uint64_t PIT_FREQUENCY_DENOMINATOR = 3;
+
+// Busy waits for the given number of PIT counts. The PIT isn't used for ticks
+// anymore, just as a known clock to calibrate faster timers against.
+void pit_wait(uint16_t counts);
 
 } // namespace drivers
 
@@ -0,0 +1,113 @@
+#include <stdint.h>
+
+#include "drivers/i386/rtc.h"
+#include "io/i386/io.h"
+
+namespace drivers {
+
+namespace {
+
+using io::in;
+using io::out;
+
+constexpr uint8_t CMOS_ADDRESS_PORT = 0x70;
+constexpr uint8_t CMOS_DATA_PORT = 0x71;
+
+constexpr uint8_t RTC_SECONDS = 0x00;
+constexpr uint8_t RTC_MINUTES = 0x02;
+constexpr uint8_t RTC_HOURS = 0x04;
+constexpr uint8_t RTC_DAY = 0x07;
+constexpr uint8_t RTC_MONTH = 0x08;
+constexpr uint8_t RTC_YEAR = 0x09;
+constexpr uint8_t RTC_STATUS_A = 0x0A;
+constexpr uint8_t RTC_STATUS_B = 0x0B;
+
+constexpr uint8_t UPDATE_IN_PROGRESS = 0x80;
+constexpr uint8_t BINARY_MODE = 0x04;
+constexpr uint8_t TWENTY_FOUR_HOUR_MODE = 0x02;
+constexpr uint8_t PM_FLAG = 0x80;
+
+constexpr uint32_t SECONDS_PER_DAY = 86400;
+
+// Days before each month in a non leap year
+constexpr uint32_t DAYS_BEFORE_MONTH[12] = {0,   31,  59,  90,  120, 151,
+                                            181, 212, 243, 273, 304, 334};
+
+struct rtc_time {
+  uint8_t seconds;
+  uint8_t minutes;
+  uint8_t hours;
+  uint8_t day;
+  uint8_t month;
+  uint8_t year;
+};
+
+uint8_t read_cmos(uint8_t reg) {
+  out(CMOS_ADDRESS_PORT, reg);
+  return in(CMOS_DATA_PORT);
+}
+
+void read_registers(struct rtc_time *ret) {
+  // The registers are garbage while the clock is updating them
+  while (read_cmos(RTC_STATUS_A) & UPDATE_IN_PROGRESS) {
+  }
+
+  ret->seconds = read_cmos(RTC_SECONDS);
+  ret->minutes = read_cmos(RTC_MINUTES);
+  ret->hours = read_cmos(RTC_HOURS);
+  ret->day = read_cmos(RTC_DAY);
+  ret->month = read_cmos(RTC_MONTH);
+  ret->year = read_cmos(RTC_YEAR);
+}
+
+uint8_t from_bcd(uint8_t bcd) { return (bcd >> 4) * 10 + (bcd & 0xF); }
+
+char is_leap_year(uint32_t year) {
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+} // namespace
+
+uint32_t read_rtc(void) {
+  // Read until we get the same thing twice, in case an update snuck in
+  struct rtc_time now;
+  struct rtc_time last;
+  read_registers(&now);
+  do {
+    last = now;
+    read_registers(&now);
+  } while (now.seconds != last.seconds || now.minutes != last.minutes ||
+           now.hours != last.hours || now.day != last.day ||
+           now.month != last.month || now.year != last.year);
+
+  uint8_t status = read_cmos(RTC_STATUS_B);
+  char is_pm = now.hours & PM_FLAG;
+  now.hours &= ~PM_FLAG;
+  if (!(status & BINARY_MODE)) {
+    now.seconds = from_bcd(now.seconds);
+    now.minutes = from_bcd(now.minutes);
+    now.hours = from_bcd(now.hours);
+    now.day = from_bcd(now.day);
+    now.month = from_bcd(now.month);
+    now.year = from_bcd(now.year);
+  }
+  if (!(status & TWENTY_FOUR_HOUR_MODE)) {
+    now.hours = now.hours % 12 + (is_pm ? 12 : 0);
+  }
+
+  uint32_t year = 2000 + now.year;
+  uint32_t days = 0;
+  for (uint32_t i = 1970; i < year; i++) {
+    days += is_leap_year(i) ? 366 : 365;
+  }
+  days += DAYS_BEFORE_MONTH[(now.month - 1) % 12];
+  if (now.month > 2 && is_leap_year(year)) {
+    days++;
+  }
+  days += now.day - 1;
+
+  return days * SECONDS_PER_DAY + now.hours * 3600 + now.minutes * 60 +
+         now.seconds;
+}
+
+} // namespace drivers
@@ -0,0 +1,14 @@
+#ifndef DRIVERS_I386_RTC_H
+#define DRIVERS_I386_RTC_H
+
+#include <stdint.h>
+
+namespace drivers {
+
+// Reads the CMOS real time clock, in seconds since the Unix epoch. The clock
+// is assumed to be in UTC and in the 21st century.
+uint32_t read_rtc(void);
+
+} // namespace drivers
+
+#endif
@@ -0,0 +1,62 @@
+#include <stdint.h>
+
+#include "arch/i386/cpu/model_specific.h"
+#include "drivers/i386/pit.h"
+#include "drivers/i386/tsc.h"
+#include "lib/math.h"
+#include "lib/std/stdio.h"
+#include "lib/std/time.h"
+
+namespace drivers {
+
+namespace {
+
+using arch::cpu::read_tsc;
+using lib::divide;
+using lib::std::clocksource;
+using lib::std::printk;
+using lib::std::register_clocksource;
+using lib::std::VDSO_CLOCK_TSC;
+
+// How long to count cycles against the PIT, about 10ms
+constexpr uint16_t CALIBRATION_PIT_COUNTS = 11932;
+
+// Enough fraction bits to get below a nanosecond per cycle, while anything
+// faster than 4MHz still fits mult in 32 bits
+constexpr uint32_t TSC_SHIFT = 24;
+
+struct clocksource tsc_clocksource = {read_tsc, 0, TSC_SHIFT, VDSO_CLOCK_TSC};
+
+char has_tsc(void) {
+  uint32_t features;
+  asm volatile("mov $0x1, %%eax\n"
+               "cpuid"
+               : "=d"(features)
+               :
+               : "eax", "ebx", "ecx");
+  return (features >> 4) & 0x1;
+}
+
+} // namespace
+
+void init_tsc(void) {
+  if (!has_tsc()) {
+    printk("No TSC, keeping time with the tick\n");
+    return;
+  }
+
+  uint64_t start = read_tsc();
+  pit_wait(CALIBRATION_PIT_COUNTS);
+  uint64_t cycles = read_tsc() - start;
+
+  uint64_t frequency =
+      divide(cycles * PIT_FREQUENCY_NUMERATOR,
+             PIT_FREQUENCY_DENOMINATOR * CALIBRATION_PIT_COUNTS);
+  printk("TSC: %d kHz\n", (uint32_t)divide(frequency, 1000));
+
+  tsc_clocksource.mult =
+      divide((uint64_t)1000000000 << TSC_SHIFT, frequency);
+  register_clocksource(&tsc_clocksource);
+}
+
+} // namespace drivers
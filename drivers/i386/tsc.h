@@ -0,0 +1,13 @@
+#ifndef DRIVERS_I386_TSC_H
+#define DRIVERS_I386_TSC_H
+
+namespace drivers {
+
+// Calibrates the time stamp counter against the PIT and makes it the
+// clocksource, if the CPU has one. This assumes it ticks at a constant rate
+// and is in step across CPUs, like on anything with an invariant TSC.
+void init_tsc(void);
+
+} // namespace drivers
+
+#endif
@@ -7,6 +7,9 @@
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 #include "lib/std/string.h"
+#include "lib/std/time.h"
+#include "proc/kthread.h"
+#include "proc/workqueue.h"
 
 namespace filesystem {
 
@@ -26,7 +29,12 @@ using lib::std::strcat;
 using lib::std::streq;
 using lib::std::strlen;
 using lib::std::substring;
+using lib::std::time;
 using lib::std::trim;
+using proc::cond_resched;
+using proc::delayed_work;
+using proc::init_delayed_work;
+using proc::schedule_delayed_work;
 
 struct __attribute__((packed)) directory_table_entry {
   char filename[11];
@@ -110,7 +118,51 @@ uint32_t cluster_size;     // In bytes
 uint32_t cluster_sectors;  // Size in sectors
 uint32_t root_dir_cluster; // In clusters
 
-uint32_t read_clusters(uint32_t cluster, uint8_t *buf, size_t len) {
+// The FAT is written back a little while after it changes, off the syscall
+// path, so a burst of writes only pays for writing it once
+const struct time FAT_WRITEBACK_DELAY = {0, 500000000};
+struct delayed_work fat_writeback;
+char fat_dirty = 0;
+
+// Files something still reads or writes by inode, like an open file or a
+// transfer that gave up the CPU partway. Deleting one of these only takes its
+// directory entry away. Its clusters are freed with the last pin, so they
+// can't be handed to another file while they're still in use.
+struct pinned_file {
+  uint32_t inode;
+  uint32_t pins;
+  char deleted;
+  struct pinned_file *next;
+};
+struct pinned_file *pinned_files = nullptr;
+
+struct pinned_file *find_pinned_file(uint32_t inode) {
+  struct pinned_file *pinned = pinned_files;
+  while (pinned && pinned->inode != inode) {
+    pinned = pinned->next;
+  }
+  return pinned;
+}
+
+char is_deleted(uint32_t inode) {
+  struct pinned_file *pinned = find_pinned_file(inode);
+  return pinned && pinned->deleted;
+}
+
+// Lets other processes have a turn between clusters of a long transfer or
+// directory listing, then follows the chain on from cluster. The caller pins
+// the file, so the chain stays put even if it's deleted in the meantime.
+uint32_t resched_next_cluster(uint32_t cluster) {
+  cond_resched();
+  uint32_t next_cluster = file_allocation_table[cluster] & 0x0FFFFFFF;
+  return next_cluster ? next_cluster : END_OF_FILE_CLUSTER;
+}
+
+// File contents can be read and written preemptibly, as long as the file is
+// pinned. Directories can't, since they're rewritten whole and a concurrent
+// change in between would be lost.
+uint32_t read_clusters(uint32_t cluster, uint8_t *buf, size_t len,
+                       char preemptible = 0) {
   uint8_t *tmp_buf = (uint8_t *)kmalloc(cluster_size);
   size_t bytes_read = 0;
 
@@ -130,11 +182,13 @@ uint32_t read_clusters(uint32_t cluster, uint8_t *buf, size_t len) {
       buf += cluster_size;
     }
 
-    if ((file_allocation_table[cluster] & 0x0FFFFFFF) >=
-        (uint32_t)END_OF_FILE_CLUSTER) {
+    uint32_t next_cluster = preemptible
+                                ? resched_next_cluster(cluster)
+                                : file_allocation_table[cluster] & 0x0FFFFFFF;
+    if (next_cluster >= (uint32_t)END_OF_FILE_CLUSTER) {
       break;
     } else {
-      cluster = file_allocation_table[cluster] & 0x0FFFFFFF;
+      cluster = next_cluster;
     }
   }
 
@@ -143,7 +197,8 @@ uint32_t read_clusters(uint32_t cluster, uint8_t *buf, size_t len) {
   return bytes_read;
 }
 
-void write_clusters(uint32_t cluster, uint8_t *buf, size_t len) {
+void write_clusters(uint32_t cluster, uint8_t *buf, size_t len,
+                    char preemptible = 0) {
   uint32_t index = 0;
   uint8_t *temp_buf = (uint8_t *)kmalloc(cluster_size);
   do {
@@ -155,7 +210,8 @@ void write_clusters(uint32_t cluster, uint8_t *buf, size_t len) {
     }
     write_sectors(*device, temp_buf, cluster_sectors,
                   cluster_start + (cluster - 2) * cluster_sectors);
-    cluster = file_allocation_table[cluster] & 0x0FFFFFFF;
+    cluster = preemptible ? resched_next_cluster(cluster)
+                          : file_allocation_table[cluster] & 0x0FFFFFFF;
     index += cluster_size;
   } while (index < len && cluster < END_OF_FILE_CLUSTER);
   kfree(temp_buf);
@@ -316,6 +372,8 @@ struct directory_table_entry find_directory_entry(
   size_t table_size = cluster_size;
   struct directory_table_entry *dir_table =
       (struct directory_table_entry *)kmalloc(table_size);
+  // Lookups aren't preemptible, so the cluster a caller gets back is still
+  // the file's when it goes to pin it
   read_clusters(current_cluster, (uint8_t *)dir_table, cluster_size);
   current_cluster = file_allocation_table[current_cluster] & 0x0FFFFFFF;
   while ((current_cluster & 0x0FFFFFFF) < END_OF_FILE_CLUSTER) {
@@ -403,7 +461,12 @@ uint32_t find_cluster(char *path, uint32_t current_cluster = root_dir_cluster) {
   }
 }
 
-void flush_fat(void) {
+void write_back_fat(void *data) {
+  if (!fat_dirty) {
+    return;
+  }
+  fat_dirty = 0;
+
   uint32_t fat_lba = fat_start;
   // There are generally multiple (usually 2) file allocation tables.
   // They are duplicates of each, presumably used to detect corruption.
@@ -414,6 +477,11 @@ void flush_fat(void) {
   }
 }
 
+void flush_fat(void) {
+  fat_dirty = 1;
+  schedule_delayed_work(&fat_writeback, FAT_WRITEBACK_DELAY);
+}
+
 uint32_t alloc_cluster(size_t len, uint32_t search_start = 2) {
   for (int i = search_start; i < fat_size / sizeof(uint32_t); i++) {
     if (!file_allocation_table[i]) {
@@ -442,6 +510,16 @@ void dealloc_clusters(uint32_t cluster) {
   flush_fat();
 }
 
+// Frees a deleted file's clusters, or leaves that to the last unpin
+void release_clusters(uint32_t cluster) {
+  struct pinned_file *pinned = find_pinned_file(cluster);
+  if (pinned) {
+    pinned->deleted = 1;
+  } else {
+    dealloc_clusters(cluster);
+  }
+}
+
 void dealloc_clusters(uint32_t cluster, int num) {
   for (int i = 0; i < num; i++) {
     if ((cluster & 0x0FFFFFFF) >= END_OF_FILE_CLUSTER) {
@@ -623,19 +701,56 @@ void init_fat32(struct ide_device &_device, struct partition &partition) {
   cluster_size = cluster_sectors * sector_size;
   cluster_start = fat_start + fat_sectors * num_fats;
   root_dir_cluster = boot_record.root_dir_pointer;
+
+  init_delayed_work(&fat_writeback, write_back_fat, nullptr);
+}
+
+void sync_fat32(void) { write_back_fat(nullptr); }
+
+void pin_fat32(uint32_t inode) {
+  struct pinned_file *pinned = find_pinned_file(inode);
+  if (!pinned) {
+    pinned = (struct pinned_file *)kmalloc(sizeof(struct pinned_file));
+    pinned->inode = inode;
+    pinned->pins = 0;
+    pinned->deleted = 0;
+    pinned->next = pinned_files;
+    pinned_files = pinned;
+  }
+  pinned->pins++;
+}
+
+void unpin_fat32(uint32_t inode) {
+  struct pinned_file **pinned = &pinned_files;
+  while (*pinned && (*pinned)->inode != inode) {
+    pinned = &(*pinned)->next;
+  }
+  if (!*pinned || --(*pinned)->pins) {
+    return;
+  }
+
+  struct pinned_file *to_free = *pinned;
+  *pinned = to_free->next;
+  if (to_free->deleted) {
+    dealloc_clusters(inode);
+  }
+  kfree(to_free);
 }
 
 char read_fat32(char *path, uint8_t *buf, size_t len) {
   uint32_t cluster = find_cluster(path, root_dir_cluster);
   if (cluster != INVALID_CLUSTER) {
-    read_clusters(cluster, buf, len);
+    pin_fat32(cluster);
+    read_clusters(cluster, buf, len, 1);
+    unpin_fat32(cluster);
     return 1;
   } else {
     return 0;
   }
 }
 
-uint32_t read_fat32(uint32_t inode, uint32_t offset, uint8_t *buf, size_t len) {
+uint32_t read_pinned_fat32(uint32_t inode, uint32_t offset, uint8_t *buf,
+                           size_t len) {
   uint32_t cluster = inode;
   int index;
 
@@ -649,8 +764,12 @@ uint32_t read_fat32(uint32_t inode, uint32_t offset, uint8_t *buf, size_t len) {
     return 0;
   }
 
+  // Read up to the end of the requested range within the first cluster, not
+  // just len bytes from its start.
   uint8_t *temp_buf = (uint8_t *)kmalloc(cluster_size);
-  size_t read_len = len < cluster_size ? len : cluster_size;
+  size_t read_len = len + (offset - index) < cluster_size
+                        ? len + (offset - index)
+                        : cluster_size;
   uint32_t temp_len = read_clusters(cluster, temp_buf, read_len);
   for (int i = offset - index; i < temp_len; i++) {
     *buf = temp_buf[i];
@@ -665,12 +784,20 @@ uint32_t read_fat32(uint32_t inode, uint32_t offset, uint8_t *buf, size_t len) {
   if (len > temp_len - (offset - index)) {
     len -= temp_len - (offset - index);
 
-    return (temp_len - (offset - index)) + read_clusters(cluster, buf, len);
+    return (temp_len - (offset - index)) +
+           read_clusters(cluster, buf, len, 1);
   } else {
     return len;
   }
 }
 
+uint32_t read_fat32(uint32_t inode, uint32_t offset, uint8_t *buf, size_t len) {
+  pin_fat32(inode);
+  uint32_t ret = read_pinned_fat32(inode, offset, buf, len);
+  unpin_fat32(inode);
+  return ret;
+}
+
 struct directory_entry stat_fat32(char *path) {
   struct directory_entry ret;
 
@@ -713,19 +840,22 @@ struct directory ls_fat32(char *path) {
     return ret;
   }
 
+  uint32_t dir_cluster = current_cluster;
+  pin_fat32(dir_cluster);
   size_t table_size = cluster_size;
   struct directory_table_entry *dir_table =
       (struct directory_table_entry *)kmalloc(table_size);
   read_clusters(current_cluster, (uint8_t *)dir_table, cluster_size);
-  current_cluster = file_allocation_table[current_cluster] & 0x0FFFFFFF;
+  current_cluster = resched_next_cluster(current_cluster);
   while ((current_cluster & 0x0FFFFFFF) < END_OF_FILE_CLUSTER) {
     table_size += cluster_size;
     dir_table = (struct directory_table_entry *)krealloc(dir_table, table_size);
     read_clusters(current_cluster,
                   (uint8_t *)dir_table + table_size - cluster_size,
                   cluster_size);
-    current_cluster = file_allocation_table[current_cluster] & 0x0FFFFFFF;
+    current_cluster = resched_next_cluster(current_cluster);
   }
+  unpin_fat32(dir_cluster);
 
   uint32_t num_children = 0;
   for (int i = 0; i < table_size / sizeof(struct directory_table_entry); i++) {
@@ -788,7 +918,9 @@ uint32_t write_new_fat32(char *path, uint8_t attributes, uint8_t *buf,
   }
 
   if (add_directory_entry(dir_path, name, attributes, len, cluster)) {
-    write_clusters(cluster, buf, len);
+    pin_fat32(cluster);
+    write_clusters(cluster, buf, len, 1);
+    unpin_fat32(cluster);
     kfree(dir_path);
     kfree(name);
     return cluster;
@@ -827,14 +959,11 @@ char update_file_length(char *path, size_t new_len) {
   return 0;
 }
 
-uint32_t write_fat32(char *path, uint32_t offset, uint8_t *buf, size_t len) {
-  uint32_t cluster = find_cluster(path, root_dir_cluster);
+uint32_t write_pinned_fat32(char *path, uint32_t inode, uint32_t offset,
+                            uint8_t *buf, size_t len) {
+  uint32_t cluster = inode;
   uint32_t last_cluster = cluster;
 
-  if ((cluster & 0x0FFFFFFF) >= END_OF_FILE_CLUSTER) {
-    return 0;
-  }
-
   uint64_t index = 0;
   for (index; index + cluster_size <= offset &&
               (cluster & 0x0FFFFFFF) < END_OF_FILE_CLUSTER;
@@ -845,9 +974,16 @@ uint32_t write_fat32(char *path, uint32_t offset, uint8_t *buf, size_t len) {
 
   for (index; index < offset + len; index += cluster_size) {
     if ((cluster & 0x0FFFFFFF) >= END_OF_FILE_CLUSTER) {
+      // The file was deleted while we were preempted, so path may well be
+      // somebody else's by now
+      if (is_deleted(inode)) {
+        return 0;
+      }
+
       // Pure append operation
       uint32_t new_cluster = alloc_cluster(len + offset - index);
-      write_clusters(new_cluster, buf + index - offset, len + offset - index);
+      write_clusters(new_cluster, buf + index - offset, len + offset - index,
+                     1);
       file_allocation_table[last_cluster] = new_cluster;
       flush_fat();
       uint32_t new_file_len = len + offset;
@@ -875,12 +1011,24 @@ uint32_t write_fat32(char *path, uint32_t offset, uint8_t *buf, size_t len) {
     }
 
     last_cluster = cluster;
-    cluster = file_allocation_table[cluster] & 0x0FFFFFFF;
+    cluster = resched_next_cluster(cluster);
   }
 
   return 1;
 }
 
+uint32_t write_fat32(char *path, uint32_t offset, uint8_t *buf, size_t len) {
+  uint32_t inode = find_cluster(path, root_dir_cluster);
+  if ((inode & 0x0FFFFFFF) >= END_OF_FILE_CLUSTER) {
+    return 0;
+  }
+
+  pin_fat32(inode);
+  uint32_t ret = write_pinned_fat32(path, inode, offset, buf, len);
+  unpin_fat32(inode);
+  return ret;
+}
+
 char mkdir_fat32(char *path) {
   del_fat32(path);
 
@@ -1014,7 +1162,7 @@ char del_fat32(char *path) {
   }
 
   uint32_t file_cluster = convert_cluster(dir_table[dir_entry_index]);
-  dealloc_clusters(file_cluster);
+  release_clusters(file_cluster);
 
   dir_table[dir_entry_index].filename[0] = DELETED_DIR_ENTRY;
   for (int i = dir_entry_index - 1; i >= 0; i--) {
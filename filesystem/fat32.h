@@ -62,8 +62,20 @@ uint32_t write_fat32(char *path, uint32_t offset, uint8_t *buf, size_t len);
 // Returns 1 on success, 0 otherwise
 char mkdir_fat32(char *path);
 
+// Writes anything that's waiting to be written back to the disk
+void sync_fat32(void);
+
+// Keeps the clusters of the file indicated by inode allocated until it's
+// unpinned, even if it's deleted in the meantime. Pins nest.
+void pin_fat32(uint32_t inode);
+
+// Drops a pin, freeing the file's clusters if it was the last one and the file
+// has been deleted
+void unpin_fat32(uint32_t inode);
+
 // Deletes a file
-// Note that this will not 0 the file, so it could be recoverable
+// Note that this will not 0 the file, so it could be recoverable. The clusters
+// of a pinned file are only freed when it's unpinned.
 char del_fat32(char *path);
 
 } // namespace filesystem
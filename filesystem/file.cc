@@ -24,12 +24,14 @@ void load_file(struct file *file) {
   file->size = file_stats.size;
 
   file->read_write_pipe = nullptr;
+  file->timerfd = nullptr;
 
   file->num_references = 1;
 
   if (file_stats.name) {
     kfree(file_stats.name);
     file->inode = file_stats.inode;
+    pin_fat32(file->inode);
   } else {
     file->inode = 0;
   }
@@ -9,6 +9,7 @@ namespace filesystem {
 struct file_mapping {
   void *mapping;
   size_t mapping_len;
+  size_t file_len; // Bytes past this are zero filled instead of read from disk
   uint32_t offset;
   struct file *file;
   char is_private;
@@ -17,6 +18,7 @@ struct file_mapping {
 };
 
 struct pipe;
+struct timerfd;
 
 struct file_descriptor {
   uint32_t num;
@@ -29,7 +31,8 @@ struct file {
   char *path;
   char *buffer; // Exclusively used for directories
   struct pipe *read_write_pipe;
-  uint32_t inode; // Actually just cluster num
+  struct timerfd *timerfd; // Only set for timerfd_create's files
+  uint32_t inode; // Actually just cluster num, pinned while the file is open
   uint32_t size;
   uint32_t offset;
   int num_references;
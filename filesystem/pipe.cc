@@ -3,6 +3,7 @@
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 #include "proc/process.h"
+#include "proc/wait_queue.h"
 
 namespace filesystem {
 
@@ -12,76 +13,122 @@ using arch::memory::virtual_to_physical;
 using arch::memory::virtual_to_virtual_memcpy;
 using lib::std::kfree;
 using lib::std::kmalloc;
+using proc::first_waiter;
+using proc::init_wait_reason;
 using proc::process;
-using proc::RUNNABLE;
+using proc::wait_on;
 using proc::wait_reason;
+using proc::wake_waiter_handoff;
 using proc::WAITING;
 
+// Buffers as much as fits and returns how much that was
+uint32_t fill_buffer(struct pipe *to_fill, uint32_t *page_dir, uint8_t *buf,
+                     uint32_t size) {
+  uint32_t filled = 0;
+  while (filled < size &&
+         (to_fill->write_index + 1) % PIPE_MAX_SIZE != to_fill->read_index) {
+    to_fill->buf[to_fill->write_index] =
+        *(uint8_t *)virtual_to_physical(page_dir, buf + filled);
+    to_fill->write_index = (to_fill->write_index + 1) % PIPE_MAX_SIZE;
+    filled++;
+  }
+  return filled;
+}
+
+// Moves a finished wait on to the next iovec of its readv. Returns 0 if there
+// aren't any left.
+char next_read_segment(struct pipe_read_wait *wait) {
+  struct pipe_read_wait *next = (struct pipe_read_wait *)wait->chained;
+  if (!next) {
+    return 0;
+  }
+
+  wait->buf = next->buf;
+  wait->index = next->index;
+  wait->len = next->len;
+  wait->chained = next->chained;
+  kfree(next);
+  return 1;
+}
+
+char next_write_segment(struct pipe_write_wait *wait) {
+  struct pipe_write_wait *next = (struct pipe_write_wait *)wait->chained;
+  if (!next) {
+    return 0;
+  }
+
+  wait->buf = next->buf;
+  wait->index = next->index;
+  wait->len = next->len;
+  wait->chained = next->chained;
+  kfree(next);
+  return 1;
+}
+
 } // namespace
 
 void write_to_pipe(struct process *current_process, struct pipe *write_pipe,
                    uint8_t *buf, uint32_t size) {
   uint32_t *page_dir = current_process->page_dir;
 
+  // If an earlier iovec of this writev already blocked, the rest have to
+  // wait behind it
+  struct pipe_write_wait *blocked =
+      (struct pipe_write_wait *)current_process->wait;
+  if (size && current_process->process_state == WAITING &&
+      blocked->type == PIPE_WRITE_WAIT && blocked->to_write == write_pipe) {
+    struct wait_reason *last = blocked;
+    while (last->chained) {
+      last = last->chained;
+    }
+    struct pipe_write_wait *segment =
+        (struct pipe_write_wait *)kmalloc(sizeof(struct pipe_write_wait));
+    init_wait_reason(segment, PIPE_WRITE_WAIT, current_process);
+    segment->to_write = write_pipe;
+    segment->buf = buf;
+    segment->index = 0;
+    segment->len = size;
+    last->chained = segment;
+    return;
+  }
+
   // If someone is waiting on this information, write directly to them
-  if (write_pipe->read_wait && size) {
-    struct pipe_read_wait *read_wait = write_pipe->read_wait;
+  struct pipe_read_wait *read_wait;
+  while (size && (read_wait = (struct pipe_read_wait *)first_waiter(
+                      &write_pipe->readers))) {
     uint32_t max_read_size = read_wait->len - read_wait->index;
     uint32_t read_size = size < max_read_size ? size : max_read_size;
-    uint32_t *read_client_page_dir = read_wait->client->page_dir;
+    uint32_t *read_client_page_dir = read_wait->queue_entry.waiter->page_dir;
 
     virtual_to_virtual_memcpy(page_dir, read_client_page_dir, (char *)buf,
                               (char *)read_wait->buf + read_wait->index,
                               read_size);
 
+    size -= read_size;
+    buf += read_size;
+
     // Unblock reading process if it's satisfied
     read_wait->index += read_size;
-    if (read_wait->len == read_wait->index) {
-      read_wait->client->process_state = RUNNABLE;
-      kfree(read_wait);
-      current_process->wait = nullptr;
-      write_pipe->read_wait = nullptr;
+    if (read_wait->len == read_wait->index && !next_read_segment(read_wait)) {
+      wake_waiter_handoff(read_wait);
     }
-
-    size -= read_size;
-    buf += read_size;
   }
 
   // Buffer as much as we can
-  while (size && (write_pipe->write_index + 1) % PIPE_MAX_SIZE !=
-                     write_pipe->read_index) {
-    write_pipe->buf[write_pipe->write_index] =
-        *(uint8_t *)virtual_to_physical(page_dir, buf);
-    buf++;
-    write_pipe->write_index = (write_pipe->write_index + 1) % PIPE_MAX_SIZE;
-    size--;
-  }
+  uint32_t buffered = fill_buffer(write_pipe, page_dir, buf, size);
+  buf += buffered;
+  size -= buffered;
 
   // If the buf is full, then block
   if (size) {
     struct pipe_write_wait *write_wait =
         (struct pipe_write_wait *)kmalloc(sizeof(struct pipe_write_wait));
-    write_wait->type = PIPE_WRITE_WAIT;
+    init_wait_reason(write_wait, PIPE_WRITE_WAIT, current_process);
     write_wait->to_write = write_pipe;
-    write_wait->client = current_process;
     write_wait->buf = buf;
     write_wait->index = 0;
     write_wait->len = size;
-    write_wait->next = nullptr;
-
-    if (!write_pipe->write_wait) {
-      write_pipe->write_wait = write_wait;
-      current_process->wait = write_pipe->write_wait;
-      current_process->process_state = WAITING;
-    } else {
-      // Chain this new wait to the end of the wait list.
-      // Mostly used to support writev.
-      struct pipe_write_wait *current_write_wait = write_pipe->write_wait;
-      while (current_write_wait->next) {
-        current_write_wait = current_write_wait->next;
-      }
-      current_write_wait->next = write_wait;
-    }
+    wait_on(&write_pipe->writers, write_wait);
   }
 }
 
@@ -89,6 +136,27 @@ void read_from_pipe(struct process *current_process, struct pipe *read_pipe,
                     uint8_t *buf, uint32_t size) {
   uint32_t *page_dir = current_process->page_dir;
 
+  // If an earlier iovec of this readv already blocked, the rest have to wait
+  // behind it
+  struct pipe_read_wait *blocked =
+      (struct pipe_read_wait *)current_process->wait;
+  if (size && current_process->process_state == WAITING &&
+      blocked->type == PIPE_READ_WAIT && blocked->to_read == read_pipe) {
+    struct wait_reason *last = blocked;
+    while (last->chained) {
+      last = last->chained;
+    }
+    struct pipe_read_wait *segment =
+        (struct pipe_read_wait *)kmalloc(sizeof(struct pipe_read_wait));
+    init_wait_reason(segment, PIPE_READ_WAIT, current_process);
+    segment->to_read = read_pipe;
+    segment->buf = buf;
+    segment->index = 0;
+    segment->len = size;
+    last->chained = segment;
+    return;
+  }
+
   // Read from the buf until it's empty
   while (size && read_pipe->read_index != read_pipe->write_index) {
     *(uint8_t *)virtual_to_physical(page_dir, buf) =
@@ -98,52 +166,35 @@ void read_from_pipe(struct process *current_process, struct pipe *read_pipe,
     size--;
   }
 
-  // Re-buf the writing process, and possibly read from it
-  while (read_pipe->write_wait) {
-    struct pipe_write_wait *write_wait = read_pipe->write_wait;
+  // Read straight from blocked writers, then re-buf whatever's left of them
+  struct pipe_write_wait *write_wait;
+  while ((write_wait = (struct pipe_write_wait *)first_waiter(
+              &read_pipe->writers))) {
+    uint32_t *write_client_page_dir = write_wait->queue_entry.waiter->page_dir;
     if (size) {
       uint32_t max_read_size = write_wait->len - write_wait->index;
       uint32_t read_size = size < max_read_size ? size : max_read_size;
-      uint32_t *write_client_page_dir = write_wait->client->page_dir;
 
-      virtual_to_virtual_memcpy(write_client_page_dir, page_dir, (char *)buf,
+      virtual_to_virtual_memcpy(write_client_page_dir, page_dir,
                                 (char *)write_wait->buf + write_wait->index,
-                                read_size);
+                                (char *)buf, read_size);
 
       size -= read_size;
       buf += read_size;
       write_wait->index += read_size;
     }
 
-    uint32_t write_index = write_wait->index;
-    uint32_t write_len = write_wait->len;
-    struct process *write_process = write_wait->client;
-    uint8_t *write_buf = write_wait->buf;
-
-    if (write_len == write_index) {
-      read_pipe->write_wait = read_pipe->write_wait->next;
-      write_process->wait = read_pipe->write_wait;
-      kfree(write_wait);
-      if (!write_process->wait) {
-        write_process->process_state = RUNNABLE;
-      }
-    } else {
-      // We go through this function again to handle the bufing logic
-      read_pipe->write_wait = nullptr;
-      write_process->wait = nullptr;
-      write_process->process_state = RUNNABLE;
-      write_to_pipe(write_process, read_pipe, write_buf + write_index,
-                    write_len - write_index);
-      if (read_pipe->write_wait) {
-        // Buffer filled. Merge the write waits into the new list;
-        read_pipe->write_wait->next = write_wait->next;
-        kfree(write_wait);
-        break;
-      } else {
-        read_pipe->write_wait = write_wait->next;
-        write_process->wait = write_wait->next;
-      }
-      kfree(write_wait);
+    write_wait->index +=
+        fill_buffer(read_pipe, write_client_page_dir,
+                    write_wait->buf + write_wait->index,
+                    write_wait->len - write_wait->index);
+    if (write_wait->index < write_wait->len) {
+      // Buffer filled
+      break;
+    }
+
+    if (!next_write_segment(write_wait)) {
+      wake_waiter_handoff(write_wait);
     }
   }
 
@@ -151,17 +202,12 @@ void read_from_pipe(struct process *current_process, struct pipe *read_pipe,
   if (size) {
     struct pipe_read_wait *read_wait =
         (struct pipe_read_wait *)kmalloc(sizeof(struct pipe_read_wait));
-    read_wait->type = PIPE_READ_WAIT;
+    init_wait_reason(read_wait, PIPE_READ_WAIT, current_process);
     read_wait->to_read = read_pipe;
-    read_wait->client = current_process;
     read_wait->buf = buf;
     read_wait->index = 0;
     read_wait->len = size;
-
-    read_pipe->read_wait = read_wait;
-
-    current_process->wait = read_wait;
-    current_process->process_state = WAITING;
+    wait_on(&read_pipe->readers, read_wait);
   }
 }
 
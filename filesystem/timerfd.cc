@@ -0,0 +1,129 @@
+#include "filesystem/timerfd.h"
+#include "arch/i386/memory/paging.h"
+#include "lib/std/memory.h"
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/process.h"
+#include "proc/wait_queue.h"
+
+namespace filesystem {
+
+namespace {
+
+using arch::memory::physical_to_virtual_memcpy;
+using lib::std::add_time;
+using lib::std::add_timer;
+using lib::std::cancel_timer;
+using lib::std::init_timer;
+using lib::std::kfree;
+using lib::std::kmalloc;
+using lib::std::subtract_time;
+using lib::std::system_time;
+using lib::std::time_before;
+using lib::std::update_system_time;
+using proc::first_waiter;
+using proc::init_wait_queue;
+using proc::init_wait_reason;
+using proc::wait_on;
+using proc::wake_waiter;
+
+// What read returns instead of blocking on a nonblocking timerfd
+constexpr uint32_t EAGAIN = -11;
+
+void timerfd_expired(void *data) {
+  struct timerfd *expired = (struct timerfd *)data;
+  expired->expirations++;
+
+  if (expired->interval.seconds || expired->interval.nanoseconds) {
+    // Count the periods we were too late for instead of firing them all
+    expired->timer.expires =
+        add_time(expired->timer.expires, expired->interval);
+    while (!time_before(system_time, expired->timer.expires)) {
+      expired->expirations++;
+      expired->timer.expires =
+          add_time(expired->timer.expires, expired->interval);
+    }
+    add_timer(&expired->timer);
+  }
+
+  // A blocked reader gets the count straight away
+  struct timerfd_read_wait *wait =
+      (struct timerfd_read_wait *)first_waiter(&expired->readers);
+  if (wait) {
+    physical_to_virtual_memcpy(wait->queue_entry.waiter->page_dir,
+                               (char *)&expired->expirations, (char *)wait->buf,
+                               sizeof(uint64_t));
+    expired->expirations = 0;
+    wake_waiter(wait);
+  }
+}
+
+} // namespace
+
+struct timerfd *create_timerfd(uint32_t clock_id, char nonblocking) {
+  struct timerfd *new_timerfd =
+      (struct timerfd *)kmalloc(sizeof(struct timerfd));
+  init_timer(&new_timerfd->timer, timerfd_expired, new_timerfd);
+  new_timerfd->interval.seconds = 0;
+  new_timerfd->interval.nanoseconds = 0;
+  new_timerfd->clock_id = clock_id;
+  new_timerfd->expirations = 0;
+  init_wait_queue(&new_timerfd->readers);
+  new_timerfd->nonblocking = nonblocking;
+  return new_timerfd;
+}
+
+void arm_timerfd(struct timerfd *to_arm, const struct time &expires,
+                 const struct time &interval) {
+  cancel_timer(&to_arm->timer);
+  to_arm->expirations = 0;
+  to_arm->interval = interval;
+  if (expires.seconds || expires.nanoseconds) {
+    to_arm->timer.expires = expires;
+    add_timer(&to_arm->timer);
+  }
+}
+
+struct time timerfd_remaining(struct timerfd *to_check) {
+  struct time ret = {0, 0};
+  if (to_check->timer.pending) {
+    update_system_time();
+    ret = subtract_time(to_check->timer.expires, system_time);
+  }
+  return ret;
+}
+
+uint32_t read_from_timerfd(struct process *current_process,
+                           struct timerfd *to_read, uint8_t *buf,
+                           uint32_t size) {
+  if (size < sizeof(uint64_t)) {
+    return -1;
+  }
+
+  if (to_read->expirations) {
+    physical_to_virtual_memcpy(current_process->page_dir,
+                               (char *)&to_read->expirations, (char *)buf,
+                               sizeof(uint64_t));
+    to_read->expirations = 0;
+    return sizeof(uint64_t);
+  }
+
+  if (to_read->nonblocking) {
+    return EAGAIN;
+  }
+
+  struct timerfd_read_wait *wait =
+      (struct timerfd_read_wait *)kmalloc(sizeof(struct timerfd_read_wait));
+  init_wait_reason(wait, TIMERFD_READ_WAIT, current_process);
+  wait->buf = buf;
+  wait_on(&to_read->readers, wait);
+
+  return sizeof(uint64_t);
+}
+
+void free_timerfd(struct timerfd *to_free) {
+  cancel_timer(&to_free->timer);
+  kfree(to_free);
+}
+
+} // namespace filesystem
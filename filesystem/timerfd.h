@@ -0,0 +1,57 @@
+#ifndef FILESYSTEM_TIMERFD_H
+#define FILESYSTEM_TIMERFD_H
+
+#include <stdint.h>
+
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/process.h"
+
+namespace filesystem {
+
+namespace {
+
+using lib::std::time;
+using lib::std::timer;
+using proc::process;
+using proc::wait_queue;
+using proc::wait_reason;
+
+} // namespace
+
+constexpr uint32_t TIMERFD_READ_WAIT = 0x8;
+
+// A timer read through a file descriptor. Reads return how many times it's
+// gone off since the last read, and block until it has.
+struct timerfd {
+  struct timer timer;
+  struct time interval; // Zero for a one shot
+  uint32_t clock_id;
+  uint64_t expirations;
+  struct wait_queue readers;
+  char nonblocking;
+};
+
+struct timerfd_read_wait : wait_reason {
+  uint8_t *buf; // Virtual address space
+};
+
+struct timerfd *create_timerfd(uint32_t clock_id, char nonblocking);
+
+// Arms the timer to go off at expires, then every interval after. A zero
+// expires disarms it. Either way the expiration count starts over.
+void arm_timerfd(struct timerfd *to_arm, const struct time &expires,
+                 const struct time &interval);
+
+// Returns how long until it goes off, or zero if it's disarmed
+struct time timerfd_remaining(struct timerfd *to_check);
+
+uint32_t read_from_timerfd(struct process *current_process,
+                           struct timerfd *to_read, uint8_t *buf,
+                           uint32_t size);
+
+void free_timerfd(struct timerfd *to_free);
+
+} // namespace filesystem
+
+#endif
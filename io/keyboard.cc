@@ -2,6 +2,7 @@
 #include "arch/i386/memory/paging.h"
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
+#include "proc/wait_queue.h"
 
 namespace io {
 
@@ -9,15 +10,16 @@ namespace {
 
 using arch::memory::virtual_to_physical;
 using lib::std::getc;
-using lib::std::kfree;
 using lib::std::putc;
-using proc::get_currently_executing_process;
-using proc::process;
-using proc::RUNNABLE;
-using proc::WAITING;
+using proc::first_waiter;
+using proc::wait_on;
+using proc::wait_queue;
+using proc::wake_waiter;
 
 volatile uint8_t pressed_keys[128] = {0};
 
+struct wait_queue keyboard_waiters = {nullptr, nullptr};
+
 const char ascii_keycodes_translation[128] = {
     0,   0,    '1',  '2', '3',  '4', '5', '6', '7', '8', '9', '0', '-',
     '=', '\b', '\t', 'q', 'w',  'e', 'r', 't', 'y', 'u', 'i', 'o', 'p',
@@ -32,42 +34,36 @@ const char ascii_keycodes_translation[128] = {
 
 } // namespace
 
+void wait_for_keyboard(struct keyboard_wait *wait) {
+  wait_on(&keyboard_waiters, wait);
+}
+
 void key_press(uint8_t keycode) {
   pressed_keys[keycode] = 1;
 
   // Find out if someone's waiting on this keypress
-  struct process *proc = get_currently_executing_process();
-  if (proc) {
-    struct process *current_proc = proc;
-    do {
-      if (current_proc->process_state == WAITING &&
-          current_proc->wait->type == KEYBOARD_WAIT) {
-        struct keyboard_wait *wait = (struct keyboard_wait *)current_proc->wait;
-        uint32_t *page_dir = current_proc->page_dir;
-        while (wait->index < wait->len) {
-          char c = getc();
-          if (c) {
-            // Echo keystroke
-            putc(c);
-
-            *(char *)virtual_to_physical(page_dir, wait->buf + wait->index) = c;
-            wait->index++;
-
-            if (c == '\n') {
-              break;
-            }
-          } else {
-            return;
-          }
+  struct keyboard_wait *wait =
+      (struct keyboard_wait *)first_waiter(&keyboard_waiters);
+  if (wait) {
+    uint32_t *page_dir = wait->queue_entry.waiter->page_dir;
+    while (wait->index < wait->len) {
+      char c = getc();
+      if (c) {
+        // Echo keystroke
+        putc(c);
+
+        *(char *)virtual_to_physical(page_dir, wait->buf + wait->index) = c;
+        wait->index++;
+
+        if (c == '\n') {
+          break;
         }
-        current_proc->process_state = RUNNABLE;
-        kfree(current_proc->wait);
-        current_proc->wait = nullptr;
+      } else {
         return;
       }
+    }
 
-      current_proc = current_proc->next;
-    } while (current_proc != proc);
+    wake_waiter(wait);
   }
 }
 
@@ -8,6 +8,7 @@
 
 namespace io {
 
+using proc::process;
 using proc::wait_reason;
 
 constexpr uint32_t KEYBOARD_WAIT = 0x1;
@@ -23,6 +24,9 @@ struct key_presses {
   uint8_t keycodes[128];
 };
 
+// Parks a process until a line of input arrives. Waiters are served in order.
+void wait_for_keyboard(struct keyboard_wait *wait);
+
 void key_press(uint8_t keycode);
 
 void key_release(uint8_t keycode);
@@ -34,6 +34,33 @@ inline uint64_t divide(uint64_t lhs, uint64_t rhs) {
   return ret;
 }
 
+// Returns (lhs * rhs) >> shift, keeping the high bits of the 96 bit product.
+// It only takes two hardware multiplies, so it's the fast way to scale by a
+// fraction. shift has to be 32 or less.
+inline uint64_t multiply_shift(uint64_t lhs, uint32_t rhs, uint32_t shift) {
+  uint64_t low = (uint64_t)(uint32_t)lhs * rhs;
+  uint64_t high = (uint64_t)(uint32_t)(lhs >> 32) * rhs;
+  return (low >> shift) + (high << (32 - shift));
+}
+
+// Divides with the hardware divide instruction, so it's much faster than
+// divide but only takes a 32 bit divisor. Dividing the high half first keeps
+// the second divide from overflowing.
+inline uint64_t divide_by_u32(uint64_t lhs, uint32_t rhs,
+                              uint32_t *remainder = nullptr) {
+  uint32_t high = lhs >> 32;
+  uint32_t quotient_high = high / rhs;
+  uint32_t quotient_low;
+  uint32_t rem = high % rhs;
+  asm("divl %4"
+      : "=a"(quotient_low), "=d"(rem)
+      : "a"((uint32_t)lhs), "d"(rem), "rm"(rhs));
+  if (remainder) {
+    *remainder = rem;
+  }
+  return ((uint64_t)quotient_high << 32) | quotient_low;
+}
+
 } // namespace lib
 
 #endif
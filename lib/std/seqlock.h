@@ -0,0 +1,47 @@
+#ifndef LIB_STD_SEQLOCK_H
+#define LIB_STD_SEQLOCK_H
+
+#include <stdint.h>
+
+namespace lib {
+namespace std {
+
+// Lets readers go without a lock, for data that changes rarely compared to how
+// often it's read. The sequence is odd while a write is in progress, and
+// readers retry if it changed underneath them. Writers have to be serialized
+// some other way, like the kernel lock.
+struct seqcount {
+  volatile uint32_t sequence;
+};
+
+static inline void write_seqcount_begin(struct seqcount *seq) {
+  seq->sequence++;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void write_seqcount_end(struct seqcount *seq) {
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  seq->sequence++;
+}
+
+// Returns the sequence to hand to read_seqcount_retry, waiting out any write
+static inline uint32_t read_seqcount_begin(const struct seqcount *seq) {
+  uint32_t sequence;
+  while ((sequence = seq->sequence) & 1) {
+    asm volatile("pause");
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return sequence;
+}
+
+// Returns 1 if anything read since read_seqcount_begin might be torn
+static inline char read_seqcount_retry(const struct seqcount *seq,
+                                       uint32_t sequence) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return seq->sequence != sequence;
+}
+
+} // namespace std
+} // namespace lib
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef LIB_STD_SPINLOCK_H
+#define LIB_STD_SPINLOCK_H
+
+#include <stdint.h>
+
+namespace lib {
+namespace std {
+
+struct spinlock {
+  volatile uint32_t locked;
+};
+
+// Busy waits for the lock. Callers should have interrupts disabled, or an
+// interrupt handler that wants the same lock will spin forever.
+static inline void spin_lock(struct spinlock *lock) {
+  while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+    // Wait for it to look free before trying again, so we don't keep
+    // stealing the cache line from whoever holds it
+    while (lock->locked) {
+      asm volatile("pause");
+    }
+  }
+}
+
+static inline void spin_unlock(struct spinlock *lock) {
+  __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+} // namespace std
+} // namespace lib
+
+#endif
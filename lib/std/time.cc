@@ -1,17 +1,127 @@
 #include "lib/std/time.h"
+#include "lib/math.h"
 
 namespace lib {
 namespace std {
 
+namespace {
+
+constexpr uint32_t NANOSECONDS_PER_SECOND = 1000000000;
+
+struct clocksource *current_clocksource = nullptr;
+
+// Keeps the vDSO's copy of the time current
+void publish_time(void) {
+  write_seqcount_begin(&clock_data.seq);
+  clock_data.coarse_time = system_time;
+  clock_data.boot_time = boot_time;
+  write_seqcount_end(&clock_data.seq);
+}
+
+} // namespace
+
 struct time system_time = {0};
+struct time boot_time = {0};
+struct clock_data clock_data;
+
+void register_clocksource(struct clocksource *source) {
+  write_seqcount_begin(&clock_data.seq);
+  clock_data.vdso_mode = source->vdso_mode;
+  clock_data.mult = source->mult;
+  clock_data.shift = source->shift;
+  clock_data.clocksource_start = source->read();
+  clock_data.clocksource_start_nanos =
+      (uint64_t)system_time.seconds * NANOSECONDS_PER_SECOND +
+      system_time.nanoseconds;
+  clock_data.coarse_time = system_time;
+  clock_data.boot_time = boot_time;
+  write_seqcount_end(&clock_data.seq);
+
+  current_clocksource = source;
+}
+
+struct time read_clock(void) {
+  if (!current_clocksource) {
+    return system_time;
+  }
+
+  // Only the kernel writes clock_data, with the kernel lock held, so there's
+  // no need for the sequence here
+  uint64_t counts =
+      current_clocksource->read() - clock_data.clocksource_start;
+  uint64_t nanos = clock_data.clocksource_start_nanos +
+                   multiply_shift(counts, clock_data.mult, clock_data.shift);
+
+  struct time ret;
+  ret.seconds = divide_by_u32(nanos, NANOSECONDS_PER_SECOND, &ret.nanoseconds);
+  return ret;
+}
+
+char sync_clock(void) {
+  if (!current_clocksource) {
+    return 0;
+  }
+
+  // Other CPUs' counters can be slightly behind, but system_time can't go
+  // backwards
+  struct time now = read_clock();
+  if (time_before(system_time, now)) {
+    system_time = now;
+    publish_time();
+  }
+  return 1;
+}
 
 void tick(struct time &tick_len) {
+  if (sync_clock()) {
+    return;
+  }
+
   system_time.seconds += tick_len.seconds;
   system_time.nanoseconds += tick_len.nanoseconds;
   if (system_time.nanoseconds > 1000000000) {
     system_time.seconds++;
     system_time.nanoseconds = system_time.nanoseconds % 1000000000;
   }
+  publish_time();
+}
+
+char time_before(const struct time &a, const struct time &b) {
+  return a.seconds < b.seconds ||
+         (a.seconds == b.seconds && a.nanoseconds < b.nanoseconds);
+}
+
+struct time add_time(const struct time &a, const struct time &b) {
+  struct time ret;
+  ret.seconds = a.seconds + b.seconds;
+  ret.nanoseconds = a.nanoseconds + b.nanoseconds;
+  if (ret.nanoseconds >= 1000000000) {
+    ret.seconds++;
+    ret.nanoseconds -= 1000000000;
+  }
+  return ret;
+}
+
+struct time subtract_time(const struct time &a, const struct time &b) {
+  struct time ret;
+  if (time_before(a, b)) {
+    ret.seconds = 0;
+    ret.nanoseconds = 0;
+    return ret;
+  }
+
+  ret.seconds = a.seconds - b.seconds;
+  if (a.nanoseconds < b.nanoseconds) {
+    ret.seconds--;
+    ret.nanoseconds = a.nanoseconds + 1000000000 - b.nanoseconds;
+  } else {
+    ret.nanoseconds = a.nanoseconds - b.nanoseconds;
+  }
+  return ret;
+}
+
+uint64_t time_to_nanos(const struct time &a) {
+  return (uint64_t)a.seconds * 1000000000 + a.nanoseconds;
 }
 
 } // namespace std
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "lib/std/seqlock.h"
+
 namespace lib {
 namespace std {
 
@@ -11,10 +13,70 @@ struct time {
   uint32_t nanoseconds;
 };
 
+// Time since boot. Timers and the scheduler all go by this.
 extern struct time system_time;
 
+// Wall clock time at boot, for turning system_time into the real time
+extern struct time boot_time;
+
+// How the vDSO can read a clocksource from userspace
+constexpr uint32_t VDSO_CLOCK_NONE = 0; // It has to make a syscall
+constexpr uint32_t VDSO_CLOCK_TSC = 1;
+
+// A free running counter that time can be read from between ticks
+struct clocksource {
+  uint64_t (*read)(void);
+
+  // Nanoseconds are (counts * mult) >> shift
+  uint32_t mult;
+  uint32_t shift;
+
+  uint32_t vdso_mode;
+};
+
+// Everything needed to read the clocks. It fills a page of its own, so it can
+// be mapped read only into every process for the vDSO to read.
+struct __attribute__((aligned(4096))) clock_data {
+  struct seqcount seq;
+
+  // The clocksource as of when it took over, and the time then
+  uint32_t vdso_mode;
+  uint32_t mult;
+  uint32_t shift;
+  uint64_t clocksource_start;
+  uint64_t clocksource_start_nanos;
+
+  // Copies of system_time and boot_time
+  struct time coarse_time;
+  struct time boot_time;
+};
+
+extern struct clock_data clock_data;
+
+// Takes over timekeeping from the tick, starting from the current
+// system_time
+void register_clocksource(struct clocksource *source);
+
+// Returns the time since boot as precisely as the clocksource allows, or
+// system_time without one
+struct time read_clock(void);
+
+// Moves system_time up to the clocksource. Returns 0 without a clocksource.
+char sync_clock(void);
+
+// Advances system_time by tick_len, or up to the clocksource if there is one
 void tick(struct time &tick_len);
 
+// Returns 1 if a is strictly earlier than b
+char time_before(const struct time &a, const struct time &b);
+
+struct time add_time(const struct time &a, const struct time &b);
+
+// Returns a - b, or zero if b is later
+struct time subtract_time(const struct time &a, const struct time &b);
+
+uint64_t time_to_nanos(const struct time &a);
+
 } // namespace std
 } // namespace lib
 
@@ -0,0 +1,180 @@
+#include "lib/std/timer.h"
+#include "lib/std/memory.h"
+#include "lib/std/time.h"
+
+namespace lib {
+namespace std {
+
+namespace {
+
+constexpr uint32_t INITIAL_HEAP_CAPACITY = 32;
+
+// Binary min-heap ordered by expiry, so a tick only looks at the root
+struct timer **timer_heap = nullptr;
+uint32_t heap_size = 0;
+uint32_t heap_capacity = 0;
+
+struct tick_device *current_tick_device = nullptr;
+
+// Whoever is running timers reprograms the tick device once they're done, so
+// timers re-armed by callbacks don't need to
+char running_timers = 0;
+
+void record_lateness(const struct timer *expired) {
+  uint64_t lateness =
+      time_to_nanos(subtract_time(system_time, expired->expires));
+  timer_stats.expired++;
+  timer_stats.total_lateness += lateness;
+  if (lateness > timer_stats.max_lateness) {
+    timer_stats.max_lateness = lateness;
+  }
+}
+
+void place_timer(struct timer *to_place, uint32_t index) {
+  timer_heap[index] = to_place;
+  to_place->heap_index = index;
+}
+
+void sift_up(uint32_t index) {
+  struct timer *to_sift = timer_heap[index];
+  while (index) {
+    uint32_t parent = (index - 1) / 2;
+    if (!time_before(to_sift->expires, timer_heap[parent]->expires)) {
+      break;
+    }
+    place_timer(timer_heap[parent], index);
+    index = parent;
+  }
+  place_timer(to_sift, index);
+}
+
+void sift_down(uint32_t index) {
+  struct timer *to_sift = timer_heap[index];
+  while (1) {
+    uint32_t child = 2 * index + 1;
+    if (child >= heap_size) {
+      break;
+    }
+    if (child + 1 < heap_size &&
+        time_before(timer_heap[child + 1]->expires,
+                    timer_heap[child]->expires)) {
+      child++;
+    }
+    if (!time_before(timer_heap[child]->expires, to_sift->expires)) {
+      break;
+    }
+    place_timer(timer_heap[child], index);
+    index = child;
+  }
+  place_timer(to_sift, index);
+}
+
+void remove_at(uint32_t index) {
+  heap_size--;
+  timer_heap[index]->pending = 0;
+  if (index == heap_size) {
+    return;
+  }
+
+  // The last timer fills the hole and may need to move either way
+  struct timer *moved = timer_heap[heap_size];
+  place_timer(moved, index);
+  sift_down(index);
+  sift_up(moved->heap_index);
+}
+
+} // namespace
+
+struct timer_stats timer_stats = {0, 0, 0};
+
+void init_timer(struct timer *to_init, timer_callback callback, void *data) {
+  to_init->expires.seconds = 0;
+  to_init->expires.nanoseconds = 0;
+  to_init->callback = callback;
+  to_init->data = data;
+  to_init->heap_index = 0;
+  to_init->pending = 0;
+}
+
+void add_timer(struct timer *to_add) {
+  if (to_add->pending) {
+    cancel_timer(to_add);
+  }
+
+  if (heap_size == heap_capacity) {
+    heap_capacity = heap_capacity ? 2 * heap_capacity : INITIAL_HEAP_CAPACITY;
+    if (timer_heap) {
+      timer_heap = (struct timer **)krealloc(
+          timer_heap, heap_capacity * sizeof(struct timer *));
+    } else {
+      timer_heap =
+          (struct timer **)kmalloc(heap_capacity * sizeof(struct timer *));
+    }
+  }
+
+  to_add->pending = 1;
+  place_timer(to_add, heap_size);
+  heap_size++;
+  sift_up(to_add->heap_index);
+
+  if (!to_add->heap_index && !running_timers && current_tick_device) {
+    current_tick_device->timers_changed();
+  }
+}
+
+void cancel_timer(struct timer *to_cancel) {
+  if (to_cancel->pending) {
+    remove_at(to_cancel->heap_index);
+  }
+}
+
+void run_timers(void) {
+  running_timers = 1;
+  while (heap_size && !time_before(system_time, timer_heap[0]->expires)) {
+    struct timer *expired = timer_heap[0];
+    remove_at(0);
+    record_lateness(expired);
+
+    // The callback may re-arm or free the timer
+    expired->callback(expired->data);
+  }
+  running_timers = 0;
+}
+
+char next_timer_deadline(struct time *deadline) {
+  if (!heap_size) {
+    return 0;
+  }
+
+  *deadline = timer_heap[0]->expires;
+  return 1;
+}
+
+void register_tick_device(struct tick_device *device) {
+  current_tick_device = device;
+}
+
+void start_tick(void) {
+  if (current_tick_device) {
+    current_tick_device->set_periodic();
+  }
+}
+
+void stop_tick(void) {
+  if (current_tick_device) {
+    current_tick_device->set_oneshot();
+  }
+}
+
+void update_system_time(void) {
+  if (sync_clock()) {
+    return;
+  }
+
+  if (current_tick_device) {
+    current_tick_device->update_time();
+  }
+}
+
+} // namespace std
+} // namespace lib
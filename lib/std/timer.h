@@ -0,0 +1,83 @@
+#ifndef LIB_STD_TIMER_H
+#define LIB_STD_TIMER_H
+
+#include <stdint.h>
+
+#include "lib/std/time.h"
+
+namespace lib {
+namespace std {
+
+typedef void (*timer_callback)(void *data);
+
+// Callers own the timer and must keep it alive until it fires or is cancelled.
+struct timer {
+  struct time expires; // Compared against system_time
+  timer_callback callback;
+  void *data;
+
+  // Managed by the timer code
+  uint32_t heap_index;
+  char pending;
+};
+
+void init_timer(struct timer *to_init, timer_callback callback, void *data);
+
+// Arms a timer to go off once system_time passes expires. The tick device is
+// programmed for the earliest timer, so it fires at its deadline rather than
+// the next tick. Callbacks run from the timer interrupt with interrupts
+// disabled, so they should be short.
+void add_timer(struct timer *to_add);
+
+// Disarms a pending timer. Does nothing if it already fired.
+void cancel_timer(struct timer *to_cancel);
+
+// Runs the callbacks of every timer that's due
+void run_timers(void);
+
+// Returns 1 and sets deadline if there are any pending timers
+char next_timer_deadline(struct time *deadline);
+
+// How late timers fire, in nanoseconds past their expiry. Measured when
+// run_timers gets to them, so it covers interrupt latency but not the time it
+// takes whoever was waiting to get the CPU.
+struct timer_stats {
+  uint32_t expired;
+  uint64_t total_lateness;
+  uint64_t max_lateness;
+};
+
+extern struct timer_stats timer_stats;
+
+// Whatever drives the system tick and timer interrupts. Knowing about it lets
+// the scheduler turn the periodic tick off when it isn't needed.
+struct tick_device {
+  // Ticks at a fixed rate, on top of interrupting for timers
+  void (*set_periodic)(void);
+
+  // Stops ticking and only interrupts for timers
+  void (*set_oneshot)(void);
+
+  // Called when there's a new earliest timer, so the device can interrupt for
+  // it if it wasn't going to already
+  void (*timers_changed)(void);
+
+  // Accounts time that's passed since the last interrupt in system_time
+  void (*update_time)(void);
+};
+
+void register_tick_device(struct tick_device *device);
+
+// Goes back to periodic ticks, for when several processes share the CPU
+void start_tick(void);
+
+// Stops periodic ticks and only interrupts for pending timers
+void stop_tick(void);
+
+// Brings system_time up to date even if the tick is stopped
+void update_system_time(void);
+
+} // namespace std
+} // namespace lib
+
+#endif
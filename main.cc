@@ -1,8 +1,11 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "arch/i386/cpu/fpu.h"
+#include "arch/i386/cpu/smp.h"
 #include "arch/i386/cpu/sse.h"
 #include "arch/i386/interrupts/apic.h"
+#include "arch/i386/interrupts/ioapic.h"
 #include "arch/i386/interrupts/pic.h"
 #include "arch/i386/memory/gdt.h"
 #include "arch/i386/memory/meminfo.h"
@@ -10,18 +13,22 @@
 #include "arch/i386/multiboot.h"
 #include "arch/interrupts/control.h"
 #include "arch/interrupts/interrupts.h"
+#include "drivers/i386/apic_timer.h"
 #include "drivers/i386/keyboard.h"
 #include "drivers/i386/pata.h"
 #include "drivers/i386/pci.h"
-#include "drivers/i386/pit.h"
+#include "drivers/i386/rtc.h"
+#include "drivers/i386/tsc.h"
 #include "filesystem/fat32.h"
 #include "filesystem/mbr.h"
 #include "io/vga.h"
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 #include "lib/std/string.h"
+#include "lib/std/time.h"
 #include "proc/arch.h"
 #include "proc/brk.h"
+#include "proc/clock.h"
 #include "proc/close.h"
 #include "proc/dir.h"
 #include "proc/dup.h"
@@ -29,19 +36,32 @@
 #include "proc/execve.h"
 #include "proc/exit.h"
 #include "proc/fork.h"
+#include "proc/itimer.h"
 #include "proc/ioctl.h"
+#include "proc/kthread.h"
+#include "proc/loadavg.h"
 #include "proc/mmap.h"
 #include "proc/open.h"
 #include "proc/pid.h"
+#include "proc/priority.h"
+#include "proc/proc_file.h"
 #include "proc/process.h"
 #include "proc/read_write.h"
+#include "proc/rusage.h"
+#include "proc/sched.h"
 #include "proc/seek.h"
+#include "proc/snapshot.h"
 #include "proc/sleep.h"
+#include "proc/smp.h"
 #include "proc/stat.h"
+#include "proc/sync.h"
 #include "proc/syscall.h"
 #include "proc/thread_area.h"
+#include "proc/timerfd.h"
 #include "proc/uid.h"
 #include "proc/uname.h"
+#include "proc/wait.h"
+#include "proc/workqueue.h"
 
 extern "C" {
 void kernel_main(multiboot_info_t *multiboot_info, unsigned int magic);
@@ -69,7 +89,10 @@ void kernel_main(multiboot_info_t *multiboot_info, unsigned int magic) {
                                  arch::memory::kernel_read_write);
   arch::memory::set_page_directory(base_page_directory);
   arch::memory::enable_paging();
-  arch::memory::setup_gdt();
+  arch::memory::setup_gdt(0);
+
+  // The scheduler lets go of this when it first runs something
+  arch::cpu::lock_kernel();
 
   // Create an IDT.
   arch::interrupts::initialize_interrupts();
@@ -96,16 +119,22 @@ void kernel_main(multiboot_info_t *multiboot_info, unsigned int magic) {
     }
   }
 
+  // Processes' FPU registers are switched lazily
+  arch::cpu::init_fpu(1);
+
   // Mask all interrupts.
   arch::interrupts::pic_set_mask(0xFFFF);
 
+  // Move the programmable interrupt controller (PIC) out of the way of the
+  // exceptions to interrupts 0x20-0x2F and leave it masked. Device interrupts
+  // go through the IOAPIC instead.
+  arch::interrupts::pic_initialize(0x20);
+  arch::interrupts::enable_local_apic(1);
+  arch::interrupts::init_ioapic();
+
   // Initialize the PS/2 keyboard with interrupt 0x21.
   drivers::init_keyboard(0x21);
 
-  // Initialize the programmable interrupt controller (PIC) to use interrupts
-  // 0x20-0x2F.
-  arch::interrupts::pic_initialize(0x20);
-
   // Get a list of PCI devices.
   struct pci_device_list pci_list = drivers::find_pci_devices();
 
@@ -128,35 +157,58 @@ void kernel_main(multiboot_info_t *multiboot_info, unsigned int magic) {
 
   filesystem::init_fat32(drivers::devices[0], filesystem::disk_partitions[0]);
 
-  proc::initialize_syscalls(0x198);
+  proc::initialize_syscalls(0x1F1);
   proc::register_syscall(0x01, proc::exit);
   proc::register_syscall(0x02, proc::fork);
   proc::register_syscall(0x03, proc::read);
   proc::register_syscall(0x04, proc::write);
   proc::register_syscall(0x05, proc::open);
   proc::register_syscall(0x06, proc::close);
+  proc::register_syscall(0x07, proc::waitpid);
   proc::register_syscall(0x0A, proc::unlink);
   proc::register_syscall(0x0B, proc::execve);
   proc::register_syscall(0x0C, proc::chdir);
   proc::register_syscall(0x13, proc::lseek);
   proc::register_syscall(0x14, proc::getpid);
+  proc::register_syscall(0x1B, proc::alarm);
   proc::register_syscall(0x21, proc::access);
+  proc::register_syscall(0x22, proc::nice);
+  proc::register_syscall(0x24, proc::sync);
   proc::register_syscall(0x27, proc::mkdir);
   proc::register_syscall(0x2A, proc::pipe);
+  proc::register_syscall(0x2B, proc::times);
   proc::register_syscall(0x2D, proc::brk);
   proc::register_syscall(0x36, proc::ioctl);
   proc::register_syscall(0x3F, proc::dup2);
+  proc::register_syscall(0x40, proc::getppid);
+  proc::register_syscall(0x4D, proc::getrusage);
+  proc::register_syscall(0x4E, proc::gettimeofday);
   proc::register_syscall(0x55, proc::readlink);
   proc::register_syscall(0x5A, proc::mmap);
   proc::register_syscall(0x5B, proc::munmap);
+  proc::register_syscall(0x60, proc::getpriority);
+  proc::register_syscall(0x61, proc::setpriority);
+  proc::register_syscall(0x68, proc::setitimer);
+  proc::register_syscall(0x69, proc::getitimer);
+  proc::register_syscall(0x72, proc::wait4);
+  proc::register_syscall(0x74, proc::sysinfo);
   proc::register_syscall(0x78, proc::clone);
   proc::register_syscall(0x7A, proc::new_uname);
   proc::register_syscall(0x7D, proc::mprotect);
   proc::register_syscall(0x8C, proc::llseek);
   proc::register_syscall(0x90, proc::msync);
   proc::register_syscall(0x92, proc::writev);
+  proc::register_syscall(0x9A, proc::sched_setparam);
+  proc::register_syscall(0x9B, proc::sched_getparam);
+  proc::register_syscall(0x9C, proc::sched_setscheduler);
+  proc::register_syscall(0x9D, proc::sched_getscheduler);
+  proc::register_syscall(0x9E, proc::sched_yield);
+  proc::register_syscall(0x9F, proc::sched_get_priority_max);
+  proc::register_syscall(0xA0, proc::sched_get_priority_min);
+  proc::register_syscall(0xA1, proc::sched_rr_get_interval);
   proc::register_syscall(0xA2, proc::nanosleep);
   proc::register_syscall(0xB4, proc::pread64);
+  proc::register_syscall(0xBE, proc::vfork);
   proc::register_syscall(0xC0, proc::mmap);
   proc::register_syscall(0xC3, proc::stat64);
   proc::register_syscall(0xC5, proc::fstat64);
@@ -168,12 +220,34 @@ void kernel_main(multiboot_info_t *multiboot_info, unsigned int magic) {
   proc::register_syscall(0xF3, proc::set_thread_area);
   proc::register_syscall(0xF4, proc::get_thread_area);
   proc::register_syscall(0xFC, proc::exit);
+  proc::register_syscall(0x109, proc::clock_gettime);
+  proc::register_syscall(0x10A, proc::clock_getres);
   proc::register_syscall(0x127, proc::openat);
+  proc::register_syscall(0x142, proc::timerfd_create);
+  proc::register_syscall(0x145, proc::timerfd_settime);
+  proc::register_syscall(0x146, proc::timerfd_gettime);
   proc::register_syscall(0x180, proc::arch_prctl);
   proc::register_syscall(0x197, proc::clock_nanosleep);
 
-  // Initialize the Programmable Interrupt Timer with interrupt 0x20.
-  drivers::init_pit(0x20, 1000);
+  // Moonshine specific syscalls, past the end of the Linux ones
+  proc::register_syscall(0x1F0, proc::snapshot);
+  proc::register_syscall(0x1F1, proc::restore_snapshot);
+
+  // Register pseudo files
+  proc::register_proc_file("/proc/exec_cache", proc::read_exec_cache_stats);
+  proc::register_proc_file("/proc/loadavg", proc::read_loadavg);
+  proc::register_proc_file("/proc/timer_stats", proc::read_timer_stats);
+  proc::register_proc_file("/proc/sched_latency", proc::read_sched_latency);
+
+  // Keep time with the TSC between ticks, starting from the RTC's wall clock
+  lib::std::boot_time.seconds = drivers::read_rtc();
+  drivers::init_tsc();
+
+  // Tick every millisecond with the local APIC timer on interrupt 0x20.
+  drivers::init_apic_timer(0x20, 1000);
+
+  // Start sampling the load average
+  proc::init_loadavg();
 
   // Load the initial process
   char **argv = (char **)lib::std::kmalloc(2 * sizeof(char *));
@@ -185,6 +259,13 @@ void kernel_main(multiboot_info_t *multiboot_info, unsigned int magic) {
   envp[2] = nullptr;
   proc::load_elf(argv[0], 1, argv, envp);
 
+  // Start the kernel's worker threads after init so init gets pid 1
+  proc::init_kernel_threads();
+  proc::init_workqueues();
+
+  // Bring up the other CPUs. They wait for the kernel lock until we're done.
+  proc::init_smp();
+
   // Execute processes
   proc::execute_processes();
 }
@@ -0,0 +1,140 @@
+#include <stdint.h>
+
+#include "arch/i386/memory/paging.h"
+#include "lib/math.h"
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/clock.h"
+#include "proc/process.h"
+#include "proc/sched.h"
+
+namespace proc {
+
+namespace {
+
+using arch::memory::physical_to_virtual_memcpy;
+using lib::divide_by_u32;
+using lib::std::add_time;
+using lib::std::boot_time;
+using lib::std::read_clock;
+using lib::std::system_time;
+using lib::std::time;
+using lib::std::update_system_time;
+
+constexpr uint32_t CLOCK_REALTIME = 0;
+constexpr uint32_t CLOCK_MONOTONIC = 1;
+constexpr uint32_t CLOCK_PROCESS_CPUTIME_ID = 2;
+constexpr uint32_t CLOCK_THREAD_CPUTIME_ID = 3;
+constexpr uint32_t CLOCK_MONOTONIC_RAW = 4;
+constexpr uint32_t CLOCK_REALTIME_COARSE = 5;
+constexpr uint32_t CLOCK_MONOTONIC_COARSE = 6;
+constexpr uint32_t CLOCK_BOOTTIME = 7;
+
+// The coarse clocks only move with the tick, which main sets to a millisecond
+constexpr uint32_t COARSE_RESOLUTION = 1000000;
+
+struct timeval {
+  uint32_t seconds;
+  uint32_t microseconds;
+};
+
+struct timezone {
+  int32_t minutes_west;
+  int32_t dst_time;
+};
+
+// Fills in now with the given clock. Returns 0 for clocks we don't have.
+char read_clock_id(uint32_t clock_id, struct time *now) {
+  switch (clock_id) {
+  case CLOCK_REALTIME:
+    *now = add_time(boot_time, read_clock());
+    return 1;
+  case CLOCK_MONOTONIC:
+  case CLOCK_MONOTONIC_RAW:
+  case CLOCK_BOOTTIME:
+    *now = read_clock();
+    return 1;
+  // The coarse clocks skip reading the clocksource, and are only as precise
+  // as the last tick
+  case CLOCK_REALTIME_COARSE:
+    *now = add_time(boot_time, system_time);
+    return 1;
+  case CLOCK_MONOTONIC_COARSE:
+    *now = system_time;
+    return 1;
+  case CLOCK_PROCESS_CPUTIME_ID:
+  case CLOCK_THREAD_CPUTIME_ID: {
+    struct process *current_process = get_currently_executing_process();
+    update_system_time();
+    update_runtime(current_process);
+    now->seconds = divide_by_u32(current_process->sum_exec_runtime,
+                                 1000000000, &now->nanoseconds);
+    return 1;
+  }
+  default:
+    return 0;
+  }
+}
+
+} // namespace
+
+uint32_t gettimeofday(uint32_t tv_addr, uint32_t tz_addr, uint32_t reserved1,
+                      uint32_t reserved2, uint32_t reserved3,
+                      uint32_t reserved4) {
+  struct process *current_process = get_currently_executing_process();
+
+  if (tv_addr) {
+    struct time now = add_time(boot_time, read_clock());
+    struct timeval ret;
+    ret.seconds = now.seconds;
+    ret.microseconds = now.nanoseconds / 1000;
+    physical_to_virtual_memcpy(current_process->page_dir, (char *)&ret,
+                               (char *)tv_addr, sizeof(struct timeval));
+  }
+
+  // The RTC is in UTC
+  if (tz_addr) {
+    struct timezone zone = {0, 0};
+    physical_to_virtual_memcpy(current_process->page_dir, (char *)&zone,
+                               (char *)tz_addr, sizeof(struct timezone));
+  }
+
+  return 0;
+}
+
+uint32_t clock_gettime(uint32_t clock_id, uint32_t tp_addr,
+                       uint32_t reserved1, uint32_t reserved2,
+                       uint32_t reserved3, uint32_t reserved4) {
+  struct time now;
+  if (!read_clock_id(clock_id, &now)) {
+    return -1;
+  }
+
+  struct process *current_process = get_currently_executing_process();
+  physical_to_virtual_memcpy(current_process->page_dir, (char *)&now,
+                             (char *)tp_addr, sizeof(struct time));
+  return 0;
+}
+
+uint32_t clock_getres(uint32_t clock_id, uint32_t res_addr,
+                      uint32_t reserved1, uint32_t reserved2,
+                      uint32_t reserved3, uint32_t reserved4) {
+  struct time now;
+  if (!read_clock_id(clock_id, &now)) {
+    return -1;
+  }
+
+  if (res_addr) {
+    struct time resolution = {0, 1};
+    if (clock_id == CLOCK_REALTIME_COARSE ||
+        clock_id == CLOCK_MONOTONIC_COARSE) {
+      resolution.nanoseconds = COARSE_RESOLUTION;
+    }
+    struct process *current_process = get_currently_executing_process();
+    physical_to_virtual_memcpy(current_process->page_dir, (char *)&resolution,
+                               (char *)res_addr, sizeof(struct time));
+  }
+  return 0;
+}
+
+} // namespace proc
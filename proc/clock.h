@@ -0,0 +1,22 @@
+#ifndef PROC_CLOCK_H
+#define PROC_CLOCK_H
+
+#include <stdint.h>
+
+namespace proc {
+
+uint32_t gettimeofday(uint32_t tv_addr, uint32_t tz_addr, uint32_t reserved1,
+                      uint32_t reserved2, uint32_t reserved3,
+                      uint32_t reserved4);
+
+uint32_t clock_gettime(uint32_t clock_id, uint32_t tp_addr,
+                       uint32_t reserved1, uint32_t reserved2,
+                       uint32_t reserved3, uint32_t reserved4);
+
+uint32_t clock_getres(uint32_t clock_id, uint32_t res_addr,
+                      uint32_t reserved1, uint32_t reserved2,
+                      uint32_t reserved3, uint32_t reserved4);
+
+} // namespace proc
+
+#endif
@@ -1,7 +1,9 @@
 #include "proc/close.h"
 #include "arch/i386/memory/paging.h"
+#include "filesystem/fat32.h"
 #include "filesystem/file.h"
 #include "filesystem/pipe.h"
+#include "filesystem/timerfd.h"
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 #include "proc/process.h"
@@ -13,6 +15,8 @@ namespace {
 using arch::memory::flush_pages;
 using filesystem::file;
 using filesystem::file_descriptor;
+using filesystem::free_timerfd;
+using filesystem::unpin_fat32;
 using filesystem::pipe;
 using lib::std::kfree;
 
@@ -24,7 +28,12 @@ void close_file(struct file *to_close) {
     if (!to_close->read_write_pipe->num_references) {
       kfree(to_close->read_write_pipe);
     }
+  } else if (to_close->timerfd) {
+    free_timerfd(to_close->timerfd);
   } else {
+    if (to_close->inode) {
+      unpin_fat32(to_close->inode);
+    }
     kfree(to_close->path);
     if (to_close->buffer) {
       kfree(to_close->buffer);
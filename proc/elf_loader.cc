@@ -1,10 +1,13 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "arch/i386/memory/paging.h"
 #include "filesystem/fat32.h"
+#include "filesystem/file.h"
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 #include "lib/std/string.h"
+#include "proc/close.h"
 #include "proc/elf_loader.h"
 #include "proc/process.h"
 
@@ -12,15 +15,20 @@ namespace proc {
 
 namespace {
 
+using arch::memory::PAGE_SIZE;
 using filesystem::directory_entry;
+using filesystem::file;
 using filesystem::file_descriptor;
+using filesystem::file_mapping;
+using filesystem::pin_fat32;
 using filesystem::read_fat32;
 using filesystem::stat_fat32;
 using lib::std::kfree;
 using lib::std::kmalloc;
-using lib::std::krealloc;
 using lib::std::make_string_copy;
-using lib::std::memcpy;
+using lib::std::sprintnk;
+using lib::std::streq;
+using lib::std::strlen;
 using proc::process_memory_segment;
 
 struct __attribute__((packed)) elf_header {
@@ -61,14 +69,36 @@ constexpr uint32_t EXEC = 2;
 constexpr uint32_t DYN = 3;
 
 constexpr uint32_t DEFAULT_PROGRAM_VIRTUAL_OFFSET = 0x8048000;
+constexpr uint32_t INTERPRETER_VIRTUAL_OFFSET = 0x40000000;
+
+// A parsed executable. Keeping these around lets repeated execs of the same
+// binary skip the path lookup and header reads entirely.
+struct exec_image {
+  char *path;
+  struct file *file; // The cache holds one reference to this
+  struct elf_header header;
+  struct segment_header *segment_table;
+  char *linker_path; // May be null
+  struct exec_image *next;
+  struct exec_image *prev;
+};
+
+constexpr int EXEC_CACHE_MAX_ENTRIES = 8;
+
+struct exec_image *exec_cache = nullptr; // Most recently used first
+int exec_cache_entries = 0;
+uint32_t exec_cache_hits = 0;
+uint32_t exec_cache_misses = 0;
 
 struct segment_list {
-  struct process_memory_segment *segments;
-  uint32_t num_segments;
+  struct file_mapping *mappings;
   char *linker_path;
+  uint32_t program_headers; // Virtual address of the program header table
+  uint32_t end;             // Page aligned end of the highest segment
 };
 
-uint8_t *load_elf_from_disk(char *path) {
+// Opens an ELF file and reads just its header. Everything else is read lazily.
+struct file *open_elf(char *path, struct elf_header *header) {
   struct directory_entry file_info = stat_fat32(path);
 
   if (!file_info.name) {
@@ -80,74 +110,222 @@ uint8_t *load_elf_from_disk(char *path) {
 
   kfree(file_info.name);
 
-  // Load executable into memory
-  uint8_t *file_buf = (uint8_t *)kmalloc(file_info.size);
-  if (!read_fat32(path, file_buf, file_info.size)) {
-    kfree(file_buf);
-    return nullptr;
-  }
+  struct file *elf_file = (struct file *)kmalloc(sizeof(struct file));
+  elf_file->path = make_string_copy(path);
+  elf_file->buffer = nullptr;
+  elf_file->read_write_pipe = nullptr;
+  elf_file->timerfd = nullptr;
+  elf_file->inode = file_info.inode;
+  elf_file->size = file_info.size;
+  elf_file->offset = 0;
+  elf_file->num_references = 1;
+  // Segments are paged in from the file's clusters for as long as they're
+  // mapped, so they have to outlive an unlink or overwrite of the file
+  pin_fat32(elf_file->inode);
 
   // Check the header to make sure this is actually an ELF
-  struct elf_header *header = (struct elf_header *)file_buf;
-  if (header->ident[0] != 0x7F || header->ident[1] != 'E' ||
+  if (read_fat32(elf_file->inode, 0, (uint8_t *)header,
+                 sizeof(struct elf_header)) != sizeof(struct elf_header) ||
+      header->ident[0] != 0x7F || header->ident[1] != 'E' ||
       header->ident[2] != 'L' || header->ident[3] != 'F' ||
       header->machine != MACHINE_TYPE_X86) {
-    kfree(file_buf);
+    close_file(elf_file);
     return nullptr;
   }
 
-  return file_buf;
+  return elf_file;
 }
 
-struct segment_list create_process_segments(uint8_t *file_buf,
-                                            uint32_t dyn_virtual_offset) {
-  struct segment_list ret;
+void release_file(struct file *to_release) {
+  to_release->num_references--;
+  if (!to_release->num_references) {
+    close_file(to_release);
+  }
+}
 
-  ret.linker_path = nullptr;
+void free_mappings(struct file_mapping *mappings) {
+  while (mappings) {
+    struct file_mapping *next = mappings->next;
+    release_file(mappings->file);
+    kfree(mappings);
+    mappings = next;
+  }
+}
 
-  struct elf_header *header = (struct elf_header *)file_buf;
+void drop_exec_image(struct exec_image *image) {
+  if (image->prev) {
+    image->prev->next = image->next;
+  } else {
+    exec_cache = image->next;
+  }
+  if (image->next) {
+    image->next->prev = image->prev;
+  }
+  exec_cache_entries--;
 
-  // Find loadable segments and fill out the Process Memory Segment table
-  // appropriately
-  uint32_t num_segments = header->num_segments;
+  release_file(image->file);
+  kfree(image->path);
+  kfree(image->segment_table);
+  if (image->linker_path) {
+    kfree(image->linker_path);
+  }
+  kfree(image);
+}
+
+// Finds the parsed executable at path, reading and caching it if it isn't
+// already cached. Returns nullptr if path isn't a valid ELF.
+struct exec_image *load_exec_image(char *path) {
+  for (struct exec_image *image = exec_cache; image; image = image->next) {
+    if (streq(image->path, path, strlen(image->path) + 1)) {
+      exec_cache_hits++;
+
+      // Move to the front so the least recently used image is always last
+      if (image->prev) {
+        image->prev->next = image->next;
+        if (image->next) {
+          image->next->prev = image->prev;
+        }
+        image->prev = nullptr;
+        image->next = exec_cache;
+        exec_cache->prev = image;
+        exec_cache = image;
+      }
+
+      return image;
+    }
+  }
+
+  exec_cache_misses++;
+
+  struct elf_header header;
+  struct file *elf_file = open_elf(path, &header);
+  if (!elf_file) {
+    return nullptr;
+  }
+
+  size_t table_size = header.num_segments * sizeof(struct segment_header);
   struct segment_header *segment_table =
-      (struct segment_header *)(file_buf + header->segments_offset);
-  ret.num_segments = 0;
-  for (int i = 0; i < num_segments; i++) {
-    if (segment_table[i].type == LOADABLE_SEGMENT) {
-      ret.num_segments++;
+      (struct segment_header *)kmalloc(table_size);
+  if (header.segment_entry_size != sizeof(struct segment_header) ||
+      read_fat32(elf_file->inode, header.segments_offset,
+                 (uint8_t *)segment_table, table_size) != table_size) {
+    kfree(segment_table);
+    release_file(elf_file);
+    return nullptr;
+  }
+
+  struct exec_image *image =
+      (struct exec_image *)kmalloc(sizeof(struct exec_image));
+  image->path = make_string_copy(path);
+  image->file = elf_file;
+  image->header = header;
+  image->segment_table = segment_table;
+  image->linker_path = nullptr;
+  for (int i = 0; i < header.num_segments; i++) {
+    if (segment_table[i].type == INTERPRETER_SEGMENT) {
+      image->linker_path = (char *)kmalloc(segment_table[i].disk_size + 1);
+      read_fat32(elf_file->inode, segment_table[i].offset,
+                 (uint8_t *)image->linker_path, segment_table[i].disk_size);
+      image->linker_path[segment_table[i].disk_size] = 0;
+      break;
+    }
+  }
+
+  image->prev = nullptr;
+  image->next = exec_cache;
+  if (exec_cache) {
+    exec_cache->prev = image;
+  }
+  exec_cache = image;
+  exec_cache_entries++;
+
+  if (exec_cache_entries > EXEC_CACHE_MAX_ENTRIES) {
+    struct exec_image *least_recent = exec_cache;
+    while (least_recent->next) {
+      least_recent = least_recent->next;
     }
+    drop_exec_image(least_recent);
   }
 
-  ret.segments = (struct process_memory_segment *)kmalloc(
-      ret.num_segments * sizeof(struct process_memory_segment));
-  char *linker_path = nullptr;
-  int process_segment_index = 0;
+  return image;
+}
+
+// Turns every loadable segment into a private file mapping, so pages are only
+// read from disk once they're touched. Returns a segment list with no mappings
+// on error.
+struct segment_list create_process_segments(struct exec_image *image,
+                                            uint32_t dyn_virtual_offset) {
+  struct segment_list ret;
+
+  ret.mappings = nullptr;
+  ret.linker_path = nullptr;
+  ret.program_headers = 0;
+  ret.end = 0;
+
+  struct file *elf_file = image->file;
+  struct elf_header *header = &image->header;
+  struct segment_header *segment_table = image->segment_table;
+  uint32_t num_segments = header->num_segments;
+  size_t table_size = num_segments * sizeof(struct segment_header);
+
   for (int i = 0; i < num_segments; i++) {
     if (segment_table[i].type == LOADABLE_SEGMENT) {
-      ret.segments[process_segment_index].virtual_address =
-          (void *)(segment_table[i].virtual_address);
+      uint32_t virtual_address = segment_table[i].virtual_address;
       if (header->type == DYN) {
-        ret.segments[process_segment_index].virtual_address +=
-            dyn_virtual_offset;
+        virtual_address += dyn_virtual_offset;
       }
-      ret.segments[process_segment_index].segment_size =
-          segment_table[i].memory_size;
-      ret.segments[process_segment_index].flags = segment_table[i].flags;
-      if (segment_table[i].disk_size) {
-        ret.segments[process_segment_index].source =
-            file_buf + segment_table[i].offset;
-        ret.segments[process_segment_index].disk_size =
-            segment_table[i].disk_size;
+
+      // Mappings have to start on a page boundary, so the file offset needs
+      // to sit at the same offset within its page as the virtual address.
+      uint32_t page_offset = virtual_address & (PAGE_SIZE - 1);
+      if ((segment_table[i].offset & (PAGE_SIZE - 1)) != page_offset) {
+        free_mappings(ret.mappings);
+        ret.mappings = nullptr;
+        break;
       }
 
-      process_segment_index++;
-    } else if (segment_table[i].type == INTERPRETER_SEGMENT) {
-      ret.linker_path =
-          make_string_copy((char *)file_buf + segment_table[i].offset);
+      struct file_mapping *new_mapping =
+          (struct file_mapping *)kmalloc(sizeof(struct file_mapping));
+      new_mapping->mapping = (void *)(virtual_address - page_offset);
+      new_mapping->mapping_len = segment_table[i].memory_size + page_offset;
+      new_mapping->file_len =
+          segment_table[i].disk_size ? segment_table[i].disk_size + page_offset
+                                     : 0;
+      new_mapping->offset = segment_table[i].offset - page_offset;
+      new_mapping->file = elf_file;
+      new_mapping->is_private = 1;
+      elf_file->num_references++;
+
+      new_mapping->prev = nullptr;
+      new_mapping->next = ret.mappings;
+      if (ret.mappings) {
+        ret.mappings->prev = new_mapping;
+      }
+      ret.mappings = new_mapping;
+
+      uint32_t segment_end =
+          (uint32_t)new_mapping->mapping + new_mapping->mapping_len;
+      if (segment_end & (PAGE_SIZE - 1)) {
+        segment_end = (segment_end & (~(PAGE_SIZE - 1))) + PAGE_SIZE;
+      }
+      if (segment_end > ret.end) {
+        ret.end = segment_end;
+      }
+
+      // The dynamic linker wants to know where the program headers ended up
+      if (header->segments_offset >= segment_table[i].offset &&
+          header->segments_offset + table_size <=
+              segment_table[i].offset + segment_table[i].disk_size) {
+        ret.program_headers =
+            virtual_address + header->segments_offset - segment_table[i].offset;
+      }
     }
   }
 
+  if (ret.mappings && image->linker_path) {
+    ret.linker_path = make_string_copy(image->linker_path);
+  }
+
   return ret;
 }
 
@@ -159,61 +337,100 @@ char load_elf(char *path, int argc, char **argv, char **envp, char *working_dir,
               struct file_descriptor *standard_error,
               struct file_descriptor *open_files,
               uint32_t next_file_descriptor) {
-  uint8_t *file_buf = load_elf_from_disk(path);
-  if (!file_buf) {
+  struct exec_image *image = load_exec_image(path);
+  if (!image) {
     return 0;
   }
+  struct elf_header header = image->header;
 
   struct segment_list segments =
-      create_process_segments(file_buf, DEFAULT_PROGRAM_VIRTUAL_OFFSET);
+      create_process_segments(image, DEFAULT_PROGRAM_VIRTUAL_OFFSET);
+  if (!segments.mappings) {
+    return 0;
+  }
 
-  char need_path_cleanup = 0;
-  if (segments.linker_path) {
-    need_path_cleanup = 1;
-    kfree(segments.segments);
-    kfree(file_buf);
+  struct elf_aux_info aux_info;
+  aux_info.program_headers = segments.program_headers;
+  aux_info.program_header_size = header.segment_entry_size;
+  aux_info.num_program_headers = header.num_segments;
+  aux_info.entry = header.entry;
+  if (header.type == DYN) {
+    aux_info.entry += DEFAULT_PROGRAM_VIRTUAL_OFFSET;
+  }
+  aux_info.base = 0;
+  aux_info.brk = segments.end;
 
-    path = segments.linker_path;
+  uint32_t entry = aux_info.entry;
 
-    // This process is dynamically linked. Load the linker into memory as well.
-    file_buf = load_elf_from_disk(segments.linker_path);
-    if (!file_buf) {
+  if (segments.linker_path) {
+    // This process is dynamically linked. Map the linker alongside the
+    // program and let it take over from the aux vector, so it never has to
+    // open or read the program itself.
+    struct exec_image *linker_image = load_exec_image(segments.linker_path);
+    kfree(segments.linker_path);
+    if (!linker_image) {
+      free_mappings(segments.mappings);
       return 0;
     }
+    struct elf_header linker_header = linker_image->header;
 
-    segments =
-        create_process_segments(file_buf, DEFAULT_PROGRAM_VIRTUAL_OFFSET);
+    struct segment_list linker_segments =
+        create_process_segments(linker_image, INTERPRETER_VIRTUAL_OFFSET);
+    if (!linker_segments.mappings) {
+      free_mappings(segments.mappings);
+      return 0;
+    }
+    if (linker_segments.linker_path) {
+      kfree(linker_segments.linker_path);
+    }
 
-    argc++;
-    char **old_argv = argv;
-    argv = (char **)kmalloc(argc * sizeof(char **));
-    argv[0] = make_string_copy(path);
-    for (int i = 1; i < argc; i++) {
-      argv[i] = old_argv[i - 1];
+    struct file_mapping *last_mapping = segments.mappings;
+    while (last_mapping->next) {
+      last_mapping = last_mapping->next;
     }
-    kfree(old_argv);
-  }
+    last_mapping->next = linker_segments.mappings;
+    linker_segments.mappings->prev = last_mapping;
 
-  struct elf_header *header = (struct elf_header *)file_buf;
-  void *entry = (void *)header->entry;
-  if (header->type == DYN) {
-    entry += DEFAULT_PROGRAM_VIRTUAL_OFFSET;
+    entry = linker_header.entry;
+    if (linker_header.type == DYN) {
+      entry += INTERPRETER_VIRTUAL_OFFSET;
+      aux_info.base = INTERPRETER_VIRTUAL_OFFSET;
+    }
   }
 
   // Spawn the process
   char ret = spawn_new_process(
-      path, argc, argv, envp, segments.segments, segments.num_segments,
-      (void (*)())entry, working_dir, standard_in, standard_out, standard_error,
+      path, argc, argv, envp, nullptr, 0, segments.mappings, (void (*)())entry,
+      &aux_info, working_dir, standard_in, standard_out, standard_error,
       open_files, next_file_descriptor);
 
-  kfree(segments.segments);
-  kfree(file_buf);
-
-  if (need_path_cleanup) {
-    kfree(path);
+  if (!ret) {
+    free_mappings(segments.mappings);
   }
 
   return ret;
 }
 
+void invalidate_exec_image(uint32_t inode) {
+  struct exec_image *image = exec_cache;
+  while (image) {
+    struct exec_image *next = image->next;
+    if (image->file->inode == inode) {
+      drop_exec_image(image);
+    }
+    image = next;
+  }
+}
+
+uint32_t read_exec_cache_stats(char *buf, uint32_t max_size) {
+  uint32_t lookups = exec_cache_hits + exec_cache_misses;
+  uint32_t hit_rate = lookups ? (exec_cache_hits * 100) / lookups : 0;
+  int written = sprintnk(buf, max_size,
+                         "entries: %d\nhits: %d\nmisses: %d\n"
+                         "hit rate: %d%%\n",
+                         exec_cache_entries, exec_cache_hits,
+                         exec_cache_misses, hit_rate);
+  return written < 0 ? 0 : written;
+}
+
 } // namespace proc
@@ -19,6 +19,13 @@ char load_elf(char *path, int argc, char **argv, char **envp,
               struct file_descriptor *open_files = nullptr,
               uint32_t next_file_descriptor = 3);
 
+// Drops any cached executable backed by inode. Must be called whenever a file
+// is modified or deleted.
+void invalidate_exec_image(uint32_t inode);
+
+// Generator for /proc/exec_cache
+uint32_t read_exec_cache_stats(char *buf, uint32_t max_size);
+
 } // namespace proc
 
 #endif
@@ -3,9 +3,11 @@
 
 namespace proc {
 
-uint32_t exit(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
-              uint32_t reserved4, uint32_t reserved5, uint32_t reserved6) {
-  get_currently_executing_process()->process_state = STOPPED;
+uint32_t exit(uint32_t status, uint32_t reserved1, uint32_t reserved2,
+              uint32_t reserved3, uint32_t reserved4, uint32_t reserved5) {
+  struct process *current_process = get_currently_executing_process();
+  current_process->exit_status = status;
+  current_process->process_state = STOPPED;
   advance_process_queue();
   execute_processes();
 
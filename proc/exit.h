@@ -7,8 +7,8 @@
 
 namespace proc {
 
-uint32_t exit(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
-              uint32_t reserved4, uint32_t reserved5, uint32_t reserved6);
+uint32_t exit(uint32_t status, uint32_t reserved1, uint32_t reserved2,
+              uint32_t reserved3, uint32_t reserved4, uint32_t reserved5);
 
 } // namespace proc
 
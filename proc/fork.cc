@@ -1,6 +1,6 @@
 #include <stdint.h>
 
-#include "arch/i386/cpu/sse.h"
+#include "arch/i386/cpu/fpu.h"
 #include "arch/i386/memory/gdt.h"
 #include "arch/i386/memory/paging.h"
 #include "filesystem/file.h"
@@ -10,13 +10,16 @@
 #include "lib/std/string.h"
 #include "proc/dup.h"
 #include "proc/fork.h"
+#include "proc/kthread.h"
 #include "proc/process.h"
+#include "proc/vdso.h"
+#include "proc/wait_queue.h"
 
 namespace proc {
 
 namespace {
 
-using arch::cpu::is_sse_enabled;
+using arch::cpu::copy_fpu_state;
 using arch::memory::copy_mapping;
 using arch::memory::flush_pages;
 using arch::memory::map_memory_segment;
@@ -24,18 +27,191 @@ using arch::memory::PAGE_SIZE;
 using arch::memory::permission;
 using arch::memory::tls_segment;
 using arch::memory::user_read_only;
+using arch::memory::unmap_memory_range;
 using arch::memory::user_read_write;
 using arch::memory::virtual_to_physical;
 using filesystem::file;
 using filesystem::file_descriptor;
 using filesystem::file_mapping;
 using filesystem::pipe;
+using lib::std::kfree;
 using lib::std::kmalloc;
 using lib::std::kmalloc_aligned;
 using lib::std::make_string_copy;
 using lib::std::memcpy;
 using lib::std::memset;
 
+constexpr uint32_t CLONE_VM = 0x100;
+constexpr uint32_t CLONE_VFORK = 0x4000;
+
+// Copying a big address space takes a while, so other processes get a turn
+// after each chunk of this many bytes
+constexpr uint32_t COPY_CHUNK_SIZE = 0x10000;
+
+void copy_segment(char *from, char *to, size_t len) {
+  for (size_t copied = 0; copied < len; copied += COPY_CHUNK_SIZE) {
+    size_t chunk_size =
+        len - copied < COPY_CHUNK_SIZE ? len - copied : COPY_CHUNK_SIZE;
+    memcpy(from + copied, to + copied, chunk_size);
+    cond_resched();
+  }
+}
+
+// Copies everything but the address space and kernel stack
+void copy_process_info(struct process *parent_proc, struct process *new_proc) {
+  new_proc->path = make_string_copy(parent_proc->path);
+  new_proc->working_dir = make_string_copy(parent_proc->working_dir);
+
+  new_proc->entry = parent_proc->entry;
+
+  new_proc->num_tls_segments = parent_proc->num_tls_segments;
+  new_proc->tls_segments = (struct tls_segment *)kmalloc(
+      sizeof(struct tls_segment) * new_proc->num_tls_segments);
+  memcpy((char *)parent_proc->tls_segments, (char *)new_proc->tls_segments,
+         sizeof(struct tls_segment) * new_proc->num_tls_segments);
+  new_proc->tls_segment_index = parent_proc->tls_segment_index;
+
+  new_proc->argc = parent_proc->argc;
+  new_proc->argv = (char **)kmalloc(new_proc->argc * sizeof(char *));
+  for (int i = 0; i < new_proc->argc; i++) {
+    new_proc->argv[i] = make_string_copy(parent_proc->argv[i]);
+  }
+
+  int envc = 0;
+  if (parent_proc->envp) {
+    while (parent_proc->envp[envc]) {
+      envc++;
+    }
+  }
+  if (envc) {
+    new_proc->envp = (char **)kmalloc((envc + 1) * sizeof(char *));
+    for (int i = 0; i < envc; i++) {
+      new_proc->envp[i] = make_string_copy(parent_proc->envp[i]);
+    }
+    new_proc->envp[envc] = nullptr;
+  } else {
+    new_proc->envp = nullptr;
+  }
+
+  new_proc->parent_pid = parent_proc->pid;
+  reset_process_usage(new_proc);
+  copy_fpu_state(parent_proc, new_proc);
+
+  new_proc->nice = parent_proc->nice;
+  new_proc->policy = parent_proc->policy;
+  new_proc->rt_priority = parent_proc->rt_priority;
+
+  new_proc->next_file_descriptor = parent_proc->next_file_descriptor;
+
+  struct file_descriptor *current_fd = parent_proc->open_files;
+  new_proc->open_files = nullptr;
+  while (current_fd) {
+    struct file_descriptor *new_fd = duplicate(current_fd, current_fd->num);
+
+    new_fd->prev = nullptr;
+    new_fd->next = new_proc->open_files;
+    new_proc->open_files = new_fd;
+
+    current_fd = current_fd->next;
+  }
+
+  if (parent_proc->standard_in) {
+    new_proc->standard_in = duplicate(parent_proc->standard_in, 0);
+  } else {
+    new_proc->standard_in = nullptr;
+  }
+  if (parent_proc->standard_out) {
+    new_proc->standard_out = duplicate(parent_proc->standard_out, 1);
+  } else {
+    new_proc->standard_out = nullptr;
+  }
+  if (parent_proc->standard_error) {
+    new_proc->standard_error = duplicate(parent_proc->standard_error, 2);
+  } else {
+    new_proc->standard_error = nullptr;
+  }
+
+  new_proc->wait = nullptr;
+
+  new_proc->vfork_parent = nullptr;
+  new_proc->vfork_kernel_stack = nullptr;
+  new_proc->is_kernel_thread = 0;
+  new_proc->in_syscall = 0;
+  new_proc->syscall_esp = 0;
+}
+
+// Points the child at a copy of the parent's saved syscall frame and returns
+// the pushal area of that copy.
+uint32_t *copy_saved_frame(struct process *parent_proc,
+                           struct process *new_proc) {
+  new_proc->esp = new_proc->kernel_stack_top -
+                  (parent_proc->kernel_stack_top - parent_proc->esp);
+
+  // We don't need to do any gymnastics with virtual and physical memory here
+  // because we always identity page the kernel stack
+  return (uint32_t *)new_proc->esp;
+}
+
+uint32_t vfork_internal(uint32_t stack_addr) {
+  struct process *parent_proc = get_currently_executing_process();
+  struct process *new_proc = (struct process *)kmalloc(sizeof(struct process));
+
+  new_proc->pid = assign_pid();
+
+  copy_process_info(parent_proc, new_proc);
+
+  // Borrow the parent's address space instead of copying it. Anything the
+  // child maps or unmaps is handed back along with it in end_vfork.
+  new_proc->page_dir = parent_proc->page_dir;
+  new_proc->page_tables = parent_proc->page_tables;
+  new_proc->num_page_tables = parent_proc->num_page_tables;
+  new_proc->segments = parent_proc->segments;
+  new_proc->num_segments = parent_proc->num_segments;
+  new_proc->mappings = parent_proc->mappings;
+  new_proc->actual_brk = parent_proc->actual_brk;
+  new_proc->brk = parent_proc->brk;
+  new_proc->lower_brk = parent_proc->lower_brk;
+  new_proc->vdso_data = parent_proc->vdso_data;
+  new_proc->vfork_parent = parent_proc;
+  set_vdso_owner(new_proc);
+
+  // The child still needs a kernel stack of its own, visible from the shared
+  // page directory
+  new_proc->vfork_kernel_stack =
+      kmalloc_aligned(DEFAULT_STACK_SIZE, PAGE_SIZE);
+  map_memory_segment(new_proc, (uint32_t)new_proc->vfork_kernel_stack,
+                     (uint32_t)new_proc->vfork_kernel_stack,
+                     DEFAULT_STACK_SIZE, user_read_write);
+  new_proc->kernel_stack_top =
+      ((uint32_t)new_proc->vfork_kernel_stack + DEFAULT_STACK_SIZE) &
+      0xFFFFFFFC;
+
+  // Only the saved frame is copied, not the rest of the parent's kernel stack
+  size_t frame_size = parent_proc->kernel_stack_top - parent_proc->esp;
+  memcpy((char *)parent_proc->esp,
+         (char *)(new_proc->kernel_stack_top - frame_size), frame_size);
+  uint32_t *esp_actual = copy_saved_frame(parent_proc, new_proc);
+  esp_actual[7] = 0;
+  if (stack_addr) {
+    esp_actual[11] = stack_addr; // User esp in the iret frame
+  }
+
+  new_proc->process_state = RUNNABLE;
+
+  // The parent sleeps until the child execs or exits
+  struct vfork_wait *wait =
+      (struct vfork_wait *)kmalloc(sizeof(struct vfork_wait));
+  init_wait_reason(wait, VFORK_WAIT, parent_proc);
+  wait->child = new_proc;
+  wait_on(nullptr, wait);
+
+  add_process(new_proc);
+
+  advance_process_queue();
+
+  return new_proc->pid;
+}
+
 } // namespace
 
 uint32_t fork(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
@@ -45,8 +221,7 @@ uint32_t fork(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
 
   new_proc->pid = assign_pid();
 
-  new_proc->path = make_string_copy(parent_proc->path);
-  new_proc->working_dir = make_string_copy(parent_proc->working_dir);
+  copy_process_info(parent_proc, new_proc);
 
   new_proc->page_dir =
       (uint32_t *)kmalloc_aligned(1024 * sizeof(uint32_t), PAGE_SIZE);
@@ -56,8 +231,6 @@ uint32_t fork(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
   new_proc->page_tables = nullptr;
   new_proc->num_page_tables = 0;
 
-  new_proc->entry = parent_proc->entry;
-
   struct file_mapping *mapping = parent_proc->mappings;
   while (mapping) {
     map_memory_segment(new_proc, 0, (uint32_t)mapping->mapping,
@@ -77,9 +250,9 @@ uint32_t fork(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
 
     new_proc->segments[i].actual_address =
         kmalloc_aligned(parent_proc->segments[i].alloc_size, PAGE_SIZE);
-    memcpy((char *)parent_proc->segments[i].actual_address,
-           (char *)new_proc->segments[i].actual_address,
-           new_proc->segments[i].alloc_size);
+    copy_segment((char *)parent_proc->segments[i].actual_address,
+                 (char *)new_proc->segments[i].actual_address,
+                 new_proc->segments[i].alloc_size);
 
     uint32_t virtual_address = (uint32_t)new_proc->segments[i].virtual_address;
     if (!virtual_address) {
@@ -93,44 +266,15 @@ uint32_t fork(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
                        new_proc->segments[i].alloc_size, user_read_write);
   }
 
-  new_proc->esp = new_proc->kernel_stack_top -
-                  (parent_proc->kernel_stack_top - parent_proc->esp);
-
-  new_proc->num_tls_segments = parent_proc->num_tls_segments;
-  new_proc->tls_segments = (struct tls_segment *)kmalloc(
-      sizeof(struct tls_segment) * new_proc->num_tls_segments);
-  memcpy((char *)parent_proc->tls_segments, (char *)new_proc->tls_segments,
-         sizeof(struct tls_segment) * new_proc->num_tls_segments);
-  new_proc->tls_segment_index = parent_proc->tls_segment_index;
-
   new_proc->actual_brk = parent_proc->actual_brk;
   new_proc->brk = parent_proc->brk;
   new_proc->lower_brk = parent_proc->lower_brk;
 
-  new_proc->argc = parent_proc->argc;
-  new_proc->argv = (char **)kmalloc(new_proc->argc * sizeof(char *));
-  for (int i = 0; i < new_proc->argc; i++) {
-    new_proc->argv[i] = make_string_copy(parent_proc->argv[i]);
-  }
-
-  int envc = 0;
-  if (parent_proc->envp) {
-    while (parent_proc->envp[envc]) {
-      envc++;
-    }
-  }
-  if (envc) {
-    new_proc->envp = (char **)kmalloc((envc + 1) * sizeof(char *));
-    for (int i = 0; i < envc; i++) {
-      new_proc->envp[i] = make_string_copy(parent_proc->envp[i]);
-    }
-    new_proc->envp[envc] = nullptr;
-  } else {
-    new_proc->envp = nullptr;
-  }
+  map_vdso(new_proc);
 
   struct file_mapping *current_mapping = parent_proc->mappings;
   struct file_mapping *last_new_mapping = nullptr;
+  new_proc->mappings = nullptr;
   while (current_mapping) {
     struct file_mapping *new_mapping =
         (struct file_mapping *)kmalloc(sizeof(struct file_mapping));
@@ -140,6 +284,7 @@ uint32_t fork(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
     new_mapping->file->num_references++;
 
     copy_mapping(parent_proc, new_proc, new_mapping);
+    cond_resched();
 
     if (!last_new_mapping) {
       new_proc->mappings = new_mapping;
@@ -152,65 +297,62 @@ uint32_t fork(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
     current_mapping = current_mapping->next;
   }
 
-  new_proc->next_file_descriptor = parent_proc->next_file_descriptor;
-
-  struct file_descriptor *current_fd = parent_proc->open_files;
-  new_proc->open_files = nullptr;
-  while (current_fd) {
-    struct file_descriptor *new_fd = duplicate(current_fd, current_fd->num);
-
-    new_fd->prev = nullptr;
-    new_fd->next = new_proc->open_files;
-    new_proc->open_files = new_fd;
-
-    current_fd = current_fd->next;
-  }
-
-  if (parent_proc->standard_in) {
-    new_proc->standard_in = duplicate(parent_proc->standard_in, 0);
-  } else {
-    new_proc->standard_in = nullptr;
-  }
-  if (parent_proc->standard_out) {
-    new_proc->standard_out = duplicate(parent_proc->standard_out, 1);
-  } else {
-    new_proc->standard_out = nullptr;
-  }
-  if (parent_proc->standard_error) {
-    new_proc->standard_error = duplicate(parent_proc->standard_error, 2);
-  } else {
-    new_proc->standard_error = nullptr;
-  }
-
   new_proc->process_state = RUNNABLE;
 
-  new_proc->wait = nullptr;
-
-  parent_proc->next->prev = new_proc;
-  new_proc->next = parent_proc->next;
-  parent_proc->next = new_proc;
-  new_proc->prev = parent_proc;
+  add_process(new_proc);
 
-  // We don't need to do any gymnastics with virtual and physical memory here
-  // because we always identity page the kernel stack. But, we gotta fix any
-  // saved kernel stack pointers since the addresses will be different.
-  uint32_t *esp_actual = (uint32_t *)new_proc->esp;
-  if (is_sse_enabled) {
-    uint32_t old_esp_actual = *(uint32_t *)parent_proc->esp;
-    *esp_actual = new_proc->kernel_stack_top -
-                  (parent_proc->kernel_stack_top - old_esp_actual);
-    esp_actual = (uint32_t *)*esp_actual;
-  }
+  uint32_t *esp_actual = copy_saved_frame(parent_proc, new_proc);
   esp_actual[7] = 0;
 
   advance_process_queue();
 
-  return parent_proc->pid;
+  return new_proc->pid;
+}
+
+uint32_t vfork(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
+               uint32_t reserved4, uint32_t reserved5, uint32_t reserved6) {
+  return vfork_internal(0);
 }
 
 uint32_t clone(uint32_t flags, uint32_t stack_addr, uint32_t parent_tid_addr,
                uint32_t tls, uint32_t child_tid_addr, uint32_t reserved1) {
+  if ((flags & (CLONE_VM | CLONE_VFORK)) == (CLONE_VM | CLONE_VFORK)) {
+    return vfork_internal(stack_addr);
+  }
+
   return fork(0, 0, 0, 0, 0, 0);
 }
 
+void end_vfork(struct process *child) {
+  struct process *parent_proc = child->vfork_parent;
+
+  // The child's kernel stack only lived in the shared page directory so the
+  // child could run on it
+  unmap_memory_range(child->page_dir, child->vfork_kernel_stack,
+                     DEFAULT_STACK_SIZE);
+  kfree(child->vfork_kernel_stack);
+
+  parent_proc->page_tables = child->page_tables;
+  parent_proc->num_page_tables = child->num_page_tables;
+  parent_proc->segments = child->segments;
+  parent_proc->num_segments = child->num_segments;
+  parent_proc->mappings = child->mappings;
+  parent_proc->actual_brk = child->actual_brk;
+  parent_proc->brk = child->brk;
+  parent_proc->lower_brk = child->lower_brk;
+  set_vdso_owner(parent_proc);
+
+  child->page_dir = nullptr;
+  child->page_tables = nullptr;
+  child->num_page_tables = 0;
+  child->segments = nullptr;
+  child->num_segments = 0;
+  child->mappings = nullptr;
+  child->vdso_data = nullptr;
+  child->vfork_parent = nullptr;
+  child->vfork_kernel_stack = nullptr;
+
+  wake_waiter(parent_proc->wait);
+}
+
 } // namespace proc
@@ -3,14 +3,29 @@
 
 #include <stdint.h>
 
+#include "proc/process.h"
+
 namespace proc {
 
+constexpr uint32_t VFORK_WAIT = 0x5;
+
+struct vfork_wait : wait_reason {
+  struct process *child;
+};
+
 uint32_t fork(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
               uint32_t reserved4, uint32_t reserved5, uint32_t reserved6);
 
+uint32_t vfork(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
+               uint32_t reserved4, uint32_t reserved5, uint32_t reserved6);
+
 uint32_t clone(uint32_t flags, uint32_t stack_addr, uint32_t parent_tid_addr,
                uint32_t tls, uint32_t child_tid_addr, uint32_t reserved1);
 
+// Hands a vfork child's borrowed address space back to its parent and wakes
+// the parent up.
+void end_vfork(struct process *child);
+
 } // namespace proc
 
 #endif
@@ -1,12 +1,17 @@
 #include "proc/syscall.h"
+#include "arch/i386/cpu/model_specific.h"
 #include "arch/i386/cpu/save_restore.h"
-#include "arch/i386/cpu/sse.h"
+#include "arch/i386/cpu/smp.h"
 #include "arch/i386/interrupts/idt.h"
+#include "arch/i386/memory/gdt.h"
 #include "arch/i386/memory/paging.h"
+#include "arch/i386/vdso/vdso.h"
 #include "arch/interrupts/interrupts.h"
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 #include "proc/process.h"
+#include "proc/rusage.h"
+#include "proc/vdso.h"
 
 extern char stack_top;
 
@@ -26,11 +31,22 @@ uint32_t default_syscall(uint32_t ebx, uint32_t ecx, uint32_t edx, uint32_t esi,
   lib::std::panic("Invalid system call!");
 }
 
-using arch::cpu::is_sse_enabled;
+using arch::cpu::lock_kernel;
+using arch::cpu::unlock_kernel;
 using arch::interrupts::interrupt_frame;
+using arch::memory::get_tss;
+using arch::memory::virtual_to_physical_memcpy;
+using arch::vdso::VSYSCALL_RETURN_OFFSET;
 
 constexpr uint8_t INTERRUPT_NUMBER = 0x80;
 
+char fast_syscalls;
+
+extern "C" {
+// Where SYSEXIT goes back to in __kernel_vsyscall
+uint32_t sysenter_return;
+}
+
 // The extern and the cdecl attribute guarantee that we'll be able to call this
 // function in exactly the way we expect. Variables are pushed onto the stack
 // and cleaned up by the caller.
@@ -38,14 +54,11 @@ extern "C" void syscall_dispatch(char is_userspace) {
   struct process *current_process = proc::get_currently_executing_process();
   uint32_t *esp = (uint32_t *)current_process->esp;
   uint32_t eax, ebx, ecx, edx, edi, esi, ebp;
-  uint32_t *page_dir = current_process->page_dir;
-
-  arch::memory::set_page_directory(page_dir);
-
-  if (is_sse_enabled) {
-    esp = (uint32_t *)(*esp);
-  }
 
+  // The kernel stack is identity mapped, so the saved frame can be read and
+  // written from the kernel's page tables, which save_processor_state already
+  // switched to.
+  //
   // Pushal stores these registers in these locations. See processor docs for
   // details.
   edi = esp[0];
@@ -59,19 +72,18 @@ extern "C" void syscall_dispatch(char is_userspace) {
   if (eax >= num_syscalls) {
     lib::std::panic("Invalid system call!");
   } else {
-    // Execute the syscall
-    arch::memory::set_page_directory(base_page_directory);
+    // Execute the syscall and set the return value. Long ones may give up
+    // the CPU at cond_resched along the way.
+    current_process->in_syscall = 1;
     eax = syscalls[eax](ebx, ecx, edx, esi, edi, ebp);
-
-    // Set the return value
-    // Notice how we use page_dir, not current_process->page_dir.
-    // We have no guarantee what state the page tables will be in
-    // after a syscall, so we just rely on local variables instead.
-    arch::memory::set_page_directory(page_dir);
+    current_process->in_syscall = 0;
     esp[7] = eax;
-    arch::memory::set_page_directory(base_page_directory);
 
-    proc::execute_processes();
+    // Most syscalls don't block or wake anyone who should run instead, so
+    // save_processor_state can usually return straight to the caller
+    if (!proc::resume_running_process(current_process)) {
+      proc::execute_processes();
+    }
   }
 }
 
@@ -79,6 +91,74 @@ extern "C" void syscall_interrupt(void);
 
 SAVE_PROCESSOR_STATE(syscall_interrupt, syscall_dispatch)
 
+// Called from sysenter_entry with the same frame an int 0x80 would have saved.
+// Returns it to SYSEXIT with if the process can go straight back to userspace,
+// and otherwise runs the scheduler, which resumes it with an iret like any
+// other process.
+extern "C" uint32_t sysenter_dispatch(uint32_t esp) {
+  lock_kernel();
+  arch::memory::switch_page_directory(base_page_directory);
+
+  struct process *current_process = proc::get_currently_executing_process();
+  proc::account_user_time(current_process);
+  current_process->esp = esp;
+
+  uint32_t *registers = (uint32_t *)esp;
+
+  // ebp holds the user stack, where __kernel_vsyscall left the real ebp, which
+  // is the sixth argument
+  uint32_t ebp;
+  virtual_to_physical_memcpy(current_process->page_dir, (char *)registers[2],
+                             (char *)&ebp, sizeof(uint32_t));
+  registers[2] = ebp;
+
+  uint32_t eax = registers[7];
+  if (eax >= num_syscalls) {
+    lib::std::panic("Invalid system call!");
+  }
+  current_process->in_syscall = 1;
+  registers[7] = syscalls[eax](registers[4], registers[6], registers[5],
+                               registers[1], registers[0], ebp);
+  current_process->in_syscall = 0;
+
+  if (proc::resume_running_process(current_process)) {
+    unlock_kernel();
+    return (uint32_t)registers;
+  }
+
+  proc::execute_processes();
+  return 0;
+}
+
+// SYSENTER leaves us on top of the address of this CPU's TSS esp0, with
+// interrupts off and the user stack in ebp. Builds the frame an int 0x80 from
+// __kernel_vsyscall would have, so the rest of the kernel can't tell the
+// difference.
+//
+// SYSEXIT returns to edx with the stack in ecx. __kernel_vsyscall restores
+// both once it's back.
+asm(".pushsection .text\n"
+    "sysenter_entry:\n"
+    "mov (%esp), %esp\n"
+    "push $0x23\n" // USER_DATA_SELECTOR
+    "push %ebp\n"
+    "pushf\n"
+    "orl $0x200, (%esp)\n"
+    "push $0x1B\n" // USER_CODE_SELECTOR
+    "push sysenter_return\n"
+    "pushal\n"
+    "push %esp\n"
+    "call sysenter_dispatch\n"
+    "mov %eax, %esp\n"
+    "popal\n"
+    "mov (%esp), %edx\n"   // eip
+    "mov 12(%esp), %ecx\n" // esp
+    "sti\n"
+    "sysexit\n"
+    ".popsection");
+
+extern "C" void sysenter_entry(void);
+
 } // namespace
 
 void initialize_syscalls(uint32_t max_syscall_number) {
@@ -92,6 +172,22 @@ void initialize_syscalls(uint32_t max_syscall_number) {
   arch::interrupts::register_interrupt_handler(INTERRUPT_NUMBER,
                                                arch::interrupts::INTERRUPT_GATE,
                                                3, (void *)syscall_interrupt);
+
+  fast_syscalls = arch::cpu::has_sysenter();
+  sysenter_return = get_vsyscall_address() + VSYSCALL_RETURN_OFFSET;
+  enable_fast_syscalls();
+}
+
+void enable_fast_syscalls(void) {
+  if (fast_syscalls) {
+    arch::cpu::setup_sysenter(arch::memory::CODE_SELECTOR,
+                              (uint32_t)&get_tss()->esp0,
+                              (uint32_t)sysenter_entry);
+  }
+}
+
+uint32_t get_syscall_entry(void) {
+  return fast_syscalls ? get_vsyscall_address() : 0;
 }
 
 void register_syscall(uint32_t number,
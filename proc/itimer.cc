@@ -0,0 +1,189 @@
+#include <stdint.h>
+
+#include "arch/i386/memory/paging.h"
+#include "lib/math.h"
+#include "lib/std/string.h"
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/itimer.h"
+#include "proc/process.h"
+
+namespace proc {
+
+namespace {
+
+using arch::memory::physical_to_virtual_memcpy;
+using arch::memory::virtual_to_physical_memcpy;
+using lib::divide_by_u32;
+using lib::std::add_time;
+using lib::std::add_timer;
+using lib::std::cancel_timer;
+using lib::std::init_timer;
+using lib::std::sprintnk;
+using lib::std::subtract_time;
+using lib::std::system_time;
+using lib::std::time;
+using lib::std::timer_stats;
+using lib::std::update_system_time;
+
+constexpr uint32_t ITIMER_REAL = 0;
+
+struct timeval {
+  uint32_t seconds;
+  uint32_t microseconds;
+};
+
+struct itimerval {
+  struct timeval interval;
+  struct timeval value;
+};
+
+void real_timer_expired(void *data) {
+  // Going off kills the process, so there's no point re-arming an interval
+  kill_process((struct process *)data, SIGALRM);
+}
+
+struct timeval to_timeval(const struct time &to_convert) {
+  struct timeval ret;
+  ret.seconds = to_convert.seconds;
+  ret.microseconds = to_convert.nanoseconds / 1000;
+  return ret;
+}
+
+// Returns 0 if the microseconds are out of range
+char from_timeval(const struct timeval &to_convert, struct time *ret) {
+  if (to_convert.microseconds >= 1000000) {
+    return 0;
+  }
+  ret->seconds = to_convert.seconds;
+  ret->nanoseconds = to_convert.microseconds * 1000;
+  return 1;
+}
+
+struct time remaining_time(struct process *proc) {
+  struct time ret = {0, 0};
+  if (proc->real_timer.pending) {
+    update_system_time();
+    ret = subtract_time(proc->real_timer.expires, system_time);
+  }
+  return ret;
+}
+
+void arm_real_timer(struct process *proc, const struct time &value,
+                    const struct time &interval) {
+  cancel_timer(&proc->real_timer);
+  proc->real_interval = interval;
+  if (value.seconds || value.nanoseconds) {
+    update_system_time();
+    proc->real_timer.expires = add_time(system_time, value);
+    add_timer(&proc->real_timer);
+  }
+}
+
+} // namespace
+
+void init_itimer(struct process *proc) {
+  init_timer(&proc->real_timer, real_timer_expired, proc);
+  proc->real_interval.seconds = 0;
+  proc->real_interval.nanoseconds = 0;
+}
+
+void inherit_itimer(struct process *old_proc, struct process *new_proc) {
+  init_itimer(new_proc);
+  new_proc->real_interval = old_proc->real_interval;
+  if (old_proc->real_timer.pending) {
+    new_proc->real_timer.expires = old_proc->real_timer.expires;
+    cancel_timer(&old_proc->real_timer);
+    add_timer(&new_proc->real_timer);
+  }
+}
+
+void cancel_itimer(struct process *proc) { cancel_timer(&proc->real_timer); }
+
+uint32_t alarm(uint32_t seconds, uint32_t reserved1, uint32_t reserved2,
+               uint32_t reserved3, uint32_t reserved4, uint32_t reserved5) {
+  struct process *current_process = get_currently_executing_process();
+
+  // Round up, so a pending alarm never looks like it's gone
+  struct time remaining = remaining_time(current_process);
+  uint32_t ret = remaining.seconds;
+  if (remaining.nanoseconds) {
+    ret++;
+  }
+
+  struct time value = {seconds, 0};
+  struct time interval = {0, 0};
+  arm_real_timer(current_process, value, interval);
+
+  return ret;
+}
+
+uint32_t setitimer(uint32_t which, uint32_t new_value_addr,
+                   uint32_t old_value_addr, uint32_t reserved1,
+                   uint32_t reserved2, uint32_t reserved3) {
+  if (which != ITIMER_REAL) {
+    return -1;
+  }
+
+  struct process *current_process = get_currently_executing_process();
+  uint32_t *page_dir = current_process->page_dir;
+
+  struct itimerval new_value;
+  virtual_to_physical_memcpy(page_dir, (char *)new_value_addr,
+                             (char *)&new_value, sizeof(struct itimerval));
+  struct time value;
+  struct time interval;
+  if (!from_timeval(new_value.value, &value) ||
+      !from_timeval(new_value.interval, &interval)) {
+    return -1;
+  }
+
+  if (old_value_addr) {
+    struct itimerval old_value;
+    old_value.interval = to_timeval(current_process->real_interval);
+    old_value.value = to_timeval(remaining_time(current_process));
+    physical_to_virtual_memcpy(page_dir, (char *)&old_value,
+                               (char *)old_value_addr,
+                               sizeof(struct itimerval));
+  }
+
+  arm_real_timer(current_process, value, interval);
+
+  return 0;
+}
+
+uint32_t getitimer(uint32_t which, uint32_t value_addr, uint32_t reserved1,
+                   uint32_t reserved2, uint32_t reserved3, uint32_t reserved4) {
+  if (which != ITIMER_REAL) {
+    return -1;
+  }
+
+  struct process *current_process = get_currently_executing_process();
+
+  struct itimerval ret;
+  ret.interval = to_timeval(current_process->real_interval);
+  ret.value = to_timeval(remaining_time(current_process));
+  physical_to_virtual_memcpy(current_process->page_dir, (char *)&ret,
+                             (char *)value_addr, sizeof(struct itimerval));
+
+  return 0;
+}
+
+uint32_t read_timer_stats(char *buf, uint32_t max_size) {
+  uint32_t average = 0;
+  if (timer_stats.expired) {
+    average = divide_by_u32(timer_stats.total_lateness, timer_stats.expired);
+  }
+
+  // Saturates at about 4 seconds, anything that late is broken anyway
+  uint32_t max = timer_stats.max_lateness > 0xFFFFFFFF
+                     ? 0xFFFFFFFF
+                     : (uint32_t)timer_stats.max_lateness;
+
+  int written = sprintnk(buf, max_size,
+                         "expired %d\nmean_lateness %d\nmax_lateness %d\n",
+                         timer_stats.expired, average, max);
+  return written < 0 ? 0 : written;
+}
+
+} // namespace proc
@@ -0,0 +1,41 @@
+#ifndef PROC_ITIMER_H
+#define PROC_ITIMER_H
+
+#include <stdint.h>
+
+namespace proc {
+
+struct process;
+
+// SIGALRM's number, reported to the parent of a process its alarm killed
+constexpr uint32_t SIGALRM = 14;
+
+// Each process has an ITIMER_REAL timer, which alarm shares. There are no
+// signal handlers, so it kills the process when it goes off, which is what
+// SIGALRM does by default.
+void init_itimer(struct process *proc);
+
+// Moves a pending alarm over to the process replacing this one, as in execve
+void inherit_itimer(struct process *old_proc, struct process *new_proc);
+
+void cancel_itimer(struct process *proc);
+
+uint32_t alarm(uint32_t seconds, uint32_t reserved1, uint32_t reserved2,
+               uint32_t reserved3, uint32_t reserved4, uint32_t reserved5);
+
+// Only ITIMER_REAL is supported. The CPU time timers need signal handlers to
+// be of any use.
+uint32_t setitimer(uint32_t which, uint32_t new_value_addr,
+                   uint32_t old_value_addr, uint32_t reserved1,
+                   uint32_t reserved2, uint32_t reserved3);
+
+uint32_t getitimer(uint32_t which, uint32_t value_addr, uint32_t reserved1,
+                   uint32_t reserved2, uint32_t reserved3, uint32_t reserved4);
+
+// Generates /proc/timer_stats, how many timers have fired and how late they
+// were in nanoseconds
+uint32_t read_timer_stats(char *buf, uint32_t max_size);
+
+} // namespace proc
+
+#endif
@@ -0,0 +1,151 @@
+#include "proc/kthread.h"
+#include "arch/i386/cpu/fpu.h"
+#include "arch/i386/cpu/save_restore.h"
+#include "arch/i386/interrupts/idt.h"
+#include "arch/i386/memory/gdt.h"
+#include "arch/i386/memory/paging.h"
+#include "arch/interrupts/interrupts.h"
+#include "lib/std/memory.h"
+#include "lib/std/string.h"
+#include "lib/std/timer.h"
+#include "proc/process.h"
+#include "proc/sched.h"
+
+namespace proc {
+
+namespace {
+
+using arch::cpu::init_fpu_state;
+using arch::interrupts::INTERRUPT_GATE;
+using arch::interrupts::register_interrupt_handler;
+using arch::memory::set_kernel_stack;
+using arch::memory::switch_page_directory;
+using lib::std::kmalloc;
+using lib::std::kmalloc_aligned;
+using lib::std::make_string_copy;
+using lib::std::update_system_time;
+
+constexpr uint8_t INTERRUPT_NUMBER = 0x81;
+
+// Kernel threads land here when their function returns
+extern "C" void kernel_thread_return(void) {
+  get_currently_executing_process()->process_state = STOPPED;
+  execute_processes();
+}
+
+extern "C" void kernel_thread_switch(char is_userspace) {
+  advance_process_queue();
+  execute_processes();
+}
+
+extern "C" void kernel_thread_interrupt(void);
+
+SAVE_PROCESSOR_STATE(kernel_thread_interrupt, kernel_thread_switch)
+
+} // namespace
+
+void init_kernel_threads(void) {
+  register_interrupt_handler(INTERRUPT_NUMBER, INTERRUPT_GATE, 0,
+                             (void *)kernel_thread_interrupt);
+}
+
+struct process *spawn_kernel_thread(const char *name, void (*fn)(void *data),
+                                    void *data) {
+  struct process *new_proc = (struct process *)kmalloc(sizeof(struct process));
+
+  new_proc->path = make_string_copy(name);
+  new_proc->working_dir = make_string_copy("/");
+
+  new_proc->page_dir = base_page_directory;
+  new_proc->page_tables = nullptr;
+  new_proc->num_page_tables = 0;
+  new_proc->segments = nullptr;
+  new_proc->num_segments = 0;
+  new_proc->mappings = nullptr;
+  new_proc->vdso_data = nullptr;
+  new_proc->brk = 0;
+  new_proc->actual_brk = 0;
+  new_proc->lower_brk = 0;
+
+  new_proc->tls_segments = nullptr;
+  new_proc->num_tls_segments = 0;
+  new_proc->tls_segment_index = 0;
+
+  new_proc->argc = 0;
+  new_proc->argv = nullptr;
+  new_proc->envp = nullptr;
+
+  new_proc->standard_in = nullptr;
+  new_proc->standard_out = nullptr;
+  new_proc->standard_error = nullptr;
+  new_proc->open_files = nullptr;
+  new_proc->next_file_descriptor = 3;
+
+  new_proc->is_kernel_thread = 1;
+  new_proc->in_syscall = 0;
+  new_proc->syscall_esp = 0;
+  new_proc->kernel_thread_fn = fn;
+  new_proc->kernel_thread_data = data;
+  new_proc->kernel_thread_stack = kmalloc_aligned(KERNEL_THREAD_STACK_SIZE, 16);
+  new_proc->kernel_stack_top =
+      (uint32_t)new_proc->kernel_thread_stack + KERNEL_THREAD_STACK_SIZE;
+  new_proc->esp = new_proc->kernel_stack_top;
+  new_proc->entry = nullptr;
+
+  new_proc->process_state = NEW;
+  new_proc->wait = nullptr;
+
+  new_proc->pid = assign_pid();
+  new_proc->parent_pid = 0;
+  new_proc->nice = 0;
+  new_proc->policy = SCHED_OTHER;
+  new_proc->rt_priority = 0;
+  reset_process_usage(new_proc);
+  init_fpu_state(new_proc);
+
+  new_proc->vfork_parent = nullptr;
+  new_proc->vfork_kernel_stack = nullptr;
+
+  add_process(new_proc);
+
+  return new_proc;
+}
+
+void start_kernel_thread(struct process *thread) {
+  thread->process_state = RUNNABLE;
+
+  set_kernel_stack(thread->kernel_stack_top);
+  switch_page_directory(base_page_directory);
+
+  // Call the thread function on its own stack, with kernel_thread_return as
+  // the return address
+  asm volatile("movl %0, %%esp\n"
+               "push %1\n"
+               "push $kernel_thread_return\n"
+               "jmp *%2"
+               :
+               : "r"(thread->kernel_stack_top), "r"(thread->kernel_thread_data),
+                 "r"(thread->kernel_thread_fn));
+}
+
+void schedule(void) {
+  // The interrupt saves our state like any other process's, so the scheduler
+  // can resume us with restore_processor_state
+  asm volatile("int %0" : : "i"(INTERRUPT_NUMBER));
+}
+
+void cond_resched(void) {
+  struct process *current_process = get_currently_executing_process();
+  if (!current_process || (!current_process->is_kernel_thread &&
+                           (!current_process->in_syscall ||
+                            current_process->process_state != RUNNABLE))) {
+    return;
+  }
+
+  update_system_time();
+  if (resched_pending() || tick_preempt(current_process)) {
+    schedule();
+  }
+}
+
+} // namespace proc
@@ -0,0 +1,41 @@
+#ifndef PROC_KTHREAD_H
+#define PROC_KTHREAD_H
+
+#include <stdint.h>
+
+#include "proc/process.h"
+
+namespace proc {
+
+// Kernel threads are processes that run a kernel function instead of a
+// program. They're scheduled like everything else, but run with interrupts
+// disabled like the rest of the kernel, so they only give up the CPU when they
+// block or call cond_resched. Syscalls are the same.
+
+constexpr uint32_t KERNEL_THREAD_STACK_SIZE = 0x4000;
+
+// Sets up the interrupt kernel threads use to switch back to the scheduler
+void init_kernel_threads(void);
+
+// Creates a kernel thread that runs fn(data) and exits when it returns
+struct process *spawn_kernel_thread(const char *name, void (*fn)(void *data),
+                                    void *data);
+
+// Jumps into a kernel thread for the first time. Only the scheduler should
+// call this.
+void start_kernel_thread(struct process *thread);
+
+// Switches to whatever the scheduler wants to run next. A kernel thread that's
+// set itself waiting won't come back until it's woken.
+void schedule(void);
+
+// Gives up the CPU if the calling kernel thread or syscall has used up its
+// slice or woke something that's owed the CPU more. Long running work should
+// call this every so often, wherever it's safe for other processes to run
+// kernel code in the meantime. Anywhere else, like a page fault or a syscall
+// that's already set itself waiting, it does nothing.
+void cond_resched(void);
+
+} // namespace proc
+
+#endif
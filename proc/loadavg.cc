@@ -0,0 +1,143 @@
+#include <stdint.h>
+
+#include "arch/i386/memory/paging.h"
+#include "lib/std/memory.h"
+#include "lib/std/string.h"
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/loadavg.h"
+#include "proc/process.h"
+
+namespace proc {
+
+namespace {
+
+using arch::memory::physical_to_virtual_memcpy;
+using lib::std::add_time;
+using lib::std::add_timer;
+using lib::std::get_mem_stats;
+using lib::std::init_timer;
+using lib::std::mem_stats;
+using lib::std::memset;
+using lib::std::sprintnk;
+using lib::std::system_time;
+using lib::std::time;
+using lib::std::timer;
+
+constexpr uint32_t FIXED_1 = 1 << LOAD_FSHIFT;
+
+// 1 / exp(5 seconds / 1, 5 and 15 minutes) in fixed point
+constexpr uint32_t EXP_1 = 1884;
+constexpr uint32_t EXP_5 = 2014;
+constexpr uint32_t EXP_15 = 2037;
+
+const struct time LOAD_FREQUENCY = {5, 0};
+
+// sysinfo reports loads with 16 fractional bits
+constexpr uint32_t SI_LOAD_SHIFT = 16;
+
+struct sysinfo {
+  uint32_t uptime;
+  uint32_t loads[3];
+  uint32_t totalram;
+  uint32_t freeram;
+  uint32_t sharedram;
+  uint32_t bufferram;
+  uint32_t totalswap;
+  uint32_t freeswap;
+  uint16_t procs;
+  uint16_t pad;
+  uint32_t totalhigh;
+  uint32_t freehigh;
+  uint32_t mem_unit;
+  char reserved[8];
+};
+
+uint32_t averages[3] = {0, 0, 0};
+
+struct timer sample_timer;
+
+uint32_t calculate_load(uint32_t load, uint32_t exp, uint32_t active) {
+  uint32_t new_load = load * exp + active * (FIXED_1 - exp);
+
+  // Round up while the load is rising so it can actually reach active
+  if (active >= load) {
+    new_load += FIXED_1 - 1;
+  }
+
+  return new_load / FIXED_1;
+}
+
+void sample_load(void *data) {
+  struct process_counts counts = count_processes();
+  uint32_t active = (counts.runnable + counts.uninterruptible) * FIXED_1;
+
+  averages[0] = calculate_load(averages[0], EXP_1, active);
+  averages[1] = calculate_load(averages[1], EXP_5, active);
+  averages[2] = calculate_load(averages[2], EXP_15, active);
+
+  sample_timer.expires = add_time(sample_timer.expires, LOAD_FREQUENCY);
+  add_timer(&sample_timer);
+}
+
+uint32_t load_int(uint32_t load) { return load >> LOAD_FSHIFT; }
+
+// The first two decimal places
+uint32_t load_frac(uint32_t load) {
+  return load_int((load & (FIXED_1 - 1)) * 100);
+}
+
+} // namespace
+
+void init_loadavg(void) {
+  init_timer(&sample_timer, sample_load, nullptr);
+  sample_timer.expires = add_time(system_time, LOAD_FREQUENCY);
+  add_timer(&sample_timer);
+}
+
+void get_loadavg(uint32_t loads[3]) {
+  loads[0] = averages[0];
+  loads[1] = averages[1];
+  loads[2] = averages[2];
+}
+
+uint32_t sysinfo(uint32_t info_addr, uint32_t reserved1, uint32_t reserved2,
+                 uint32_t reserved3, uint32_t reserved4, uint32_t reserved5) {
+  struct sysinfo info;
+  memset((char *)&info, sizeof(struct sysinfo), 0);
+
+  info.uptime = system_time.seconds;
+  for (int i = 0; i < 3; i++) {
+    info.loads[i] = averages[i] << (SI_LOAD_SHIFT - LOAD_FSHIFT);
+  }
+
+  struct mem_stats stats = get_mem_stats();
+  info.totalram = stats.free_memory + stats.allocated_memory;
+  info.freeram = stats.free_memory;
+  info.procs = count_processes().total;
+  info.mem_unit = 1;
+
+  physical_to_virtual_memcpy(get_currently_executing_process()->page_dir,
+                             (char *)&info, (char *)info_addr,
+                             sizeof(struct sysinfo));
+
+  return 0;
+}
+
+uint32_t read_loadavg(char *buf, uint32_t max_size) {
+  struct process_counts counts = count_processes();
+
+  // Same layout as Linux: the averages, the run queue length over the number
+  // of processes, then the last pid handed out
+  int written = sprintnk(
+      buf, max_size, "%d.%d%d %d.%d%d %d.%d%d %d/%d %d\n",
+      load_int(averages[0]), load_frac(averages[0]) / 10,
+      load_frac(averages[0]) % 10, load_int(averages[1]),
+      load_frac(averages[1]) / 10, load_frac(averages[1]) % 10,
+      load_int(averages[2]), load_frac(averages[2]) / 10,
+      load_frac(averages[2]) % 10, counts.runnable, counts.total,
+      get_last_pid());
+  return written < 0 ? 0 : written;
+}
+
+} // namespace proc
@@ -0,0 +1,26 @@
+#ifndef PROC_LOADAVG_H
+#define PROC_LOADAVG_H
+
+#include <stdint.h>
+
+namespace proc {
+
+// Load averages are fixed point with this many fractional bits
+constexpr uint32_t LOAD_FSHIFT = 11;
+
+// Starts sampling the number of active processes every 5 seconds into 1, 5
+// and 15 minute exponentially decaying averages
+void init_loadavg(void);
+
+// Fills in the 1, 5 and 15 minute load averages
+void get_loadavg(uint32_t loads[3]);
+
+uint32_t sysinfo(uint32_t info_addr, uint32_t reserved1, uint32_t reserved2,
+                 uint32_t reserved3, uint32_t reserved4, uint32_t reserved5);
+
+// Generates /proc/loadavg
+uint32_t read_loadavg(char *buf, uint32_t max_size);
+
+} // namespace proc
+
+#endif
@@ -145,6 +145,7 @@ uint32_t mmap(uint32_t req_addr, uint32_t len, uint32_t prot, uint32_t flags,
     new_mapping->prev = nullptr;
     new_mapping->mapping = (void *)req_addr;
     new_mapping->mapping_len = len;
+    new_mapping->file_len = len;
     new_mapping->offset = offset * PAGE_SIZE;
     new_mapping->is_private = 1;
     if (flags & MAP_SHARED) {
@@ -6,7 +6,9 @@
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 #include "lib/std/string.h"
+#include "proc/proc_file.h"
 #include "proc/process.h"
+#include "proc/wait_queue.h"
 
 namespace proc {
 
@@ -37,6 +39,11 @@ constexpr uint32_t O_CREAT = 0x200;
 
 uint32_t open_internal(struct process *current_process, char *path,
                        uint32_t flags, uint32_t mode) {
+  struct file *proc_file = open_proc_file(path);
+  if (proc_file) {
+    return add_file_descriptor(current_process, proc_file);
+  }
+
   if (!(flags & O_CREAT)) {
     struct directory_entry entry = stat_fat32(path);
     if (!entry.name) {
@@ -65,7 +72,15 @@ uint32_t open_internal(struct process *current_process, char *path,
 
   struct file *new_file = (struct file *)kmalloc(sizeof(struct file));
   new_file->path = make_string_copy(path);
+  load_file(new_file);
 
+  return add_file_descriptor(current_process, new_file);
+}
+
+} // namespace
+
+uint32_t add_file_descriptor(struct process *current_process,
+                             struct file *new_file) {
   struct file_descriptor *new_fd =
       (struct file_descriptor *)kmalloc(sizeof(struct file_descriptor));
   new_fd->file = new_file;
@@ -82,13 +97,9 @@ uint32_t open_internal(struct process *current_process, char *path,
     current_process->open_files = new_fd;
   }
 
-  load_file(new_file);
-
   return new_fd->num;
 }
 
-} // namespace
-
 uint32_t open(uint32_t path_addr, uint32_t flags, uint32_t mode,
               uint32_t reserved1, uint32_t reserved2, uint32_t reserved3) {
   struct process *current_process = get_currently_executing_process();
@@ -170,12 +181,13 @@ uint32_t pipe(uint32_t fd_addr, uint32_t flags, uint32_t reserved1,
   memset((char *)new_pipe->buf, PIPE_MAX_SIZE, 0);
   new_pipe->read_index = 0;
   new_pipe->write_index = 0;
-  new_pipe->read_wait = nullptr;
-  new_pipe->write_wait = nullptr;
+  init_wait_queue(&new_pipe->readers);
+  init_wait_queue(&new_pipe->writers);
   new_pipe->num_references = 2;
 
   struct file *new_file1 = (struct file *)kmalloc(sizeof(struct file));
   new_file1->read_write_pipe = new_pipe;
+  new_file1->timerfd = nullptr;
   new_file1->path = nullptr;
   new_file1->buffer = nullptr;
   new_file1->num_references = 1;
@@ -188,6 +200,7 @@ uint32_t pipe(uint32_t fd_addr, uint32_t flags, uint32_t reserved1,
 
   struct file *new_file2 = (struct file *)kmalloc(sizeof(struct file));
   new_file2->read_write_pipe = new_pipe;
+  new_file2->timerfd = nullptr;
   new_file2->path = nullptr;
   new_file2->buffer = nullptr;
   new_file2->num_references = 1;
@@ -3,8 +3,22 @@
 
 #include <stdint.h>
 
+#include "filesystem/file.h"
+
 namespace proc {
 
+namespace {
+
+using filesystem::file;
+
+} // namespace
+
+struct process;
+
+// Gives new_file the next descriptor number and returns it
+uint32_t add_file_descriptor(struct process *current_process,
+                             struct file *new_file);
+
 uint32_t open(uint32_t path_addr, uint32_t flags, uint32_t mode,
               uint32_t reserved1, uint32_t reserved2, uint32_t reserved3);
 
@@ -0,0 +1,202 @@
+#include <stdint.h>
+
+#include "arch/i386/memory/paging.h"
+#include "lib/math.h"
+#include "lib/std/time.h"
+#include "proc/priority.h"
+#include "proc/process.h"
+#include "proc/sched.h"
+
+namespace proc {
+
+namespace {
+
+using arch::memory::physical_to_virtual_memcpy;
+using arch::memory::virtual_to_physical_memcpy;
+using lib::divide;
+using lib::std::time;
+
+constexpr uint32_t PRIO_PROCESS = 0;
+
+struct sched_param {
+  int32_t sched_priority;
+};
+
+struct process *find_sched_target(uint32_t pid) {
+  if (!pid) {
+    return get_currently_executing_process();
+  }
+
+  return find_process_by_pid(pid);
+}
+
+char is_valid_param(uint32_t policy, uint32_t priority) {
+  if (policy == SCHED_FIFO || policy == SCHED_RR) {
+    return priority >= MIN_RT_PRIORITY && priority <= MAX_RT_PRIORITY;
+  } else if (policy == SCHED_OTHER) {
+    return priority == 0;
+  } else {
+    return 0;
+  }
+}
+
+// Only individual processes are supported, there are no process groups or
+// users to speak of
+struct process *find_target(uint32_t which, uint32_t who) {
+  if (which != PRIO_PROCESS) {
+    return nullptr;
+  }
+
+  if (!who) {
+    return get_currently_executing_process();
+  }
+
+  return find_process_by_pid(who);
+}
+
+} // namespace
+
+uint32_t getpriority(uint32_t which, uint32_t who, uint32_t reserved1,
+                     uint32_t reserved2, uint32_t reserved3,
+                     uint32_t reserved4) {
+  struct process *target = find_target(which, who);
+  if (!target) {
+    return -1;
+  }
+
+  return 20 - target->nice;
+}
+
+uint32_t setpriority(uint32_t which, uint32_t who, uint32_t prio,
+                     uint32_t reserved1, uint32_t reserved2,
+                     uint32_t reserved3) {
+  struct process *target = find_target(which, who);
+  if (!target) {
+    return -1;
+  }
+
+  set_nice(target, (int32_t)prio);
+
+  return 0;
+}
+
+uint32_t nice(uint32_t increment, uint32_t reserved1, uint32_t reserved2,
+              uint32_t reserved3, uint32_t reserved4, uint32_t reserved5) {
+  struct process *current_process = get_currently_executing_process();
+  set_nice(current_process, current_process->nice + (int32_t)increment);
+
+  return 0;
+}
+
+uint32_t sched_setparam(uint32_t pid, uint32_t param_addr, uint32_t reserved1,
+                        uint32_t reserved2, uint32_t reserved3,
+                        uint32_t reserved4) {
+  struct process *target = find_sched_target(pid);
+  if (!target) {
+    return -1;
+  }
+
+  return sched_setscheduler(target->pid, target->policy, param_addr, 0, 0, 0);
+}
+
+uint32_t sched_getparam(uint32_t pid, uint32_t param_addr, uint32_t reserved1,
+                        uint32_t reserved2, uint32_t reserved3,
+                        uint32_t reserved4) {
+  struct process *target = find_sched_target(pid);
+  if (!target) {
+    return -1;
+  }
+
+  struct sched_param param;
+  param.sched_priority = target->rt_priority;
+  physical_to_virtual_memcpy(get_currently_executing_process()->page_dir,
+                             (char *)&param, (char *)param_addr,
+                             sizeof(struct sched_param));
+
+  return 0;
+}
+
+uint32_t sched_setscheduler(uint32_t pid, uint32_t policy, uint32_t param_addr,
+                            uint32_t reserved1, uint32_t reserved2,
+                            uint32_t reserved3) {
+  struct process *target = find_sched_target(pid);
+  if (!target) {
+    return -1;
+  }
+
+  struct sched_param param;
+  virtual_to_physical_memcpy(get_currently_executing_process()->page_dir,
+                             (char *)param_addr, (char *)&param,
+                             sizeof(struct sched_param));
+  if (!is_valid_param(policy, param.sched_priority)) {
+    return -1;
+  }
+
+  set_scheduler(target, policy, param.sched_priority);
+
+  return 0;
+}
+
+uint32_t sched_getscheduler(uint32_t pid, uint32_t reserved1,
+                            uint32_t reserved2, uint32_t reserved3,
+                            uint32_t reserved4, uint32_t reserved5) {
+  struct process *target = find_sched_target(pid);
+  if (!target) {
+    return -1;
+  }
+
+  return target->policy;
+}
+
+uint32_t sched_yield(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
+                     uint32_t reserved4, uint32_t reserved5,
+                     uint32_t reserved6) {
+  yield_process(get_currently_executing_process());
+
+  return 0;
+}
+
+uint32_t sched_get_priority_max(uint32_t policy, uint32_t reserved1,
+                                uint32_t reserved2, uint32_t reserved3,
+                                uint32_t reserved4, uint32_t reserved5) {
+  if (policy == SCHED_FIFO || policy == SCHED_RR) {
+    return MAX_RT_PRIORITY;
+  } else if (policy == SCHED_OTHER) {
+    return 0;
+  } else {
+    return -1;
+  }
+}
+
+uint32_t sched_get_priority_min(uint32_t policy, uint32_t reserved1,
+                                uint32_t reserved2, uint32_t reserved3,
+                                uint32_t reserved4, uint32_t reserved5) {
+  if (policy == SCHED_FIFO || policy == SCHED_RR) {
+    return MIN_RT_PRIORITY;
+  } else if (policy == SCHED_OTHER) {
+    return 0;
+  } else {
+    return -1;
+  }
+}
+
+uint32_t sched_rr_get_interval(uint32_t pid, uint32_t timespec_addr,
+                               uint32_t reserved1, uint32_t reserved2,
+                               uint32_t reserved3, uint32_t reserved4) {
+  struct process *target = find_sched_target(pid);
+  if (!target) {
+    return -1;
+  }
+
+  uint64_t slice = get_time_slice(target);
+  struct time interval;
+  interval.seconds = divide(slice, 1000000000);
+  interval.nanoseconds = slice - (uint64_t)interval.seconds * 1000000000;
+  physical_to_virtual_memcpy(get_currently_executing_process()->page_dir,
+                             (char *)&interval, (char *)timespec_addr,
+                             sizeof(struct time));
+
+  return 0;
+}
+
+} // namespace proc
@@ -0,0 +1,55 @@
+#ifndef PROC_PRIORITY_H
+#define PROC_PRIORITY_H
+
+#include <stdint.h>
+
+namespace proc {
+
+// Returns 20 - nice, like the raw Linux syscall, so the result is never
+// negative
+uint32_t getpriority(uint32_t which, uint32_t who, uint32_t reserved1,
+                     uint32_t reserved2, uint32_t reserved3,
+                     uint32_t reserved4);
+
+uint32_t setpriority(uint32_t which, uint32_t who, uint32_t prio,
+                     uint32_t reserved1, uint32_t reserved2,
+                     uint32_t reserved3);
+
+uint32_t nice(uint32_t increment, uint32_t reserved1, uint32_t reserved2,
+              uint32_t reserved3, uint32_t reserved4, uint32_t reserved5);
+
+uint32_t sched_setparam(uint32_t pid, uint32_t param_addr, uint32_t reserved1,
+                        uint32_t reserved2, uint32_t reserved3,
+                        uint32_t reserved4);
+
+uint32_t sched_getparam(uint32_t pid, uint32_t param_addr, uint32_t reserved1,
+                        uint32_t reserved2, uint32_t reserved3,
+                        uint32_t reserved4);
+
+uint32_t sched_setscheduler(uint32_t pid, uint32_t policy, uint32_t param_addr,
+                            uint32_t reserved1, uint32_t reserved2,
+                            uint32_t reserved3);
+
+uint32_t sched_getscheduler(uint32_t pid, uint32_t reserved1,
+                            uint32_t reserved2, uint32_t reserved3,
+                            uint32_t reserved4, uint32_t reserved5);
+
+uint32_t sched_yield(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
+                     uint32_t reserved4, uint32_t reserved5,
+                     uint32_t reserved6);
+
+uint32_t sched_get_priority_max(uint32_t policy, uint32_t reserved1,
+                                uint32_t reserved2, uint32_t reserved3,
+                                uint32_t reserved4, uint32_t reserved5);
+
+uint32_t sched_get_priority_min(uint32_t policy, uint32_t reserved1,
+                                uint32_t reserved2, uint32_t reserved3,
+                                uint32_t reserved4, uint32_t reserved5);
+
+uint32_t sched_rr_get_interval(uint32_t pid, uint32_t timespec_addr,
+                               uint32_t reserved1, uint32_t reserved2,
+                               uint32_t reserved3, uint32_t reserved4);
+
+} // namespace proc
+
+#endif
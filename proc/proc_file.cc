@@ -0,0 +1,60 @@
+#include <stdint.h>
+
+#include "filesystem/file.h"
+#include "lib/std/memory.h"
+#include "lib/std/string.h"
+#include "proc/proc_file.h"
+
+namespace proc {
+
+namespace {
+
+using filesystem::file;
+using lib::std::kmalloc;
+using lib::std::make_string_copy;
+using lib::std::streq;
+using lib::std::strlen;
+
+constexpr int MAX_PROC_FILES = 16;
+
+struct proc_file {
+  const char *path;
+  proc_file_generator generator;
+};
+
+struct proc_file proc_files[MAX_PROC_FILES];
+int num_proc_files = 0;
+
+} // namespace
+
+void register_proc_file(const char *path, proc_file_generator generator) {
+  if (num_proc_files < MAX_PROC_FILES) {
+    proc_files[num_proc_files].path = path;
+    proc_files[num_proc_files].generator = generator;
+    num_proc_files++;
+  }
+}
+
+struct file *open_proc_file(char *path) {
+  for (int i = 0; i < num_proc_files; i++) {
+    if (streq(proc_files[i].path, path, strlen(proc_files[i].path) + 1)) {
+      // The contents are generated once at open, so reads see a consistent
+      // snapshot. read_file serves them straight out of the buffer.
+      struct file *to_open = (struct file *)kmalloc(sizeof(struct file));
+      to_open->path = make_string_copy(path);
+      to_open->buffer = (char *)kmalloc(PROC_FILE_MAX_SIZE);
+      to_open->size =
+          proc_files[i].generator(to_open->buffer, PROC_FILE_MAX_SIZE);
+      to_open->read_write_pipe = nullptr;
+      to_open->timerfd = nullptr;
+      to_open->inode = 0;
+      to_open->offset = 0;
+      to_open->num_references = 1;
+      return to_open;
+    }
+  }
+
+  return nullptr;
+}
+
+} // namespace proc
@@ -0,0 +1,30 @@
+#ifndef PROC_PROC_FILE_H
+#define PROC_PROC_FILE_H
+
+#include <stdint.h>
+
+#include "filesystem/file.h"
+
+namespace proc {
+
+namespace {
+
+using filesystem::file;
+
+} // namespace
+
+constexpr uint32_t PROC_FILE_MAX_SIZE = 0x400;
+
+// Generators write the file's contents into buf and return how many bytes they
+// used
+typedef uint32_t (*proc_file_generator)(char *buf, uint32_t max_size);
+
+void register_proc_file(const char *path, proc_file_generator generator);
+
+// Opens a snapshot of the pseudo file at path. Returns nullptr if there's no
+// pseudo file there.
+struct file *open_proc_file(char *path);
+
+} // namespace proc
+
+#endif
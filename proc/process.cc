@@ -1,7 +1,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "arch/i386/cpu/fpu.h"
+#include "arch/i386/cpu/model_specific.h"
 #include "arch/i386/cpu/save_restore.h"
+#include "arch/i386/cpu/smp.h"
 #include "arch/i386/memory/gdt.h"
 #include "arch/i386/memory/paging.h"
 #include "arch/interrupts/control.h"
@@ -9,27 +12,47 @@
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 #include "lib/std/string.h"
+#include "lib/std/timer.h"
 #include "proc/close.h"
+#include "proc/fork.h"
+#include "proc/itimer.h"
+#include "proc/kthread.h"
 #include "proc/mmap.h"
 #include "proc/process.h"
+#include "proc/rusage.h"
+#include "proc/sched.h"
+#include "proc/smp.h"
 #include "proc/syscall.h"
+#include "proc/vdso.h"
+#include "proc/wait.h"
+#include "proc/wait_queue.h"
 
 namespace proc {
 
 namespace {
 
+using arch::cpu::free_fpu_state;
+using arch::cpu::get_cpu_id;
+using arch::cpu::get_scheduler_stack_top;
+using arch::cpu::init_fpu_state;
+using arch::cpu::lock_kernel;
+using arch::cpu::MAX_CPUS;
+using arch::cpu::read_tsc;
+using arch::cpu::release_fpu;
 using arch::cpu::restore_processor_state;
+using arch::cpu::switch_fpu;
+using arch::cpu::unlock_kernel;
 using arch::interrupts::disable_interrupts;
 using arch::interrupts::enable_interrupts;
 using arch::memory::enable_paging;
-using arch::memory::flush_tss;
 using arch::memory::get_page_table_entry;
-using arch::memory::main_tss;
 using arch::memory::map_memory_segment;
 using arch::memory::PAGE_SIZE;
 using arch::memory::permission;
+using arch::memory::set_kernel_stack;
 using arch::memory::set_page_directory;
 using arch::memory::set_tls;
+using arch::memory::switch_page_directory;
 using arch::memory::TLS_ENTRY_OFFSET;
 using arch::memory::tls_segment;
 using arch::memory::USER_CODE_SELECTOR;
@@ -44,26 +67,57 @@ using lib::std::make_string_copy;
 using lib::std::memcpy;
 using lib::std::memset;
 using lib::std::panic;
+using lib::std::start_tick;
+using lib::std::stop_tick;
 using lib::std::strlen;
 
+// Everything here is protected by the kernel lock, see arch/i386/cpu/smp.h
 volatile struct process *process_list = nullptr;
 
+// What each CPU is running
+struct process *current_processes[MAX_CPUS];
+
+constexpr uint32_t AT_NULL = 0;
+constexpr uint32_t AT_PHDR = 3;
+constexpr uint32_t AT_PHENT = 4;
+constexpr uint32_t AT_PHNUM = 5;
+constexpr uint32_t AT_PAGESZ = 6;
+constexpr uint32_t AT_BASE = 7;
+constexpr uint32_t AT_ENTRY = 9;
 constexpr uint32_t AT_RANDOM = 25;
+constexpr uint32_t AT_SYSINFO = 32;
+constexpr uint32_t AT_SYSINFO_EHDR = 33;
 constexpr uint64_t STACK_CANARY = 0xDEADBEEFDEADBEEF;
 
 void cleanup_process(struct process *to_cleanup) {
-  while (to_cleanup->mappings) {
-    munmap((uint32_t)to_cleanup->mappings->mapping, 0, 0, 0, 0, 0);
-  }
+  if (to_cleanup->is_kernel_thread) {
+    // Everything but the stack is the kernel's
+    kfree(to_cleanup->kernel_thread_stack);
+  } else if (to_cleanup->vfork_parent) {
+    // The address space is borrowed, so it goes back instead of being freed
+    end_vfork(to_cleanup);
+  } else {
+    while (to_cleanup->mappings) {
+      munmap((uint32_t)to_cleanup->mappings->mapping, 0, 0, 0, 0, 0);
+    }
 
-  for (int i = 0; i < to_cleanup->num_segments; i++) {
-    kfree(to_cleanup->segments[i].actual_address);
-    if (to_cleanup->segments[i].virtual_address) {
-      *get_page_table_entry(to_cleanup->page_dir,
-                            to_cleanup->segments[i].virtual_address) = 0;
+    for (int i = 0; i < to_cleanup->num_segments; i++) {
+      kfree(to_cleanup->segments[i].actual_address);
+      if (to_cleanup->segments[i].virtual_address) {
+        *get_page_table_entry(to_cleanup->page_dir,
+                              to_cleanup->segments[i].virtual_address) = 0;
+      }
     }
+    kfree(to_cleanup->segments);
+
+    free_vdso(to_cleanup);
+
+    for (int i = 0; i < to_cleanup->num_page_tables; i++) {
+      kfree(to_cleanup->page_tables[i]);
+    }
+    kfree(to_cleanup->page_tables);
+    kfree(to_cleanup->page_dir);
   }
-  kfree(to_cleanup->segments);
 
   struct file_descriptor *current_file = to_cleanup->open_files;
   while (current_file) {
@@ -81,18 +135,14 @@ void cleanup_process(struct process *to_cleanup) {
     close_file_descriptor(to_cleanup->standard_error);
   }
 
-  for (int i = 0; i < to_cleanup->num_page_tables; i++) {
-    kfree(to_cleanup->page_tables[i]);
-  }
-  kfree(to_cleanup->page_tables);
-  kfree(to_cleanup->page_dir);
-
-  for (int i = 0; i < to_cleanup->argc; i++) {
-    if (to_cleanup->argv[i]) {
-      kfree(to_cleanup->argv[i]);
+  if (to_cleanup->argv) {
+    for (int i = 0; i < to_cleanup->argc; i++) {
+      if (to_cleanup->argv[i]) {
+        kfree(to_cleanup->argv[i]);
+      }
     }
+    kfree(to_cleanup->argv);
   }
-  kfree(to_cleanup->argv);
 
   char **current_envp = to_cleanup->envp;
   if (to_cleanup->envp) {
@@ -103,43 +153,69 @@ void cleanup_process(struct process *to_cleanup) {
     kfree(to_cleanup->envp);
   }
 
-  kfree(to_cleanup->tls_segments);
+  if (to_cleanup->tls_segments) {
+    kfree(to_cleanup->tls_segments);
+  }
 
   kfree(to_cleanup->path);
   kfree(to_cleanup->working_dir);
 
   if (to_cleanup->wait) {
-    kfree(to_cleanup->wait);
+    free_wait(to_cleanup->wait);
   }
+  cancel_itimer(to_cleanup);
+  free_fpu_state(to_cleanup);
+
+  report_exit(to_cleanup);
+  free_exited_children(to_cleanup);
+
+  dequeue_process(to_cleanup);
 
   if (to_cleanup->next == to_cleanup) {
     process_list = nullptr;
   } else {
     to_cleanup->next->prev = to_cleanup->prev;
     to_cleanup->prev->next = to_cleanup->next;
+    if (process_list == to_cleanup) {
+      process_list = to_cleanup->next;
+    }
   }
 
   kfree(to_cleanup);
 }
 
+// The periodic tick is only needed to preempt the current process when
+// something else is waiting to run
+void update_tick(void) {
+  if (!run_queue_empty()) {
+    start_tick();
+  } else {
+    stop_tick();
+  }
+}
+
 void execute_new_process(void) {
-  void (*code_virtual_start)(void) = process_list->entry;
-  uint32_t esp = process_list->esp;
-  int argc = process_list->argc;
-  char **argv = process_list->argv;
+  struct process *current_process = current_processes[get_cpu_id()];
+  void (*code_virtual_start)(void) = current_process->entry;
+  uint32_t esp = current_process->esp;
+  int argc = current_process->argc;
+  char **argv = current_process->argv;
 
   // Set process state to runnable
-  process_list->process_state = RUNNABLE;
+  current_process->process_state = RUNNABLE;
 
   // Set up the temporary thread local storage (TLS)
-  set_tls(process_list->tls_segments[process_list->tls_segment_index]);
+  set_tls(current_process->tls_segments[current_process->tls_segment_index]);
+  switch_fpu(current_process);
 
   // Set the TSS segment to point to this process's kernel stack
-  main_tss.esp0 = process_list->kernel_stack_top;
-  flush_tss();
+  set_kernel_stack(current_process->kernel_stack_top);
 
   // Setup the MMU to use our process's page tables
-  set_page_directory(process_list->page_dir);
+  switch_page_directory(current_process->page_dir);
+
+  // Let the other CPUs into the kernel while we're in userspace
+  unlock_kernel();
 
   // Setup the process stack and start executing
   asm volatile("movl %0, %%eax\n"
@@ -152,6 +228,7 @@ void execute_new_process(void) {
                "push %%edx\n"
                "push %%eax\n"
                "pushf\n"
+               "orl $0x200, (%%esp)\n"
                "push %%ecx\n"
                "push %%ebx\n"
                "xor %%eax, %%eax\n"
@@ -170,9 +247,42 @@ void execute_new_process(void) {
 
 constexpr uint32_t STACK_ALIGNMENT = 0x4;
 
+struct __attribute__((packed)) aux_entry {
+  uint32_t type;
+  uint32_t value;
+};
+
+constexpr int MAX_AUX_ENTRIES = 10;
+
 uint32_t setup_initial_stack(int argc, char **argv, char **envp,
+                             struct elf_aux_info *aux_info,
                              uint32_t stack_top_virtual,
                              char *stack_top_physical) {
+  // Figure out which aux entries we have up front so we know how much room
+  // they need. AT_RANDOM gets filled in once we know where the canary lives.
+  struct aux_entry aux_vector[MAX_AUX_ENTRIES];
+  int num_aux_entries = 0;
+  if (aux_info) {
+    if (aux_info->program_headers) {
+      aux_vector[num_aux_entries++] = {AT_PHDR, aux_info->program_headers};
+      aux_vector[num_aux_entries++] = {AT_PHENT,
+                                       aux_info->program_header_size};
+      aux_vector[num_aux_entries++] = {AT_PHNUM,
+                                       aux_info->num_program_headers};
+    }
+    aux_vector[num_aux_entries++] = {AT_ENTRY, aux_info->entry};
+    if (aux_info->base) {
+      aux_vector[num_aux_entries++] = {AT_BASE, aux_info->base};
+    }
+  }
+  aux_vector[num_aux_entries++] = {AT_PAGESZ, PAGE_SIZE};
+  aux_vector[num_aux_entries++] = {AT_SYSINFO_EHDR, get_vdso_address()};
+  if (get_syscall_entry()) {
+    aux_vector[num_aux_entries++] = {AT_SYSINFO, get_syscall_entry()};
+  }
+  aux_vector[num_aux_entries++] = {AT_RANDOM, 0};
+  aux_vector[num_aux_entries++] = {AT_NULL, 0};
+
   uint32_t setup_size = sizeof(int);
   for (int i = 0; i < argc; i++) {
     setup_size += strlen(argv[i]) + 1 +
@@ -190,9 +300,8 @@ uint32_t setup_initial_stack(int argc, char **argv, char **envp,
   }
   setup_size += sizeof(char *); // Envp is null terminated
 
-  setup_size +=
-      2 * sizeof(uint32_t) + sizeof(uint64_t *) +
-      sizeof(uint64_t); // Leave room for an aux vector with stack canary
+  setup_size += num_aux_entries * sizeof(struct aux_entry) +
+                sizeof(uint64_t); // Leave room for the aux vector and canary
 
   // Pad the stack so that we will be aligned
   uint32_t pad_size = STACK_ALIGNMENT - (setup_size % STACK_ALIGNMENT);
@@ -230,19 +339,12 @@ uint32_t setup_initial_stack(int argc, char **argv, char **envp,
   // Initialize aux vector
   stack_top_virtual -= sizeof(uint64_t);
   stack_top_physical -= sizeof(uint64_t);
-  uint64_t *canary_data_physical = (uint64_t *)stack_top_physical;
-  uint64_t *canary_data_virtual = (uint64_t *)stack_top_virtual;
-  *canary_data_physical = STACK_CANARY;
-  stack_top_virtual -= sizeof(uint32_t);
-  stack_top_physical -= sizeof(uint32_t);
-  *(uint32_t *)stack_top_physical = 0;
-  stack_top_virtual -= sizeof(uint64_t *);
-  stack_top_physical -= sizeof(uint64_t *);
-  *(uint64_t **)stack_top_physical = canary_data_virtual;
-  stack_top_virtual -= sizeof(uint32_t);
-  stack_top_physical -= sizeof(uint32_t);
-  *(uint32_t *)stack_top_physical = AT_RANDOM;
-  uint32_t *aux_vector = (uint32_t *)stack_top_virtual;
+  *(uint64_t *)stack_top_physical = STACK_CANARY;
+  aux_vector[num_aux_entries - 2].value = stack_top_virtual;
+  stack_top_virtual -= num_aux_entries * sizeof(struct aux_entry);
+  stack_top_physical -= num_aux_entries * sizeof(struct aux_entry);
+  memcpy((char *)aux_vector, stack_top_physical,
+         num_aux_entries * sizeof(struct aux_entry));
 
   // We already populated argv above, skip these bytes
   stack_top_virtual -= (argc + 1) * sizeof(char *);
@@ -277,8 +379,10 @@ uint32_t next_pid = 1;
 
 char spawn_new_process(char *path, int argc, char **argv, char **envp,
                        struct process_memory_segment *segments,
-                       uint32_t num_segments, void (*entry_address)(void),
-                       char *working_dir, struct file_descriptor *standard_in,
+                       uint32_t num_segments, struct file_mapping *mappings,
+                       void (*entry_address)(void),
+                       struct elf_aux_info *aux_info, char *working_dir,
+                       struct file_descriptor *standard_in,
                        struct file_descriptor *standard_out,
                        struct file_descriptor *standard_error,
                        struct file_descriptor *open_files,
@@ -291,11 +395,15 @@ char spawn_new_process(char *path, int argc, char **argv, char **envp,
       return 0;
     }
   }
+  for (struct file_mapping *mapping = mappings; mapping;
+       mapping = mapping->next) {
+    if ((uint32_t)mapping->mapping < lib::std::END_OF_KERNEL) {
+      return 0;
+    }
+  }
 
   struct process *new_proc = (struct process *)kmalloc(sizeof(struct process));
 
-  new_proc->pid = assign_pid();
-
   new_proc->path = make_string_copy(path);
   new_proc->working_dir = make_string_copy(working_dir);
 
@@ -313,6 +421,12 @@ char spawn_new_process(char *path, int argc, char **argv, char **envp,
       stack_bottom = (uint32_t)segments[i].virtual_address;
     }
   }
+  for (struct file_mapping *mapping = mappings; mapping;
+       mapping = mapping->next) {
+    if ((uint32_t)mapping->mapping < stack_bottom) {
+      stack_bottom = (uint32_t)mapping->mapping;
+    }
+  }
   stack_bottom -= DEFAULT_STACK_SIZE;
   struct process_memory_segment *stack_segment =
       new_proc->segments + (new_proc->num_segments - 2);
@@ -336,6 +450,21 @@ char spawn_new_process(char *path, int argc, char **argv, char **envp,
   kernel_stack_segment->source = nullptr;
   kernel_stack_segment->flags = READABLE_MEMORY | WRITEABLE_MEMORY;
 
+  // The program break starts after the executable, unless a writeable segment
+  // says otherwise. Without ELF info, just go past the highest file mapping.
+  new_proc->brk = aux_info ? aux_info->brk : 0;
+  for (struct file_mapping *mapping = aux_info ? nullptr : mappings; mapping;
+       mapping = mapping->next) {
+    uint32_t mapping_end = (uint32_t)mapping->mapping + mapping->mapping_len;
+    if (mapping_end & (PAGE_SIZE - 1)) {
+      mapping_end = (mapping_end & (~(PAGE_SIZE - 1))) + PAGE_SIZE;
+    }
+    if (mapping_end > new_proc->brk) {
+      new_proc->brk = mapping_end;
+    }
+  }
+  new_proc->actual_brk = new_proc->brk;
+
   // Allocate memory segments and copy disk data into them
   for (int i = 0; i < new_proc->num_segments; i++) {
     size_t page_offset =
@@ -402,7 +531,7 @@ char spawn_new_process(char *path, int argc, char **argv, char **envp,
   new_proc->envp = envp;
   new_proc->esp =
       setup_initial_stack(new_proc->argc, new_proc->argv, new_proc->envp,
-                          new_proc->esp, (char *)stack_top_physical);
+                          aux_info, new_proc->esp, (char *)stack_top_physical);
 
   // Set up page directory
   new_proc->page_dir =
@@ -430,6 +559,13 @@ char spawn_new_process(char *path, int argc, char **argv, char **envp,
                        user_read_write);
   }
 
+  // File mappings don't get any physical memory until they're faulted in
+  for (struct file_mapping *mapping = mappings; mapping;
+       mapping = mapping->next) {
+    map_memory_segment(new_proc, 0, (uint32_t)mapping->mapping,
+                       mapping->mapping_len, user_read_write);
+  }
+
   // Initialize the file descriptors
   new_proc->standard_in = standard_in;
   new_proc->standard_out = standard_out;
@@ -438,7 +574,7 @@ char spawn_new_process(char *path, int argc, char **argv, char **envp,
   new_proc->next_file_descriptor = next_file_descriptor;
 
   // Initialize memory mappings
-  new_proc->mappings = nullptr;
+  new_proc->mappings = mappings;
 
   // Set process as runnable
   new_proc->process_state = NEW;
@@ -446,61 +582,123 @@ char spawn_new_process(char *path, int argc, char **argv, char **envp,
   // Initialize the wait reason
   new_proc->wait = nullptr;
 
-  // Set the virtual address to start at
-  new_proc->entry = entry_address;
+  // It gets FPU state the first time it uses the FPU
+  init_fpu_state(new_proc);
 
-  // Insert process into linked list
-  if (process_list == nullptr) {
-    process_list = new_proc;
-    process_list->next = (struct process *)process_list;
-    process_list->prev = (struct process *)process_list;
+  // A process replacing the current one with execve keeps its identity
+  struct process *current_process = get_currently_executing_process();
+  if (current_process) {
+    inherit_process_identity(current_process, new_proc);
   } else {
-    new_proc->next = process_list->next;
-    new_proc->prev = (struct process *)process_list;
-    new_proc->next->prev = new_proc;
-    process_list->next = new_proc;
+    new_proc->pid = assign_pid();
+    new_proc->parent_pid = 0;
+    new_proc->nice = 0;
+    new_proc->policy = SCHED_OTHER;
+    new_proc->rt_priority = 0;
+    reset_process_usage(new_proc);
   }
 
+  // Nothing is borrowed from a vfork parent
+  new_proc->vfork_parent = nullptr;
+  new_proc->vfork_kernel_stack = nullptr;
+  new_proc->is_kernel_thread = 0;
+  new_proc->in_syscall = 0;
+  new_proc->syscall_esp = 0;
+
+  map_vdso(new_proc);
+
+  // Set the virtual address to start at
+  new_proc->entry = entry_address;
+
+  // Insert process into the process list and run queue
+  add_process(new_proc);
+
   return 1;
 }
 
-void __attribute__((naked)) execute_processes(void) {
-  asm volatile("mov $stack_top, %esp\n"
-               "mov %esp, %ebp");
+// The scheduler loop proper, run by execute_processes on this CPU's scheduler
+// stack. Entered and left with the kernel lock held.
+extern "C" void run_scheduler(void) {
+  struct process *&current_process = current_processes[get_cpu_id()];
+
+  // Whatever syscall brought us here is over, unless it's only given up the
+  // CPU at cond_resched
+  if (current_process && !current_process->syscall_esp) {
+    current_process->in_syscall = 0;
+  }
 
   while (process_list) {
-    if (process_list->process_state == STOPPED) {
-      struct process *next_process = process_list->next;
-      cleanup_process(next_process->prev);
-      process_list = next_process;
-    } else if (process_list->process_state == RUNNABLE) {
-      uint32_t esp = process_list->esp;
-      uint32_t kernel_esp = process_list->kernel_stack_top;
-      set_tls(process_list->tls_segments[process_list->tls_segment_index]);
-      set_page_directory(process_list->page_dir);
-      restore_processor_state(esp, kernel_esp);
-      process_list->process_state =
-          STOPPED; // This will only happen if the process exited
-      process_list = process_list->next;
-    } else if (process_list->process_state == NEW) {
-      execute_new_process();
-    } else if (process_list->process_state == WAITING) {
-      struct process *current_proc = (struct process *)process_list;
-
-      // Find next non-waiting process
-      process_list = process_list->next;
-      while (process_list != current_proc &&
-             process_list->process_state == WAITING) {
-        process_list = process_list->next;
+    if (current_process == nullptr) {
+      release_fpu();
+      current_process = pick_next_process();
+      if (current_process) {
+        current_process->last_mode_switch = read_tsc();
+      } else {
+        // Nothing for this CPU to do, hlt to save power until the next timer
+        // or another CPU wakes something up for us
+        set_kernel_stack(get_scheduler_stack_top());
+        update_tick();
+        unlock_kernel();
+        asm volatile("sti\n"
+                     "hlt\n"
+                     "cli");
+        lock_kernel();
+      }
+    } else if (current_process->process_state == STOPPED) {
+      cleanup_process(current_process);
+      current_process = nullptr;
+    } else if (current_process->kill_signal &&
+               current_process->process_state != WAITING &&
+               !current_process->syscall_esp) {
+      // A syscall that was switched out part way through gets to finish
+      // first, so it doesn't leave anything half done
+      current_process->process_state = STOPPED;
+    } else if (current_process->process_state == RUNNABLE &&
+               resched_pending()) {
+      // Something woke up that's owed the CPU more
+      update_runtime(current_process);
+      account_system_time(current_process);
+      current_process->usage.involuntary_switches++;
+      requeue_preempted(current_process);
+      current_process = nullptr;
+    } else if (current_process->process_state == RUNNABLE) {
+      uint32_t esp = current_process->esp;
+      uint32_t kernel_esp = current_process->kernel_stack_top;
+      char in_kernel = current_process->is_kernel_thread;
+      if (current_process->syscall_esp) {
+        esp = current_process->syscall_esp;
+        current_process->syscall_esp = 0;
+        in_kernel = 1;
       }
+      update_tick();
+      account_system_time(current_process);
+      if (!current_process->is_kernel_thread) {
+        set_tls(
+            current_process->tls_segments[current_process->tls_segment_index]);
+        switch_fpu(current_process);
+      }
+      switch_page_directory(in_kernel ? base_page_directory
+                                      : current_process->page_dir);
 
-      // All processes are waiting, hlt to save power
-      if (process_list == current_proc) {
-        main_tss.esp0 = (uint32_t)&stack_top;
-        flush_tss();
-        asm volatile("sti\n"
-                     "hlt\n");
+      // Kernel threads and preempted syscalls keep the kernel lock while they
+      // run
+      restore_processor_state(esp, kernel_esp, !in_kernel);
+      current_process->process_state =
+          STOPPED; // This will only happen if the process exited
+    } else if (current_process->process_state == NEW) {
+      update_tick();
+      account_system_time(current_process);
+      if (current_process->is_kernel_thread) {
+        start_kernel_thread(current_process);
+      } else {
+        execute_new_process();
       }
+    } else if (current_process->process_state == WAITING) {
+      // Whatever it's waiting on will wake it back up
+      update_runtime(current_process);
+      account_system_time(current_process);
+      current_process->usage.voluntary_switches++;
+      current_process = nullptr;
     } else {
       panic("Invalid process state!");
     }
@@ -512,19 +710,211 @@ void __attribute__((naked)) execute_processes(void) {
   }
 }
 
+void __attribute__((naked)) execute_processes(void) {
+  asm volatile("call get_scheduler_stack_top\n"
+               "mov %eax, %esp\n"
+               "xor %ebp, %ebp\n"
+               "jmp run_scheduler");
+}
+
 struct process *get_currently_executing_process(void) {
-  return (struct process *)process_list;
+  return current_processes[get_cpu_id()];
+}
+
+struct process *get_running_process(uint32_t cpu_id) {
+  return current_processes[cpu_id];
 }
 
 void advance_process_queue(void) {
-  if (process_list) {
-    process_list = process_list->next;
+  struct process *current_process = current_processes[get_cpu_id()];
+  if (current_process && current_process->process_state == RUNNABLE &&
+      tick_preempt(current_process)) {
+    // The scheduler does the preempting, and until then nothing goes straight
+    // back to userspace
+    set_need_resched(current_process);
   }
 }
 
-void set_userspace_page_table(void) {
+char resume_running_process(struct process *proc) {
+  if (current_processes[get_cpu_id()] != proc || proc->is_kernel_thread ||
+      proc->process_state != RUNNABLE || proc->kill_signal ||
+      resched_pending()) {
+    return 0;
+  }
+
+  // The same as the scheduler does on the way back in, minus picking a
+  // process
+  update_tick();
+  account_system_time(proc);
+  set_tls(proc->tls_segments[proc->tls_segment_index]);
+  switch_page_directory(proc->page_dir);
+  return 1;
+}
+
+void add_process(struct process *new_proc) {
+  if (process_list == nullptr) {
+    process_list = new_proc;
+    process_list->next = (struct process *)process_list;
+    process_list->prev = (struct process *)process_list;
+  } else {
+    new_proc->next = process_list->next;
+    new_proc->prev = (struct process *)process_list;
+    new_proc->next->prev = new_proc;
+    process_list->next = new_proc;
+  }
+
+  new_proc->on_run_queue = 0;
+  new_proc->cpu = get_cpu_id();
+  select_cpu(new_proc);
+  place_new_process(new_proc);
+  enqueue_process(new_proc);
+  kick_cpu(new_proc->cpu);
+}
+
+void wake_process(struct process *to_wake) {
+  to_wake->process_state = RUNNABLE;
+  if (to_wake == current_processes[to_wake->cpu] || to_wake->on_run_queue) {
+    return;
+  }
+
+  select_cpu(to_wake);
+  place_woken_process(to_wake);
+  enqueue_process(to_wake);
+  check_wakeup_preempt(current_processes[to_wake->cpu], to_wake);
+
+  // Make sure whatever's running there gets preempted
+  if (current_processes[to_wake->cpu]) {
+    start_tick();
+  }
+  kick_cpu(to_wake->cpu);
+}
+
+void wake_process_handoff(struct process *to_wake) {
+  wake_process(to_wake);
+
+  // Handing off only makes sense if it's waiting for this CPU
+  uint32_t cpu_id = get_cpu_id();
+  if (to_wake->cpu == cpu_id && to_wake != current_processes[cpu_id]) {
+    request_handoff(current_processes[cpu_id], to_wake);
+  }
+}
+
+struct process *find_process_by_page_dir(uint32_t *page_dir) {
+  // Kernel threads run on the kernel's page directory, but don't own it
+  if (page_dir == base_page_directory) {
+    return nullptr;
+  }
+
+  // A vfork child shares its parent's page directory but owns its mappings
   struct process *current_process = get_currently_executing_process();
-  set_page_directory(current_process->page_dir);
+  if (current_process && current_process->page_dir == page_dir) {
+    return current_process;
+  }
+
+  if (process_list == nullptr) {
+    return nullptr;
+  }
+
+  struct process *current_proc = (struct process *)process_list;
+  do {
+    if (current_proc->page_dir == page_dir) {
+      return current_proc;
+    }
+    current_proc = current_proc->next;
+  } while (current_proc != process_list);
+
+  return nullptr;
+}
+
+struct process *find_process_by_pid(uint32_t pid) {
+  if (process_list == nullptr) {
+    return nullptr;
+  }
+
+  struct process *current_proc = (struct process *)process_list;
+  do {
+    if (current_proc->pid == pid) {
+      return current_proc;
+    }
+    current_proc = current_proc->next;
+  } while (current_proc != process_list);
+
+  return nullptr;
+}
+
+struct process_counts count_processes(void) {
+  struct process_counts ret = {0, 0, 0};
+  if (process_list == nullptr) {
+    return ret;
+  }
+
+  struct process *current_proc = (struct process *)process_list;
+  do {
+    ret.total++;
+    if (current_proc->process_state == RUNNABLE ||
+        current_proc->process_state == NEW) {
+      ret.runnable++;
+    } else if (current_proc->process_state == WAITING &&
+               current_proc->wait->type == VFORK_WAIT) {
+      // A vfork parent can't do anything until its child lets go
+      ret.uninterruptible++;
+    }
+    current_proc = current_proc->next;
+  } while (current_proc != process_list);
+
+  return ret;
+}
+
+uint32_t get_last_pid(void) { return next_pid - 1; }
+
+void reset_process_usage(struct process *new_proc) {
+  new_proc->exit_status = 0;
+  new_proc->kill_signal = 0;
+  new_proc->sum_exec_runtime = 0;
+  new_proc->user_cycles = 0;
+  new_proc->system_cycles = 0;
+  new_proc->last_mode_switch = read_tsc();
+  memset((char *)&new_proc->usage, sizeof(struct resource_usage), 0);
+  memset((char *)&new_proc->children_usage, sizeof(struct resource_usage), 0);
+  new_proc->exited_children = nullptr;
+  init_itimer(new_proc);
+}
+
+void inherit_process_identity(struct process *old_proc,
+                              struct process *new_proc) {
+  new_proc->pid = old_proc->pid;
+  new_proc->parent_pid = old_proc->parent_pid;
+  new_proc->nice = old_proc->nice;
+  new_proc->policy = old_proc->policy;
+  new_proc->rt_priority = old_proc->rt_priority;
+
+  new_proc->exit_status = 0;
+  new_proc->kill_signal = 0;
+  new_proc->sum_exec_runtime = old_proc->sum_exec_runtime;
+  new_proc->user_cycles = old_proc->user_cycles;
+  new_proc->system_cycles = old_proc->system_cycles;
+  new_proc->last_mode_switch = read_tsc();
+  new_proc->usage = old_proc->usage;
+  new_proc->children_usage = old_proc->children_usage;
+  new_proc->exited_children = old_proc->exited_children;
+  inherit_itimer(old_proc, new_proc);
+
+  // The old process is going away, but it isn't exiting as far as its parent
+  // is concerned. Dropping its pid before the new process is published keeps
+  // pid lookups from finding the old one instead.
+  old_proc->pid = 0;
+  old_proc->parent_pid = 0;
+  old_proc->exited_children = nullptr;
+}
+
+void set_syscall_return(struct process *proc, uint32_t value) {
+  // The kernel stack is identity mapped, so no page table gymnastics needed
+  uint32_t *saved_registers = (uint32_t *)proc->esp;
+  saved_registers[7] = value; // eax in the pushal frame
+}
+
+void set_userspace_page_table(void) {
+  set_page_directory(get_currently_executing_process()->page_dir);
 }
 
 uint32_t assign_pid(void) {
@@ -538,4 +928,19 @@ void kill_current_process(void) {
   execute_processes();
 }
 
+void kill_process(struct process *to_kill, uint32_t signal) {
+  if (to_kill->process_state == STOPPED || to_kill->kill_signal) {
+    return;
+  }
+
+  to_kill->kill_signal = signal;
+  if (to_kill->process_state == WAITING) {
+    if (to_kill->wait->type != VFORK_WAIT) {
+      wake_waiter(to_kill->wait);
+    }
+  } else {
+    kick_cpu(to_kill->cpu);
+  }
+}
+
 } // namespace proc
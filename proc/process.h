@@ -6,6 +6,7 @@
 
 #include "arch/i386/memory/gdt.h"
 #include "filesystem/file.h"
+#include "proc/wait_queue.h"
 
 namespace proc {
 
@@ -35,8 +36,33 @@ struct process_memory_segment {
 
 struct wait_reason {
   uint32_t type;
+  struct wait_queue_entry queue_entry;
+  struct wait_reason *chained; // The rest of the same wait, like a readv's
+                               // later iovecs. Never queued themselves.
 };
 
+// Information about the executable handed to the dynamic linker through the
+// aux vector
+struct elf_aux_info {
+  uint32_t program_headers; // Virtual address, 0 if they aren't mapped
+  uint32_t program_header_size;
+  uint32_t num_program_headers;
+  uint32_t entry; // The executable's entry point, not the interpreter's
+  uint32_t base;  // Where the interpreter is loaded, 0 if there isn't one
+  uint32_t brk;   // End of the executable's highest segment
+};
+
+struct resource_usage {
+  uint64_t user_time;   // Nanoseconds
+  uint64_t system_time; // Nanoseconds
+  uint32_t minor_faults;
+  uint32_t major_faults;
+  uint32_t voluntary_switches;
+  uint32_t involuntary_switches;
+};
+
+struct exited_child;
+
 struct process {
   uint32_t pid;
 
@@ -54,12 +80,23 @@ struct process {
 
   uint32_t esp; // Saved esp from the process
 
+  // Set while the process is running a syscall, which may give up the CPU
+  // part way through at cond_resched. syscall_esp is where it left off then,
+  // or 0.
+  char in_syscall;
+  uint32_t syscall_esp;
+
   uint32_t kernel_stack_top;
 
   struct tls_segment *tls_segments;
   int num_tls_segments;
   int tls_segment_index;
 
+  // FPU, SSE and AVX registers, or nullptr if it's never used them. fpu_cpu
+  // is the last CPU they were loaded on. See arch/i386/cpu/fpu.h.
+  char *fpu_state;
+  uint32_t fpu_cpu;
+
   uint32_t actual_brk;
   uint32_t brk;
 
@@ -71,6 +108,9 @@ struct process {
 
   struct file_mapping *mappings = nullptr;
 
+  // The process's page of vDSO data, see proc/vdso.h
+  void *vdso_data;
+
   struct file_descriptor *standard_in = nullptr;
   struct file_descriptor *standard_out = nullptr;
   struct file_descriptor *standard_error = nullptr;
@@ -81,6 +121,53 @@ struct process {
 
   struct wait_reason *wait;
 
+  // Set while this process is borrowing the address space of a parent that's
+  // blocked in vfork. The parent gets it back when we exec or exit.
+  struct process *vfork_parent;
+  void *vfork_kernel_stack;
+
+  // Kernel threads run in ring 0 on a stack of their own and share the
+  // kernel's address space. They have no memory segments, TLS or arguments.
+  char is_kernel_thread;
+  void (*kernel_thread_fn)(void *data);
+  void *kernel_thread_data;
+  void *kernel_thread_stack;
+
+  // Scheduling state, see proc/sched.h. Only runnable processes that aren't
+  // executing right now are on the run queue; waiting processes are parked on
+  // whatever they wait for.
+  int32_t nice;
+  uint32_t weight;
+  uint64_t vruntime;            // Weighted nanoseconds spent running
+  uint64_t sum_exec_runtime;    // Nanoseconds spent running
+  uint64_t slice_start_runtime; // sum_exec_runtime when it was last picked
+  uint64_t exec_start;          // When it was last charged for running
+  uint32_t run_queue_index;
+  char on_run_queue;
+  uint32_t cpu; // Whose run queue it's on, or the CPU it last ran on
+  uint32_t policy;
+  uint32_t rt_priority;    // Only used by real time policies
+  struct process *rt_next; // Real time run queue links
+  struct process *rt_prev;
+
+  // Accounting. usage holds everything but the times, which are worked out by
+  // splitting sum_exec_runtime between user and kernel mode in proportion to
+  // the cycles spent in each.
+  uint32_t parent_pid; // 0 if nobody wants to hear about our exit
+  uint32_t exit_status;
+  uint32_t kill_signal; // Why it was killed, see kill_process, or 0
+  uint64_t user_cycles;
+  uint64_t system_cycles;
+  uint64_t last_mode_switch; // Time stamp counter when cycles were last charged
+  struct resource_usage usage;
+  struct resource_usage children_usage; // Totals for exited children
+  struct exited_child *exited_children; // Exits not waited for yet
+
+  // ITIMER_REAL and alarm, see proc/itimer.h
+  struct timer real_timer;
+  struct time real_interval;
+
+  // Every process, whatever its state
   struct process *next;
   struct process *prev;
 };
@@ -91,26 +178,84 @@ constexpr uint32_t DEFAULT_STACK_SIZE = 0x10000;
 
 char spawn_new_process(char *path, int argc, char **argv, char **envp,
                        struct process_memory_segment *segments,
-                       uint32_t num_segments, void (*entry_address)(void),
-                       char *working_dir = "/",
+                       uint32_t num_segments, struct file_mapping *mappings,
+                       void (*entry_address)(void),
+                       struct elf_aux_info *aux_info, char *working_dir = "/",
                        struct file_descriptor *standard_in = nullptr,
                        struct file_descriptor *standard_out = nullptr,
                        struct file_descriptor *standard_error = nullptr,
                        struct file_descriptor *open_files = nullptr,
                        uint32_t next_file_descriptor = 3);
 
+// Runs the scheduler on this CPU's scheduler stack. Never returns.
 void execute_processes(void);
 
 struct process *get_currently_executing_process(void);
 
+// Returns what the given CPU is running, or nullptr if it's idle
+struct process *get_running_process(uint32_t cpu_id);
+
+// Asks for the current process to be preempted at the next scheduling point
+// if it's used up its time slice
 void advance_process_queue(void);
 
+// Gets the process that just entered the kernel, with a syscall or a tick,
+// ready to go straight back to userspace without a trip through the scheduler.
+// Returns 0 if the scheduler has to run instead, because the process blocked,
+// exited or was killed, or a tick or wake up asked for a reschedule.
+char resume_running_process(struct process *proc);
+
+// Adds a newly created process to the process list and queues it to run
+void add_process(struct process *new_proc);
+
+// Marks a waiting process runnable and queues it, on another CPU if that one
+// is idle
+void wake_process(struct process *to_wake);
+
+// Wakes a process the current one is handing work to, like the other end of a
+// pipe, and switches straight to it if that's fair
+void wake_process_handoff(struct process *to_wake);
+
+// Returns the process using page_dir, or nullptr if there isn't one
+struct process *find_process_by_page_dir(uint32_t *page_dir);
+
+// Returns the process with the given pid, or nullptr if there isn't one
+struct process *find_process_by_pid(uint32_t pid);
+
+struct process_counts {
+  uint32_t total;
+  uint32_t runnable;        // Running or waiting for the CPU
+  uint32_t uninterruptible; // Blocked on something other than an event
+};
+
+struct process_counts count_processes(void);
+
+// Returns the most recently assigned pid
+uint32_t get_last_pid(void);
+
+// Zeroes the accounting and interval timer of a brand new process
+void reset_process_usage(struct process *new_proc);
+
+// Hands the pid, parent, scheduling settings, accounting and interval timer of
+// a process over to the one replacing it, as in execve
+void inherit_process_identity(struct process *old_proc,
+                              struct process *new_proc);
+
+// Overwrites the value a process's last syscall will return
+void set_syscall_return(struct process *proc, uint32_t value);
+
 void set_userspace_page_table(void);
 
 uint32_t assign_pid(void);
 
 void kill_current_process(void);
 
+// There are no signal handlers, so a signal can only do its default action of
+// ending the process. It stops the next time its CPU goes through the
+// scheduler, and its parent sees it die of signal. A vfork parent can't go
+// until its child gives its address space back.
+void kill_process(struct process *to_kill, uint32_t signal);
+
 } // namespace proc
 
 #endif
@@ -3,11 +3,14 @@
 #include "filesystem/fat32.h"
 #include "filesystem/file.h"
 #include "filesystem/pipe.h"
+#include "filesystem/timerfd.h"
 #include "io/keyboard.h"
 #include "lib/std/memory.h"
 #include "lib/std/stdio.h"
 #include "lib/std/string.h"
+#include "proc/elf_loader.h"
 #include "proc/process.h"
+#include "proc/wait_queue.h"
 
 namespace proc {
 
@@ -18,15 +21,20 @@ using arch::memory::physical_to_virtual_memcpy;
 using arch::memory::virtual_to_physical;
 using arch::memory::virtual_to_physical_memcpy;
 using filesystem::del_fat32;
+using filesystem::directory_entry;
 using filesystem::file;
 using filesystem::file_descriptor;
+using filesystem::pin_fat32;
 using filesystem::read_fat32;
 using filesystem::read_from_pipe;
+using filesystem::read_from_timerfd;
+using filesystem::stat_fat32;
 using filesystem::write_fat32;
 using filesystem::write_new_fat32;
 using filesystem::write_to_pipe;
 using io::KEYBOARD_WAIT;
 using io::keyboard_wait;
+using io::wait_for_keyboard;
 using lib::std::kfree;
 using lib::std::kmalloc;
 using lib::std::krealloc;
@@ -41,6 +49,10 @@ uint32_t write_file(struct process *current_process, struct file *to_write,
     write_to_pipe(current_process, to_write->read_write_pipe, virtual_buf,
                   size);
     return size;
+  } else if (to_write->timerfd || to_write->buffer) {
+    // Directories and /proc files are generated, not backed by anything that
+    // could be written to
+    return -1;
   } else {
     uint8_t *buf = (uint8_t *)kmalloc(size);
     virtual_to_physical_memcpy(current_process->page_dir, (char *)virtual_buf,
@@ -48,9 +60,13 @@ uint32_t write_file(struct process *current_process, struct file *to_write,
 
     if (!to_write->inode) {
       to_write->inode = write_new_fat32(to_write->path, 0, buf, size);
+      if (to_write->inode) {
+        pin_fat32(to_write->inode);
+      }
       to_write->size = size;
       to_write->offset = size;
     } else {
+      invalidate_exec_image(to_write->inode);
       size_t new_size =
           write_fat32(to_write->path, to_write->offset, buf, size);
       if (new_size > 1) {
@@ -106,13 +122,11 @@ uint32_t read_from_keyboard(struct process *current_process, char *buf,
                             uint32_t size) {
   struct keyboard_wait *wait =
       (struct keyboard_wait *)kmalloc(sizeof(struct keyboard_wait));
-  wait->type = KEYBOARD_WAIT;
+  init_wait_reason(wait, KEYBOARD_WAIT, current_process);
   wait->buf = buf;
   wait->index = 0;
   wait->len = size;
-
-  current_process->process_state = WAITING;
-  current_process->wait = wait;
+  wait_for_keyboard(wait);
 
   return size;
 }
@@ -127,6 +141,9 @@ uint32_t read_file(struct process *current_process, struct file *to_read,
     read_from_pipe(current_process, to_read->read_write_pipe, (uint8_t *)dest,
                    size);
     return size;
+  } else if (to_read->timerfd) {
+    return read_from_timerfd(current_process, to_read->timerfd,
+                             (uint8_t *)dest, size);
   } else {
     if (to_read->buffer) {
       read_size =
@@ -247,6 +264,11 @@ uint32_t unlink(uint32_t path_addr, uint32_t reserved1, uint32_t reserved2,
   struct process *current_process = get_currently_executing_process();
   uint32_t *page_dir = current_process->page_dir;
   char *path = make_virtual_string_copy(page_dir, (char *)path_addr);
+  struct directory_entry entry = stat_fat32(path);
+  if (entry.name) {
+    invalidate_exec_image(entry.inode);
+    kfree(entry.name);
+  }
   del_fat32(path);
   kfree(path);
   return 0;
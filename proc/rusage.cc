@@ -0,0 +1,187 @@
+#include <stdint.h>
+
+#include "arch/i386/cpu/model_specific.h"
+#include "arch/i386/memory/paging.h"
+#include "lib/math.h"
+#include "lib/std/memory.h"
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/process.h"
+#include "proc/rusage.h"
+#include "proc/sched.h"
+
+namespace proc {
+
+namespace {
+
+using arch::cpu::read_tsc;
+using arch::memory::physical_to_virtual_memcpy;
+using lib::divide;
+using lib::std::memset;
+using lib::std::system_time;
+using lib::std::update_system_time;
+
+constexpr int32_t RUSAGE_SELF = 0;
+constexpr int32_t RUSAGE_CHILDREN = -1;
+constexpr int32_t RUSAGE_THREAD = 1;
+
+// times reports in units of 1/USER_HZ seconds
+constexpr uint32_t USER_HZ = 100;
+constexpr uint32_t NANOSECONDS_PER_CLOCK_TICK = 1000000000 / USER_HZ;
+
+struct timeval {
+  uint32_t seconds;
+  uint32_t microseconds;
+};
+
+struct rusage {
+  struct timeval ru_utime;
+  struct timeval ru_stime;
+  uint32_t ru_maxrss;
+  uint32_t ru_ixrss;
+  uint32_t ru_idrss;
+  uint32_t ru_isrss;
+  uint32_t ru_minflt;
+  uint32_t ru_majflt;
+  uint32_t ru_nswap;
+  uint32_t ru_inblock;
+  uint32_t ru_oublock;
+  uint32_t ru_msgsnd;
+  uint32_t ru_msgrcv;
+  uint32_t ru_nsignals;
+  uint32_t ru_nvcsw;
+  uint32_t ru_nivcsw;
+};
+
+struct tms {
+  uint32_t tms_utime;
+  uint32_t tms_stime;
+  uint32_t tms_cutime;
+  uint32_t tms_cstime;
+};
+
+// Returns total * part / whole without overflowing, for part <= whole
+uint64_t scale(uint64_t total, uint64_t part, uint64_t whole) {
+  // Drop precision until the remainder product fits in 64 bits
+  while ((whole >> 32) || (part >> 32)) {
+    part >>= 1;
+    whole >>= 1;
+  }
+  uint64_t quotient = divide(total, whole);
+  uint64_t remainder = total - quotient * whole;
+  return quotient * part + divide(remainder * part, whole);
+}
+
+struct timeval to_timeval(uint64_t nanoseconds) {
+  struct timeval ret;
+  ret.seconds = divide(nanoseconds, 1000000000);
+  ret.microseconds =
+      (uint32_t)(nanoseconds - (uint64_t)ret.seconds * 1000000000) / 1000;
+  return ret;
+}
+
+uint32_t to_clock_ticks(uint64_t nanoseconds) {
+  return divide(nanoseconds, NANOSECONDS_PER_CLOCK_TICK);
+}
+
+} // namespace
+
+void account_user_time(struct process *proc) {
+  uint64_t now = read_tsc();
+  proc->user_cycles += now - proc->last_mode_switch;
+  proc->last_mode_switch = now;
+}
+
+void account_system_time(struct process *proc) {
+  uint64_t now = read_tsc();
+  proc->system_cycles += now - proc->last_mode_switch;
+  proc->last_mode_switch = now;
+}
+
+void get_resource_usage(struct process *proc, struct resource_usage *usage) {
+  if (proc == get_currently_executing_process()) {
+    update_system_time();
+    update_runtime(proc);
+  }
+
+  *usage = proc->usage;
+
+  // The cycle counts aren't in a known unit, but the split between them is
+  // good enough to divide up the scheduler's runtime
+  uint64_t runtime = proc->sum_exec_runtime;
+  uint64_t total_cycles = proc->user_cycles + proc->system_cycles;
+  if (!total_cycles) {
+    usage->user_time = runtime;
+    usage->system_time = 0;
+  } else {
+    usage->user_time = scale(runtime, proc->user_cycles, total_cycles);
+    usage->system_time = runtime - usage->user_time;
+  }
+}
+
+void add_resource_usage(struct resource_usage *total,
+                        struct resource_usage *to_add) {
+  total->user_time += to_add->user_time;
+  total->system_time += to_add->system_time;
+  total->minor_faults += to_add->minor_faults;
+  total->major_faults += to_add->major_faults;
+  total->voluntary_switches += to_add->voluntary_switches;
+  total->involuntary_switches += to_add->involuntary_switches;
+}
+
+void write_rusage(uint32_t *page_dir, uint32_t rusage_addr,
+                  struct resource_usage *usage) {
+  struct rusage ret;
+  memset((char *)&ret, sizeof(struct rusage), 0);
+  ret.ru_utime = to_timeval(usage->user_time);
+  ret.ru_stime = to_timeval(usage->system_time);
+  ret.ru_minflt = usage->minor_faults;
+  ret.ru_majflt = usage->major_faults;
+  ret.ru_nvcsw = usage->voluntary_switches;
+  ret.ru_nivcsw = usage->involuntary_switches;
+
+  physical_to_virtual_memcpy(page_dir, (char *)&ret, (char *)rusage_addr,
+                             sizeof(struct rusage));
+}
+
+uint32_t times(uint32_t tms_addr, uint32_t reserved1, uint32_t reserved2,
+               uint32_t reserved3, uint32_t reserved4, uint32_t reserved5) {
+  struct process *current_process = get_currently_executing_process();
+
+  struct resource_usage usage;
+  get_resource_usage(current_process, &usage);
+
+  if (tms_addr) {
+    struct tms ret;
+    ret.tms_utime = to_clock_ticks(usage.user_time);
+    ret.tms_stime = to_clock_ticks(usage.system_time);
+    ret.tms_cutime = to_clock_ticks(current_process->children_usage.user_time);
+    ret.tms_cstime =
+        to_clock_ticks(current_process->children_usage.system_time);
+    physical_to_virtual_memcpy(current_process->page_dir, (char *)&ret,
+                               (char *)tms_addr, sizeof(struct tms));
+  }
+
+  return system_time.seconds * USER_HZ +
+         system_time.nanoseconds / NANOSECONDS_PER_CLOCK_TICK;
+}
+
+uint32_t getrusage(uint32_t who, uint32_t usage_addr, uint32_t reserved1,
+                   uint32_t reserved2, uint32_t reserved3, uint32_t reserved4) {
+  struct process *current_process = get_currently_executing_process();
+
+  struct resource_usage usage;
+  if ((int32_t)who == RUSAGE_SELF || (int32_t)who == RUSAGE_THREAD) {
+    get_resource_usage(current_process, &usage);
+  } else if ((int32_t)who == RUSAGE_CHILDREN) {
+    usage = current_process->children_usage;
+  } else {
+    return -1;
+  }
+
+  write_rusage(current_process->page_dir, usage_addr, &usage);
+
+  return 0;
+}
+
+} // namespace proc
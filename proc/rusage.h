@@ -0,0 +1,37 @@
+#ifndef PROC_RUSAGE_H
+#define PROC_RUSAGE_H
+
+#include <stdint.h>
+
+#include "proc/process.h"
+
+namespace proc {
+
+// Charges the cycles since the process last switched modes to user mode.
+// Called on every entry into the kernel from userspace.
+void account_user_time(struct process *proc);
+
+// Charges the cycles since the process last switched modes to the kernel.
+// Called whenever a process returns to userspace or gives up the CPU.
+void account_system_time(struct process *proc);
+
+// Fills in usage for a process, splitting its runtime into user and system
+// time
+void get_resource_usage(struct process *proc, struct resource_usage *usage);
+
+void add_resource_usage(struct resource_usage *total,
+                        struct resource_usage *to_add);
+
+// Copies usage out to a struct rusage in userspace
+void write_rusage(uint32_t *page_dir, uint32_t rusage_addr,
+                  struct resource_usage *usage);
+
+uint32_t times(uint32_t tms_addr, uint32_t reserved1, uint32_t reserved2,
+               uint32_t reserved3, uint32_t reserved4, uint32_t reserved5);
+
+uint32_t getrusage(uint32_t who, uint32_t usage_addr, uint32_t reserved1,
+                   uint32_t reserved2, uint32_t reserved3, uint32_t reserved4);
+
+} // namespace proc
+
+#endif
@@ -0,0 +1,711 @@
+#include "proc/sched.h"
+#include "arch/i386/cpu/smp.h"
+#include "lib/math.h"
+#include "lib/std/memory.h"
+#include "lib/std/string.h"
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/process.h"
+
+namespace proc {
+
+namespace {
+
+using arch::cpu::get_cpu_id;
+using arch::cpu::get_num_cpus;
+using arch::cpu::MAX_CPUS;
+using lib::divide_by_u32;
+using lib::std::kmalloc;
+using lib::std::krealloc;
+using lib::std::sprintnk;
+using lib::std::system_time;
+using lib::std::update_system_time;
+
+// Every runnable process should get a turn within this many microseconds...
+constexpr uint32_t SCHED_LATENCY_US = 6000;
+// ...unless there are so many that slices would get shorter than this
+constexpr uint32_t MIN_GRANULARITY_US = 750;
+// How much less virtual runtime a woken process needs to preempt
+constexpr uint64_t WAKEUP_GRANULARITY = 1000000;
+
+constexpr uint32_t NICE_0_WEIGHT = 1024;
+constexpr uint32_t INITIAL_RUN_QUEUE_CAPACITY = 16;
+
+constexpr uint64_t RR_TIME_SLICE = 100000000;
+// Real time processes may only use RT_RUNTIME out of every RT_PERIOD while
+// anything else is runnable
+constexpr uint64_t RT_PERIOD = 1000000000;
+constexpr uint64_t RT_RUNTIME = 950000000;
+
+// Each nice level is worth about 10% of the CPU
+const uint32_t nice_to_weight[40] = {
+    88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+    9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+    1024,  820,   655,   526,   423,   335,   272,   215,   172,   137,
+    110,   87,    70,    56,    45,    36,    29,    23,    18,    15};
+
+// 2^32 / weight, so scaling runtime doesn't need a 64 bit divide
+const uint32_t nice_to_inverse_weight[40] = {
+    48388,     59856,     76039,     92817,     118348,    147320,
+    184698,    229616,    287308,    360437,    449829,    563644,
+    704092,    875808,    1099582,   1376151,   1717299,   2157191,
+    2708049,   3363325,   4194304,   5237764,   6557201,   8165337,
+    10153586,  12820797,  15790320,  19976592,  24970740,  31350126,
+    39045157,  49367440,  61356675,  76695844,  95443717,  119304647,
+    148102320, 186737708, 238609294, 286331153};
+
+// A FIFO per real time priority
+struct rt_queue {
+  struct process *head;
+  struct process *tail;
+};
+
+struct run_queue {
+  // Binary min-heap of runnable normal processes ordered by virtual runtime
+  struct process **heap;
+  uint32_t size;
+  uint32_t capacity;
+  uint32_t weight;
+
+  // Never goes backwards, so sleepers can be placed relative to it
+  uint64_t min_vruntime;
+
+  char need_resched;
+  uint64_t resched_time; // When the process should have been preempted
+
+  // Preferred and passed over by the next pick, respectively
+  struct process *handoff_target;
+  struct process *yielded;
+
+  // Real time processes, with a bitmap of the non empty priorities
+  struct rt_queue rt_queues[MAX_RT_PRIORITY + 1];
+  uint32_t rt_bitmap[(MAX_RT_PRIORITY + 32) / 32];
+  uint32_t rt_queue_size;
+
+  uint64_t rt_period_start;
+  uint64_t rt_time;
+  char rt_throttled;
+};
+
+struct run_queue run_queues[MAX_CPUS];
+
+struct run_queue *this_run_queue(void) { return &run_queues[get_cpu_id()]; }
+
+struct run_queue *run_queue_of(struct process *proc) {
+  return &run_queues[proc->cpu];
+}
+
+char is_rt(struct process *proc) {
+  return proc->policy == SCHED_FIFO || proc->policy == SCHED_RR;
+}
+
+uint64_t now(void) {
+  return (uint64_t)system_time.seconds * 1000000000 + system_time.nanoseconds;
+}
+
+void record_latency(uint64_t latency) {
+  sched_latency_stats.reschedules++;
+  sched_latency_stats.total_latency += latency;
+  if (latency > sched_latency_stats.max_latency) {
+    sched_latency_stats.max_latency = latency;
+  }
+}
+
+// Latency counts from the first request, later ones don't make it any later
+void request_resched(struct run_queue *rq, uint64_t due) {
+  if (!rq->need_resched) {
+    rq->need_resched = 1;
+    rq->resched_time = due;
+  }
+}
+
+char vruntime_before(struct process *a, struct process *b) {
+  return (int64_t)(a->vruntime - b->vruntime) < 0;
+}
+
+// Scales real runtime to virtual runtime
+uint64_t weighted_runtime(uint64_t delta, struct process *proc) {
+  if (proc->weight == NICE_0_WEIGHT) {
+    return delta;
+  }
+
+  if (delta > 0xFFFFFFFF) {
+    delta = 0xFFFFFFFF;
+  }
+  return (delta * nice_to_inverse_weight[proc->nice - MIN_NICE]) >> 22;
+}
+
+// The real time slice a process gets out of the scheduling period
+uint64_t time_slice(struct process *proc) {
+  struct run_queue *rq = run_queue_of(proc);
+  uint32_t num_running = rq->size + 1;
+  uint32_t period_us = SCHED_LATENCY_US;
+  if (num_running * MIN_GRANULARITY_US > period_us) {
+    period_us = num_running * MIN_GRANULARITY_US;
+  }
+
+  uint32_t total_weight = rq->weight;
+  if (!proc->on_run_queue) {
+    total_weight += proc->weight;
+  }
+
+  uint32_t slice_us =
+      divide_by_u32((uint64_t)period_us * proc->weight, total_weight);
+  if (slice_us < MIN_GRANULARITY_US) {
+    slice_us = MIN_GRANULARITY_US;
+  }
+  return (uint64_t)slice_us * 1000;
+}
+
+void update_min_vruntime(struct process *running) {
+  struct run_queue *rq = run_queue_of(running);
+  uint64_t vruntime = rq->min_vruntime;
+  char found = 0;
+
+  if (running && running->process_state == RUNNABLE && !is_rt(running)) {
+    vruntime = running->vruntime;
+    found = 1;
+  }
+
+  if (rq->size &&
+      (!found || (int64_t)(rq->heap[0]->vruntime - vruntime) < 0)) {
+    vruntime = rq->heap[0]->vruntime;
+    found = 1;
+  }
+
+  if (found && (int64_t)(vruntime - rq->min_vruntime) > 0) {
+    rq->min_vruntime = vruntime;
+  }
+}
+
+void place_process(struct run_queue *rq, struct process *to_place,
+                   uint32_t index) {
+  rq->heap[index] = to_place;
+  to_place->run_queue_index = index;
+}
+
+void sift_up(struct run_queue *rq, uint32_t index) {
+  struct process *to_sift = rq->heap[index];
+  while (index) {
+    uint32_t parent = (index - 1) / 2;
+    if (!vruntime_before(to_sift, rq->heap[parent])) {
+      break;
+    }
+    place_process(rq, rq->heap[parent], index);
+    index = parent;
+  }
+  place_process(rq, to_sift, index);
+}
+
+void sift_down(struct run_queue *rq, uint32_t index) {
+  struct process *to_sift = rq->heap[index];
+  while (1) {
+    uint32_t child = 2 * index + 1;
+    if (child >= rq->size) {
+      break;
+    }
+    if (child + 1 < rq->size &&
+        vruntime_before(rq->heap[child + 1], rq->heap[child])) {
+      child++;
+    }
+    if (!vruntime_before(rq->heap[child], to_sift)) {
+      break;
+    }
+    place_process(rq, rq->heap[child], index);
+    index = child;
+  }
+  place_process(rq, to_sift, index);
+}
+
+void rt_enqueue(struct process *to_enqueue, char at_head) {
+  struct run_queue *rq = run_queue_of(to_enqueue);
+  struct rt_queue *queue = &rq->rt_queues[to_enqueue->rt_priority];
+  if (!queue->head) {
+    to_enqueue->rt_next = nullptr;
+    to_enqueue->rt_prev = nullptr;
+    queue->head = to_enqueue;
+    queue->tail = to_enqueue;
+  } else if (at_head) {
+    to_enqueue->rt_next = queue->head;
+    to_enqueue->rt_prev = nullptr;
+    queue->head->rt_prev = to_enqueue;
+    queue->head = to_enqueue;
+  } else {
+    to_enqueue->rt_next = nullptr;
+    to_enqueue->rt_prev = queue->tail;
+    queue->tail->rt_next = to_enqueue;
+    queue->tail = to_enqueue;
+  }
+
+  rq->rt_bitmap[to_enqueue->rt_priority / 32] |=
+      1 << (to_enqueue->rt_priority % 32);
+  rq->rt_queue_size++;
+  to_enqueue->on_run_queue = 1;
+}
+
+void rt_dequeue(struct process *to_dequeue) {
+  struct run_queue *rq = run_queue_of(to_dequeue);
+  struct rt_queue *queue = &rq->rt_queues[to_dequeue->rt_priority];
+  if (to_dequeue->rt_prev) {
+    to_dequeue->rt_prev->rt_next = to_dequeue->rt_next;
+  } else {
+    queue->head = to_dequeue->rt_next;
+  }
+  if (to_dequeue->rt_next) {
+    to_dequeue->rt_next->rt_prev = to_dequeue->rt_prev;
+  } else {
+    queue->tail = to_dequeue->rt_prev;
+  }
+
+  if (!queue->head) {
+    rq->rt_bitmap[to_dequeue->rt_priority / 32] &=
+        ~(1 << (to_dequeue->rt_priority % 32));
+  }
+  rq->rt_queue_size--;
+  to_dequeue->on_run_queue = 0;
+}
+
+// Returns the highest queued real time priority, or 0 if there are none
+uint32_t highest_rt_priority(struct run_queue *rq) {
+  for (int i = sizeof(rq->rt_bitmap) / sizeof(uint32_t) - 1; i >= 0; i--) {
+    if (rq->rt_bitmap[i]) {
+      return i * 32 + 31 - __builtin_clz(rq->rt_bitmap[i]);
+    }
+  }
+  return 0;
+}
+
+void update_rt_period(struct run_queue *rq, uint64_t current_time) {
+  if (current_time - rq->rt_period_start >= RT_PERIOD) {
+    rq->rt_period_start = current_time;
+    rq->rt_time = 0;
+    rq->rt_throttled = 0;
+  }
+}
+
+// Real time processes get to run unless they're throttled and there's
+// someone else to run instead
+char rt_may_run(struct run_queue *rq) {
+  return rq->rt_queue_size && (!rq->rt_throttled || !rq->size);
+}
+
+char cpu_idle(uint32_t cpu_id) {
+  struct run_queue *rq = &run_queues[cpu_id];
+  return !get_running_process(cpu_id) && !rq->size && !rq->rt_queue_size;
+}
+
+// Moves a process that isn't queued to another CPU's run queue, keeping its
+// virtual runtime in the same place relative to the others there
+void migrate_process(struct process *proc, uint32_t cpu_id) {
+  if (proc->cpu == cpu_id) {
+    return;
+  }
+  if (!is_rt(proc)) {
+    proc->vruntime = proc->vruntime - run_queue_of(proc)->min_vruntime +
+                     run_queues[cpu_id].min_vruntime;
+  }
+  proc->cpu = cpu_id;
+}
+
+// Pulls a process over from the busiest CPU if it has more queued than we do.
+// Only the queues are looked at, so a CPU's running process stays put.
+void balance(struct run_queue *rq, uint32_t cpu_id) {
+  struct run_queue *busiest = nullptr;
+  struct run_queue *rt_source = nullptr;
+  for (uint32_t i = 0; i < get_num_cpus(); i++) {
+    struct run_queue *other = &run_queues[i];
+    if (other == rq) {
+      continue;
+    }
+    if (other->size && (!busiest || other->size > busiest->size)) {
+      busiest = other;
+    }
+    if (other->rt_queue_size && !rt_source) {
+      rt_source = other;
+    }
+  }
+
+  // A real time process waiting behind another is worth more than anything
+  if (rt_source && !rq->rt_queue_size) {
+    struct process *stolen =
+        rt_source->rt_queues[highest_rt_priority(rt_source)].head;
+    rt_dequeue(stolen);
+    migrate_process(stolen, cpu_id);
+    rt_enqueue(stolen, 0);
+    return;
+  }
+
+  // Evening out one process only swaps which CPU has the extra
+  if (!busiest || (rq->size && busiest->size <= rq->size + 1)) {
+    return;
+  }
+
+  // The last leaf is cheap to remove and unlikely to be the next pick there
+  struct process *stolen = busiest->heap[busiest->size - 1];
+  dequeue_process(stolen);
+  migrate_process(stolen, cpu_id);
+  enqueue_process(stolen);
+}
+
+} // namespace
+
+struct sched_latency_stats sched_latency_stats = {0, 0, 0};
+
+void set_scheduler(struct process *to_set, uint32_t policy,
+                   uint32_t priority) {
+  char queued = to_set->on_run_queue;
+  if (queued) {
+    dequeue_process(to_set);
+  }
+
+  char was_rt = is_rt(to_set);
+  to_set->policy = policy;
+  to_set->rt_priority = is_rt(to_set) ? priority : 0;
+
+  // It didn't accumulate virtual runtime while it was real time
+  struct run_queue *rq = run_queue_of(to_set);
+  if (was_rt && !is_rt(to_set) &&
+      (int64_t)(to_set->vruntime - rq->min_vruntime) < 0) {
+    to_set->vruntime = rq->min_vruntime;
+  }
+
+  if (queued) {
+    enqueue_process(to_set);
+  }
+
+  // Let the next scheduling point sort out who should be running now
+  request_resched(rq, now());
+}
+
+uint64_t get_time_slice(struct process *proc) {
+  if (proc->policy == SCHED_FIFO) {
+    return 0;
+  } else if (proc->policy == SCHED_RR) {
+    return RR_TIME_SLICE;
+  } else {
+    return time_slice(proc);
+  }
+}
+
+void set_nice(struct process *to_set, int32_t nice) {
+  if (nice < MIN_NICE) {
+    nice = MIN_NICE;
+  } else if (nice > MAX_NICE) {
+    nice = MAX_NICE;
+  }
+
+  // Only CFS tasks count towards the run queue weight
+  char weighted = to_set->on_run_queue && !is_rt(to_set);
+  if (weighted) {
+    run_queue_of(to_set)->weight -= to_set->weight;
+  }
+  to_set->nice = nice;
+  to_set->weight = nice_to_weight[nice - MIN_NICE];
+  if (weighted) {
+    run_queue_of(to_set)->weight += to_set->weight;
+  }
+}
+
+void select_cpu(struct process *proc) {
+  if (cpu_idle(proc->cpu)) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < get_num_cpus(); i++) {
+    if (cpu_idle(i)) {
+      migrate_process(proc, i);
+      return;
+    }
+  }
+}
+
+void place_new_process(struct process *new_proc) {
+  set_nice(new_proc, new_proc->nice);
+  new_proc->slice_start_runtime = new_proc->sum_exec_runtime;
+  new_proc->exec_start = now();
+  new_proc->vruntime = run_queue_of(new_proc)->min_vruntime +
+                       weighted_runtime(time_slice(new_proc), new_proc);
+}
+
+void place_woken_process(struct process *woken) {
+  if (is_rt(woken)) {
+    return;
+  }
+
+  uint64_t credit = (uint64_t)SCHED_LATENCY_US * 1000 / 2;
+  uint64_t floor = run_queue_of(woken)->min_vruntime - credit;
+  if ((int64_t)(woken->vruntime - floor) < 0) {
+    woken->vruntime = floor;
+  }
+}
+
+void enqueue_process(struct process *to_enqueue) {
+  if (to_enqueue->on_run_queue) {
+    return;
+  }
+
+  if (is_rt(to_enqueue)) {
+    rt_enqueue(to_enqueue, 0);
+    return;
+  }
+
+  struct run_queue *rq = run_queue_of(to_enqueue);
+  if (rq->size == rq->capacity) {
+    rq->capacity =
+        rq->capacity ? 2 * rq->capacity : INITIAL_RUN_QUEUE_CAPACITY;
+    if (rq->heap) {
+      rq->heap = (struct process **)krealloc(
+          rq->heap, rq->capacity * sizeof(struct process *));
+    } else {
+      rq->heap =
+          (struct process **)kmalloc(rq->capacity * sizeof(struct process *));
+    }
+  }
+
+  to_enqueue->on_run_queue = 1;
+  rq->weight += to_enqueue->weight;
+  place_process(rq, to_enqueue, rq->size);
+  rq->size++;
+  sift_up(rq, to_enqueue->run_queue_index);
+}
+
+void dequeue_process(struct process *to_dequeue) {
+  struct run_queue *rq = run_queue_of(to_dequeue);
+  if (to_dequeue == rq->handoff_target) {
+    rq->handoff_target = nullptr;
+  }
+
+  if (!to_dequeue->on_run_queue) {
+    return;
+  }
+
+  if (is_rt(to_dequeue)) {
+    rt_dequeue(to_dequeue);
+    return;
+  }
+
+  uint32_t index = to_dequeue->run_queue_index;
+  to_dequeue->on_run_queue = 0;
+  rq->weight -= to_dequeue->weight;
+  rq->size--;
+  if (index == rq->size) {
+    return;
+  }
+
+  // The last process fills the hole and may need to move either way
+  struct process *moved = rq->heap[rq->size];
+  place_process(rq, moved, index);
+  sift_down(rq, index);
+  sift_up(rq, moved->run_queue_index);
+}
+
+void requeue_preempted(struct process *preempted) {
+  if (is_rt(preempted)) {
+    uint64_t ran =
+        preempted->sum_exec_runtime - preempted->slice_start_runtime;
+    rt_enqueue(preempted, preempted != run_queue_of(preempted)->yielded &&
+                              (preempted->policy == SCHED_FIFO ||
+                               ran < RR_TIME_SLICE));
+  } else {
+    enqueue_process(preempted);
+  }
+}
+
+struct process *pick_next_process(void) {
+  uint32_t cpu_id = get_cpu_id();
+  struct run_queue *rq = &run_queues[cpu_id];
+  update_rt_period(rq, now());
+  balance(rq, cpu_id);
+
+  struct process *next;
+  if (rt_may_run(rq)) {
+    next = rq->rt_queues[highest_rt_priority(rq)].head;
+  } else if (rq->size) {
+    next = rq->heap[0];
+
+    // The runner up is one of the root's children
+    if (next == rq->yielded && rq->size > 1) {
+      next = rq->heap[1];
+      if (rq->size > 2 && vruntime_before(rq->heap[2], next)) {
+        next = rq->heap[2];
+      }
+    }
+
+    // Take the handoff unless it'd let the target get more than a slice
+    // ahead of the most deserving process
+    struct process *handoff_target = rq->handoff_target;
+    if (handoff_target && handoff_target->on_run_queue &&
+        !is_rt(handoff_target) &&
+        (int64_t)(handoff_target->vruntime - next->vruntime) <
+            (int64_t)weighted_runtime(time_slice(handoff_target),
+                                      handoff_target)) {
+      next = handoff_target;
+    }
+  } else {
+    return nullptr;
+  }
+  dequeue_process(next);
+
+  rq->handoff_target = nullptr;
+  rq->yielded = nullptr;
+
+  if (rq->need_resched) {
+    // The clock may not have been read since a long syscall started
+    update_system_time();
+    rq->need_resched = 0;
+    record_latency(now() - rq->resched_time);
+  }
+
+  next->exec_start = now();
+  next->slice_start_runtime = next->sum_exec_runtime;
+
+  return next;
+}
+
+char run_queue_empty(void) {
+  for (uint32_t i = 0; i < get_num_cpus(); i++) {
+    if (run_queues[i].size || run_queues[i].rt_queue_size) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void update_runtime(struct process *running) {
+  uint64_t current_time = now();
+  if (current_time > running->exec_start) {
+    uint64_t delta = current_time - running->exec_start;
+    running->sum_exec_runtime += delta;
+    if (is_rt(running)) {
+      struct run_queue *rq = run_queue_of(running);
+      update_rt_period(rq, current_time);
+      rq->rt_time += delta;
+      if (rq->rt_time >= RT_RUNTIME) {
+        rq->rt_throttled = 1;
+      }
+    } else {
+      running->vruntime += weighted_runtime(delta, running);
+    }
+  }
+  running->exec_start = current_time;
+
+  update_min_vruntime(running);
+}
+
+char tick_preempt(struct process *running) {
+  struct run_queue *rq = run_queue_of(running);
+  update_runtime(running);
+
+  if (is_rt(running)) {
+    if (rq->rt_throttled && rq->size) {
+      return 1;
+    }
+
+    uint32_t highest_priority = highest_rt_priority(rq);
+    if (highest_priority > running->rt_priority) {
+      return 1;
+    }
+
+    uint64_t ran = running->sum_exec_runtime - running->slice_start_runtime;
+    return running->policy == SCHED_RR && ran >= RR_TIME_SLICE &&
+           highest_priority == running->rt_priority;
+  }
+
+  if (rt_may_run(rq)) {
+    return 1;
+  }
+
+  if (!rq->size) {
+    return 0;
+  }
+
+  uint64_t ideal_runtime = time_slice(running);
+  uint64_t ran = running->sum_exec_runtime - running->slice_start_runtime;
+  if (ran >= ideal_runtime) {
+    return 1;
+  }
+
+  // Let it run a little before comparing it to the others
+  if (ran < (uint64_t)MIN_GRANULARITY_US * 1000) {
+    return 0;
+  }
+
+  // Don't let it get too far ahead of the most deserving process either
+  return (int64_t)(running->vruntime - rq->heap[0]->vruntime) >
+         (int64_t)ideal_runtime;
+}
+
+void check_wakeup_preempt(struct process *running, struct process *woken) {
+  if (!running || running->process_state != RUNNABLE) {
+    return;
+  }
+
+  struct run_queue *rq = run_queue_of(woken);
+  if (is_rt(woken)) {
+    if (!is_rt(running) || woken->rt_priority > running->rt_priority) {
+      request_resched(rq, now());
+    }
+    return;
+  } else if (is_rt(running)) {
+    return;
+  }
+
+  update_runtime(running);
+  if ((int64_t)(running->vruntime - woken->vruntime) >
+      (int64_t)weighted_runtime(WAKEUP_GRANULARITY, woken)) {
+    request_resched(rq, now());
+  }
+}
+
+char resched_pending(void) { return this_run_queue()->need_resched; }
+
+void set_need_resched(struct process *running) {
+  // Ticks and preemption points only notice a slice has run out some time
+  // after it did
+  uint64_t due = now();
+  uint64_t slice = get_time_slice(running);
+  uint64_t ran = running->sum_exec_runtime - running->slice_start_runtime;
+  if (slice && ran > slice && ran - slice < due) {
+    due -= ran - slice;
+  }
+  request_resched(this_run_queue(), due);
+}
+
+uint32_t read_sched_latency(char *buf, uint32_t max_size) {
+  uint32_t average = 0;
+  if (sched_latency_stats.reschedules) {
+    average = divide_by_u32(sched_latency_stats.total_latency,
+                            sched_latency_stats.reschedules);
+  }
+
+  // Saturates at about 4 seconds, like /proc/timer_stats
+  uint32_t max = sched_latency_stats.max_latency > 0xFFFFFFFF
+                     ? 0xFFFFFFFF
+                     : (uint32_t)sched_latency_stats.max_latency;
+
+  int written = sprintnk(buf, max_size,
+                         "reschedules %d\nmean_latency %d\nmax_latency %d\n",
+                         sched_latency_stats.reschedules, average, max);
+  return written < 0 ? 0 : written;
+}
+
+void request_handoff(struct process *running, struct process *woken) {
+  // Real time processes keep the CPU, and real time wake ups already preempt
+  if (is_rt(woken) || (running && is_rt(running))) {
+    return;
+  }
+
+  struct run_queue *rq = run_queue_of(woken);
+  rq->handoff_target = woken;
+  if (running && running->process_state == RUNNABLE) {
+    request_resched(rq, now());
+  }
+}
+
+void yield_process(struct process *running) {
+  struct run_queue *rq = run_queue_of(running);
+  rq->yielded = running;
+  request_resched(rq, now());
+}
+
+} // namespace proc
@@ -0,0 +1,111 @@
+#ifndef PROC_SCHED_H
+#define PROC_SCHED_H
+
+#include <stdint.h>
+
+#include "proc/process.h"
+
+namespace proc {
+
+// A CFS style fair scheduler. Every process accumulates virtual runtime, its
+// real runtime scaled by its nice weight, and the runnable process that has
+// had the least goes next.
+//
+// Real time processes (SCHED_FIFO and SCHED_RR) sit above that in static
+// priority order and always run first, save for a throttle that keeps back 5%
+// of every second for everyone else.
+//
+// Every CPU has a run queue of its own. Woken processes go to an idle CPU if
+// there is one, and a CPU that runs out of work pulls some from the busiest.
+
+constexpr int32_t MIN_NICE = -20;
+constexpr int32_t MAX_NICE = 19;
+
+constexpr uint32_t SCHED_OTHER = 0;
+constexpr uint32_t SCHED_FIFO = 1;
+constexpr uint32_t SCHED_RR = 2;
+
+constexpr uint32_t MIN_RT_PRIORITY = 1;
+constexpr uint32_t MAX_RT_PRIORITY = 99;
+
+// How long CPUs take to switch away from a process once they should, in
+// nanoseconds: from a wake up asking for the CPU, or the running process's
+// slice running out, to the scheduler picking what runs next. It's bounded by
+// the tick and by how long the kernel goes between preemption points.
+struct sched_latency_stats {
+  uint32_t reschedules;
+  uint64_t total_latency;
+  uint64_t max_latency;
+};
+
+extern struct sched_latency_stats sched_latency_stats;
+
+// Changes a process's policy. priority is only meaningful for real time
+// policies.
+void set_scheduler(struct process *to_set, uint32_t policy, uint32_t priority);
+
+// How long the process gets to run at a time, in nanoseconds. 0 means forever.
+uint64_t get_time_slice(struct process *proc);
+
+// Sets the nice value and weight of a process, clamping it to the valid range
+void set_nice(struct process *to_set, int32_t nice);
+
+// Moves a process that isn't queued to the CPU it should run on next: where
+// it ran last if that CPU is idle, otherwise any idle CPU
+void select_cpu(struct process *proc);
+
+// Starts a new process's virtual runtime a slice behind everyone else's, so
+// forking doesn't let a process cut in line
+void place_new_process(struct process *new_proc);
+
+// Catches a process that slept up to the others, minus a bit of credit so it
+// gets to run soon after it wakes
+void place_woken_process(struct process *woken);
+
+void enqueue_process(struct process *to_enqueue);
+
+void dequeue_process(struct process *to_dequeue);
+
+// Puts a process that was just preempted back on the run queue. Real time
+// processes go back to the front of their queue unless their round robin
+// slice is used up.
+void requeue_preempted(struct process *preempted);
+
+// Removes and returns the process this CPU should run next, or nullptr if
+// nothing is runnable. Steals from another CPU if this one is short of work.
+struct process *pick_next_process(void);
+
+// Returns 1 if nothing is waiting for a turn on any CPU
+char run_queue_empty(void);
+
+// Charges the running process for the time since it was last charged
+void update_runtime(struct process *running);
+
+// Returns 1 if the running process has used up its slice. Called every tick.
+char tick_preempt(struct process *running);
+
+// Asks for the running process to be preempted at the next scheduling point
+// if the newly woken process is owed the CPU more
+void check_wakeup_preempt(struct process *running, struct process *woken);
+
+// Returns 1 if a tick or a wake up asked for this CPU's process to be
+// preempted
+char resched_pending(void);
+
+// Asks for the running process to be preempted at the next scheduling point,
+// once tick_preempt says it should be
+void set_need_resched(struct process *running);
+
+// Switches straight to a process the running one just woke to hand it work,
+// as long as that's not unfair to everyone else
+void request_handoff(struct process *running, struct process *woken);
+
+// Gives up the rest of the running process's turn
+void yield_process(struct process *running);
+
+// Generates /proc/sched_latency, see sched_latency_stats
+uint32_t read_sched_latency(char *buf, uint32_t max_size);
+
+} // namespace proc
+
+#endif
@@ -31,7 +31,8 @@ uint32_t lseek(uint32_t file_descriptor, uint32_t offset, uint32_t whence,
         find_file_descriptor(file_descriptor, current_process->open_files);
   }
 
-  if (!to_seek || to_seek->file->read_write_pipe) {
+  if (!to_seek || to_seek->file->read_write_pipe ||
+      to_seek->file->timerfd) {
     return -1;
   }
 
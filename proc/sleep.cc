@@ -4,15 +4,21 @@
 #include "lib/std/stdio.h"
 #include "lib/std/time.h"
 #include "proc/process.h"
+#include "proc/wait_queue.h"
 
 namespace proc {
 
 namespace {
 
 using arch::memory::virtual_to_physical_memcpy;
+using lib::std::add_time;
+using lib::std::kfree;
 using lib::std::kmalloc;
 using lib::std::system_time;
 using lib::std::time;
+using lib::std::update_system_time;
+
+struct wait_queue sleepers = {nullptr, nullptr};
 
 } // namespace
 
@@ -26,17 +32,9 @@ uint32_t nanosleep(uint32_t req_addr, uint32_t rem_addr, uint32_t reserved1,
 
   struct sleep_wait *wait =
       (struct sleep_wait *)kmalloc(sizeof(struct sleep_wait));
-  wait->type = SLEEP_WAIT;
-  wait->end_time = system_time;
-  wait->end_time.seconds += wait_time->seconds;
-  wait->end_time.nanoseconds += wait_time->nanoseconds;
-  if (wait->end_time.nanoseconds > 1000000000) {
-    wait->end_time.seconds++;
-    wait->end_time.nanoseconds = wait->end_time.nanoseconds % 1000000000;
-  }
-
-  current_process->process_state = WAITING;
-  current_process->wait = wait;
+  init_wait_reason(wait, SLEEP_WAIT, current_process);
+  update_system_time();
+  wait_on_timeout(&sleepers, wait, add_time(system_time, *wait_time));
 
   kfree(wait_time);
 
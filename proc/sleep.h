@@ -1,22 +1,14 @@
 #ifndef PROC_SLEEP_H
 #define PROC_SLEEP_H
 
-#include "lib/std/time.h"
 #include "proc/process.h"
 
 namespace proc {
 
-namespace {
-
-using lib::std::time;
-
-} // namespace
-
 constexpr uint32_t SLEEP_WAIT = 0x2;
 
-struct sleep_wait : wait_reason {
-  struct time end_time;
-};
+// Sleepers only wake through their wait's timeout
+struct sleep_wait : wait_reason {};
 
 uint32_t nanosleep(uint32_t req_addr, uint32_t rem_addr, uint32_t reserved1,
                    uint32_t reserved2, uint32_t reserved3, uint32_t reserved4);
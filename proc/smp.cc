@@ -0,0 +1,62 @@
+#include "proc/smp.h"
+#include "arch/i386/cpu/save_restore.h"
+#include "arch/i386/cpu/smp.h"
+#include "arch/i386/interrupts/apic.h"
+#include "arch/i386/interrupts/idt.h"
+#include "arch/interrupts/interrupts.h"
+#include "proc/process.h"
+#include "proc/syscall.h"
+
+namespace proc {
+
+namespace {
+
+using arch::cpu::get_cpu_id;
+using arch::cpu::get_num_cpus;
+using arch::interrupts::apic_end_interrupt;
+using arch::interrupts::broadcast_ipi;
+using arch::interrupts::INTERRUPT_GATE;
+using arch::interrupts::register_interrupt_handler;
+
+constexpr uint8_t RESCHEDULE_INTERRUPT = 0xF0;
+
+extern "C" void reschedule_handler(char is_userspace) {
+  apic_end_interrupt();
+
+  // An idle CPU goes back around its scheduler loop when we return
+  if (is_userspace) {
+    advance_process_queue();
+    execute_processes();
+  }
+}
+
+extern "C" void reschedule_interrupt(void);
+
+SAVE_PROCESSOR_STATE(reschedule_interrupt, reschedule_handler)
+
+void start_secondary(void) {
+  enable_fast_syscalls();
+  execute_processes();
+}
+
+} // namespace
+
+void init_smp(void) {
+  register_interrupt_handler(RESCHEDULE_INTERRUPT, INTERRUPT_GATE, 0,
+                             (void *)reschedule_interrupt);
+  arch::cpu::start_secondary_cpus(start_secondary);
+}
+
+void kick_cpu(uint32_t cpu_id) {
+  if (cpu_id != get_cpu_id()) {
+    arch::cpu::send_cpu_interrupt(cpu_id, RESCHEDULE_INTERRUPT);
+  }
+}
+
+void tick_other_cpus(void) {
+  if (get_num_cpus() > 1) {
+    broadcast_ipi(RESCHEDULE_INTERRUPT);
+  }
+}
+
+} // namespace proc
@@ -0,0 +1,24 @@
+#ifndef PROC_SMP_H
+#define PROC_SMP_H
+
+#include <stdint.h>
+
+namespace proc {
+
+// Every CPU runs its own copy of the scheduler loop over its own run queue.
+// Only the bootstrap CPU gets timer interrupts, so it passes each tick on to
+// the others, and a CPU that queues work for another interrupts it so it
+// notices.
+
+// Brings up the other CPUs and starts their schedulers
+void init_smp(void);
+
+// Makes another CPU look at its run queue. Does nothing for this CPU.
+void kick_cpu(uint32_t cpu_id);
+
+// Passes a timer tick on to every other CPU
+void tick_other_cpus(void);
+
+} // namespace proc
+
+#endif
@@ -0,0 +1,627 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arch/i386/cpu/fpu.h"
+#include "arch/i386/cpu/sse.h"
+#include "arch/i386/memory/gdt.h"
+#include "arch/i386/memory/paging.h"
+#include "filesystem/fat32.h"
+#include "filesystem/file.h"
+#include "lib/std/memory.h"
+#include "lib/std/stdio.h"
+#include "lib/std/string.h"
+#include "proc/close.h"
+#include "proc/elf_loader.h"
+#include "proc/process.h"
+#include "proc/snapshot.h"
+#include "proc/vdso.h"
+
+namespace proc {
+
+namespace {
+
+using arch::cpu::get_legacy_fpu_state;
+using arch::cpu::init_fpu_state;
+using arch::cpu::is_sse_enabled;
+using arch::cpu::LEGACY_FPU_STATE_SIZE;
+using arch::cpu::set_legacy_fpu_state;
+using arch::memory::GDT_TABLE_SIZE;
+using arch::memory::make_virtual_string_copy;
+using arch::memory::map_memory_segment;
+using arch::memory::PAGE_SIZE;
+using arch::memory::TLS_ENTRY_OFFSET;
+using arch::memory::tls_segment;
+using arch::memory::USER_CODE_SELECTOR;
+using arch::memory::USER_DATA_SELECTOR;
+using arch::memory::user_read_write;
+using arch::memory::virtual_to_physical_memcpy;
+using filesystem::directory_entry;
+using filesystem::file;
+using filesystem::file_descriptor;
+using filesystem::file_mapping;
+using filesystem::load_file;
+using filesystem::read_fat32;
+using filesystem::stat_fat32;
+using filesystem::write_new_fat32;
+using lib::std::END_OF_KERNEL;
+using lib::std::kfree;
+using lib::std::kmalloc;
+using lib::std::kmalloc_aligned;
+using lib::std::make_string_copy;
+using lib::std::memcpy;
+using lib::std::memset;
+using lib::std::strcat;
+using lib::std::strlen;
+
+constexpr uint32_t SNAPSHOT_MAGIC = 0x504E534D; // "MSNP"
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+constexpr int SAVED_FRAME_WORDS = 13; // Pushal plus an iret frame from ring 3
+constexpr int FRAME_CS = 9;
+constexpr int FRAME_EFLAGS = 10;
+constexpr int FRAME_SS = 12;
+
+// The flags userspace can set for itself. Anything else, like the IO
+// privilege level, would be a way into the kernel.
+constexpr uint32_t USER_EFLAGS = 0xDD5;
+constexpr uint32_t INTERRUPT_FLAG = 0x200;
+
+constexpr uint32_t EINVAL = 22;
+
+// A snapshot is laid out as this header, the TLS segments, the region table,
+// the file table and then strings. Region contents follow, page aligned, so
+// they can be mapped straight out of the snapshot.
+struct __attribute__((packed)) snapshot_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t metadata_size; // Everything before the region contents
+  uint32_t frame[SAVED_FRAME_WORDS];
+  uint32_t has_fpu_state;
+  uint8_t fpu_state[LEGACY_FPU_STATE_SIZE];
+  uint32_t brk;
+  uint32_t actual_brk;
+  uint32_t lower_brk;
+  uint32_t num_tls_segments;
+  uint32_t tls_segment_index;
+  uint32_t tls_offset;
+  uint32_t num_regions;
+  uint32_t regions_offset;
+  uint32_t num_files;
+  uint32_t files_offset;
+  uint32_t next_file_descriptor;
+  uint32_t path_offset;
+  uint32_t working_dir_offset;
+};
+
+struct __attribute__((packed)) snapshot_region {
+  uint32_t virtual_address;
+  uint32_t len; // Page aligned
+  uint32_t file_len;
+  uint32_t offset;      // Offset of the contents in the backing file
+  uint32_t path_offset; // Shared mappings are backed by their own file, 0 if
+                        // the contents are in the snapshot
+};
+
+struct __attribute__((packed)) snapshot_file {
+  uint32_t num;
+  uint32_t offset;
+  uint32_t path_offset;
+};
+
+uint32_t page_align(uint32_t len) {
+  return (len & (PAGE_SIZE - 1)) ? (len & (~(PAGE_SIZE - 1))) + PAGE_SIZE
+                                 : len;
+}
+
+uint32_t add_string(char *image, uint32_t *next_string, char *string) {
+  uint32_t ret = *next_string;
+  size_t len = strlen(string) + 1;
+  memcpy(string, image + ret, len);
+  *next_string += len;
+  return ret;
+}
+
+// Only regular files can be reopened from a snapshot
+char is_snapshot_file(struct file_descriptor *descriptor) {
+  return !descriptor->file->read_write_pipe && descriptor->file->path &&
+         descriptor->file->inode;
+}
+
+// Restored regions are paged in from their backing file for as long as
+// they're mapped. The open file pins its clusters, so overwriting the
+// snapshot, or the file behind a shared region, leaves them intact.
+struct file *open_backing_file(char *path) {
+  struct file *backing_file = (struct file *)kmalloc(sizeof(struct file));
+  backing_file->path = make_string_copy(path);
+  load_file(backing_file);
+  if (!backing_file->inode) {
+    close_file(backing_file);
+    return nullptr;
+  }
+
+  return backing_file;
+}
+
+void release_file(struct file *to_release) {
+  to_release->num_references--;
+  if (!to_release->num_references) {
+    close_file(to_release);
+  }
+}
+
+// Snapshots are just files, so nothing in one can be trusted. These check the
+// metadata only refers to itself before anything is read out of it.
+char fits_in_metadata(uint32_t metadata_size, uint32_t offset, uint32_t count,
+                      uint32_t entry_size) {
+  return offset <= metadata_size &&
+         count <= (metadata_size - offset) / entry_size;
+}
+
+char is_metadata_string(char *metadata, uint32_t metadata_size,
+                        uint32_t offset) {
+  for (uint32_t i = offset; i < metadata_size; i++) {
+    if (!metadata[i]) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+char is_valid_metadata(struct snapshot_header &header, char *metadata) {
+  uint32_t size = header.metadata_size;
+  if (!fits_in_metadata(size, header.tls_offset, header.num_tls_segments,
+                        sizeof(struct tls_segment)) ||
+      !fits_in_metadata(size, header.regions_offset, header.num_regions,
+                        sizeof(struct snapshot_region)) ||
+      !fits_in_metadata(size, header.files_offset, header.num_files,
+                        sizeof(struct snapshot_file)) ||
+      !is_metadata_string(metadata, size, header.path_offset) ||
+      !is_metadata_string(metadata, size, header.working_dir_offset)) {
+    return 0;
+  }
+
+  // TLS segments go straight into the GDT, so they may only use its TLS
+  // slots, in the order set_thread_area hands them out
+  if (!header.num_tls_segments ||
+      header.num_tls_segments > GDT_TABLE_SIZE - TLS_ENTRY_OFFSET ||
+      header.tls_segment_index >= header.num_tls_segments) {
+    return 0;
+  }
+  struct tls_segment *tls_segments =
+      (struct tls_segment *)(metadata + header.tls_offset);
+  for (uint32_t i = 0; i < header.num_tls_segments; i++) {
+    if (tls_segments[i].gdt_index != TLS_ENTRY_OFFSET + i) {
+      return 0;
+    }
+  }
+
+  // Regions have to be whole pages of user memory that don't overlap
+  struct snapshot_region *regions =
+      (struct snapshot_region *)(metadata + header.regions_offset);
+  for (uint32_t i = 0; i < header.num_regions; i++) {
+    uint32_t start = regions[i].virtual_address;
+    uint32_t len = regions[i].len;
+    if (start < END_OF_KERNEL || (start & (PAGE_SIZE - 1)) || !len ||
+        (len & (PAGE_SIZE - 1)) || start + len <= start) {
+      return 0;
+    }
+    if (regions[i].path_offset &&
+        !is_metadata_string(metadata, size, regions[i].path_offset)) {
+      return 0;
+    }
+    for (uint32_t j = 0; j < i; j++) {
+      if (start < regions[j].virtual_address + regions[j].len &&
+          regions[j].virtual_address < start + len) {
+        return 0;
+      }
+    }
+  }
+
+  struct snapshot_file *files =
+      (struct snapshot_file *)(metadata + header.files_offset);
+  for (uint32_t i = 0; i < header.num_files; i++) {
+    if (!is_metadata_string(metadata, size, files[i].path_offset)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+char *make_absolute_path(struct process *current_process, uint32_t path_addr) {
+  char *path =
+      make_virtual_string_copy(current_process->page_dir, (char *)path_addr);
+  if (path[0] != '/') {
+    char *tmp = path;
+    path = strcat(current_process->working_dir, path);
+    kfree(tmp);
+  }
+  return path;
+}
+
+} // namespace
+
+uint32_t snapshot(uint32_t path_addr, uint32_t reserved1, uint32_t reserved2,
+                  uint32_t reserved3, uint32_t reserved4, uint32_t reserved5) {
+  struct process *current_process = get_currently_executing_process();
+  uint32_t *page_dir = current_process->page_dir;
+  char *path = make_absolute_path(current_process, path_addr);
+
+  // Size everything up first so the image can be built in one buffer
+  uint32_t num_regions = 0;
+  uint32_t data_size = 0;
+  uint32_t strings_size =
+      strlen(current_process->path) + strlen(current_process->working_dir) + 2;
+  for (int i = 0; i < current_process->num_segments; i++) {
+    if (current_process->segments[i].virtual_address) {
+      num_regions++;
+      data_size += current_process->segments[i].alloc_size;
+    }
+  }
+  for (struct file_mapping *mapping = current_process->mappings; mapping;
+       mapping = mapping->next) {
+    num_regions++;
+    if (mapping->is_private) {
+      data_size += page_align(mapping->mapping_len);
+    } else {
+      strings_size += strlen(mapping->file->path) + 1;
+    }
+  }
+  uint32_t num_files = 0;
+  for (struct file_descriptor *descriptor = current_process->open_files;
+       descriptor; descriptor = descriptor->next) {
+    if (is_snapshot_file(descriptor)) {
+      num_files++;
+      strings_size += strlen(descriptor->file->path) + 1;
+    }
+  }
+
+  uint32_t tls_offset = sizeof(struct snapshot_header);
+  uint32_t regions_offset =
+      tls_offset +
+      current_process->num_tls_segments * sizeof(struct tls_segment);
+  uint32_t files_offset =
+      regions_offset + num_regions * sizeof(struct snapshot_region);
+  uint32_t strings_offset =
+      files_offset + num_files * sizeof(struct snapshot_file);
+  uint32_t metadata_size = page_align(strings_offset + strings_size);
+  uint32_t image_size = metadata_size + data_size;
+
+  char *image = (char *)kmalloc(image_size);
+  memset(image, metadata_size, 0);
+  struct snapshot_header *header = (struct snapshot_header *)image;
+  uint32_t next_string = strings_offset;
+
+  header->magic = SNAPSHOT_MAGIC;
+  header->version = SNAPSHOT_VERSION;
+  header->metadata_size = metadata_size;
+
+  // The registers are exactly what this syscall will return to, except the
+  // resumed process sees a return value of 1
+  uint32_t *frame = (uint32_t *)current_process->esp;
+  if (is_sse_enabled) {
+    header->has_fpu_state = 1;
+    get_legacy_fpu_state(current_process, (char *)header->fpu_state);
+  }
+  memcpy((char *)frame, (char *)header->frame,
+         SAVED_FRAME_WORDS * sizeof(uint32_t));
+  header->frame[7] = 1;
+
+  header->brk = current_process->brk;
+  header->actual_brk = current_process->actual_brk;
+  header->lower_brk = current_process->lower_brk;
+
+  header->num_tls_segments = current_process->num_tls_segments;
+  header->tls_segment_index = current_process->tls_segment_index;
+  header->tls_offset = tls_offset;
+  memcpy((char *)current_process->tls_segments, image + tls_offset,
+         current_process->num_tls_segments * sizeof(struct tls_segment));
+
+  // Copy out every region of user memory
+  header->num_regions = num_regions;
+  header->regions_offset = regions_offset;
+  struct snapshot_region *region =
+      (struct snapshot_region *)(image + regions_offset);
+  uint32_t data_offset = metadata_size;
+  for (int i = 0; i < current_process->num_segments; i++) {
+    struct process_memory_segment *segment = current_process->segments + i;
+    if (!segment->virtual_address) {
+      continue; // Kernel stack
+    }
+
+    region->virtual_address =
+        (uint32_t)segment->virtual_address & (~(PAGE_SIZE - 1));
+    region->len = segment->alloc_size;
+    region->file_len = segment->alloc_size;
+    region->offset = data_offset;
+    region->path_offset = 0;
+    memcpy((char *)segment->actual_address, image + data_offset,
+           segment->alloc_size);
+    data_offset += segment->alloc_size;
+    region++;
+  }
+  for (struct file_mapping *mapping = current_process->mappings; mapping;
+       mapping = mapping->next) {
+    region->virtual_address = (uint32_t)mapping->mapping;
+    region->len = page_align(mapping->mapping_len);
+    if (mapping->is_private) {
+      // Untouched pages get faulted in from the original file here, which
+      // keeps the snapshot self contained
+      region->file_len = region->len;
+      region->offset = data_offset;
+      region->path_offset = 0;
+      for (uint32_t offset = 0; offset < region->len; offset += PAGE_SIZE) {
+        virtual_to_physical_memcpy(page_dir,
+                                   (char *)mapping->mapping + offset,
+                                   image + data_offset + offset, PAGE_SIZE);
+      }
+      data_offset += region->len;
+    } else {
+      region->file_len = mapping->file_len;
+      region->offset = mapping->offset;
+      region->path_offset =
+          add_string(image, &next_string, mapping->file->path);
+    }
+    region++;
+  }
+
+  header->num_files = num_files;
+  header->files_offset = files_offset;
+  header->next_file_descriptor = current_process->next_file_descriptor;
+  struct snapshot_file *saved_file =
+      (struct snapshot_file *)(image + files_offset);
+  for (struct file_descriptor *descriptor = current_process->open_files;
+       descriptor; descriptor = descriptor->next) {
+    if (is_snapshot_file(descriptor)) {
+      saved_file->num = descriptor->num;
+      saved_file->offset = descriptor->file->offset;
+      saved_file->path_offset =
+          add_string(image, &next_string, descriptor->file->path);
+      saved_file++;
+    }
+  }
+
+  header->path_offset = add_string(image, &next_string, current_process->path);
+  header->working_dir_offset =
+      add_string(image, &next_string, current_process->working_dir);
+
+  struct directory_entry old_file = stat_fat32(path);
+  if (old_file.name) {
+    invalidate_exec_image(old_file.inode);
+    kfree(old_file.name);
+  }
+
+  uint32_t inode = write_new_fat32(path, 0, (uint8_t *)image, image_size);
+
+  kfree(image);
+  kfree(path);
+
+  return inode ? 0 : -1;
+}
+
+uint32_t restore_snapshot(uint32_t path_addr, uint32_t reserved1,
+                          uint32_t reserved2, uint32_t reserved3,
+                          uint32_t reserved4, uint32_t reserved5) {
+  struct process *current_process = get_currently_executing_process();
+  char *path = make_absolute_path(current_process, path_addr);
+
+  struct file *snapshot_file = open_backing_file(path);
+  kfree(path);
+  if (!snapshot_file) {
+    return -1;
+  }
+
+  struct snapshot_header header;
+  if (read_fat32(snapshot_file->inode, 0, (uint8_t *)&header,
+                 sizeof(struct snapshot_header)) !=
+          sizeof(struct snapshot_header) ||
+      header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION ||
+      header.has_fpu_state != is_sse_enabled) {
+    release_file(snapshot_file);
+    return -1;
+  }
+
+  if (header.metadata_size < sizeof(struct snapshot_header) ||
+      header.metadata_size > snapshot_file->size) {
+    release_file(snapshot_file);
+    return -EINVAL;
+  }
+
+  char *metadata = (char *)kmalloc(header.metadata_size);
+  if (read_fat32(snapshot_file->inode, 0, (uint8_t *)metadata,
+                 header.metadata_size) != header.metadata_size) {
+    kfree(metadata);
+    release_file(snapshot_file);
+    return -1;
+  }
+  if (!is_valid_metadata(header, metadata)) {
+    kfree(metadata);
+    release_file(snapshot_file);
+    return -EINVAL;
+  }
+
+  // Open everything backing the regions up front, so a missing file fails the
+  // restore before we've built anything
+  struct snapshot_region *regions =
+      (struct snapshot_region *)(metadata + header.regions_offset);
+  struct file **backing_files =
+      (struct file **)kmalloc(header.num_regions * sizeof(struct file *));
+  for (int i = 0; i < header.num_regions; i++) {
+    if (regions[i].path_offset) {
+      backing_files[i] = open_backing_file(metadata + regions[i].path_offset);
+      if (!backing_files[i]) {
+        for (int j = 0; j < i; j++) {
+          release_file(backing_files[j]);
+        }
+        kfree(backing_files);
+        kfree(metadata);
+        release_file(snapshot_file);
+        return -1;
+      }
+    } else {
+      backing_files[i] = snapshot_file;
+      snapshot_file->num_references++;
+    }
+  }
+
+  // Pages are only read in as they're touched, so make sure now that the
+  // snapshot actually holds the memory it says it does. Shared regions are
+  // mapped like mmap maps them, which may run past the end of the file.
+  for (int i = 0; i < header.num_regions; i++) {
+    uint32_t snapshot_size = snapshot_file->size;
+    if (regions[i].file_len > regions[i].len ||
+        (!regions[i].path_offset &&
+         (regions[i].offset > snapshot_size ||
+          regions[i].file_len > snapshot_size - regions[i].offset))) {
+      for (int j = 0; j < header.num_regions; j++) {
+        release_file(backing_files[j]);
+      }
+      kfree(backing_files);
+      kfree(metadata);
+      release_file(snapshot_file);
+      return -EINVAL;
+    }
+  }
+
+  struct process *new_proc = (struct process *)kmalloc(sizeof(struct process));
+
+  new_proc->path = make_string_copy(metadata + header.path_offset);
+  new_proc->working_dir = make_string_copy(metadata + header.working_dir_offset);
+
+  new_proc->page_dir =
+      (uint32_t *)kmalloc_aligned(1024 * sizeof(uint32_t), PAGE_SIZE);
+  memcpy((char *)base_page_directory, (char *)new_proc->page_dir,
+         2 * sizeof(uint32_t));
+  memset((char *)(new_proc->page_dir + 2), 1022 * sizeof(uint32_t), 0);
+  new_proc->page_tables = nullptr;
+  new_proc->num_page_tables = 0;
+
+  new_proc->entry = nullptr;
+
+  // The only segment we need is a kernel stack. Everything else is a mapping.
+  new_proc->num_segments = 1;
+  new_proc->segments = (struct process_memory_segment *)kmalloc(
+      sizeof(struct process_memory_segment));
+  struct process_memory_segment *kernel_stack_segment = new_proc->segments;
+  kernel_stack_segment->virtual_address = nullptr;
+  kernel_stack_segment->segment_size = DEFAULT_STACK_SIZE;
+  kernel_stack_segment->alloc_size = DEFAULT_STACK_SIZE;
+  kernel_stack_segment->disk_size = 0;
+  kernel_stack_segment->source = nullptr;
+  kernel_stack_segment->flags = READABLE_MEMORY | WRITEABLE_MEMORY;
+  kernel_stack_segment->actual_address =
+      kmalloc_aligned(DEFAULT_STACK_SIZE, PAGE_SIZE);
+  map_memory_segment(new_proc, (uint32_t)kernel_stack_segment->actual_address,
+                     (uint32_t)kernel_stack_segment->actual_address,
+                     DEFAULT_STACK_SIZE, user_read_write);
+  new_proc->kernel_stack_top = ((uint32_t)kernel_stack_segment->actual_address +
+                                DEFAULT_STACK_SIZE) &
+                               0xFFFFFFFC;
+
+  // Memory only comes back as it's touched
+  new_proc->mappings = nullptr;
+  for (int i = header.num_regions - 1; i >= 0; i--) {
+    struct file_mapping *new_mapping =
+        (struct file_mapping *)kmalloc(sizeof(struct file_mapping));
+    new_mapping->mapping = (void *)regions[i].virtual_address;
+    new_mapping->mapping_len = regions[i].len;
+    new_mapping->file_len = regions[i].file_len;
+    new_mapping->offset = regions[i].offset;
+    new_mapping->file = backing_files[i];
+    new_mapping->is_private = !regions[i].path_offset;
+    new_mapping->prev = nullptr;
+    new_mapping->next = new_proc->mappings;
+    if (new_proc->mappings) {
+      new_proc->mappings->prev = new_mapping;
+    }
+    new_proc->mappings = new_mapping;
+
+    map_memory_segment(new_proc, 0, regions[i].virtual_address,
+                       regions[i].len, user_read_write);
+  }
+  kfree(backing_files);
+  release_file(snapshot_file);
+
+  new_proc->num_tls_segments = header.num_tls_segments;
+  new_proc->tls_segments = (struct tls_segment *)kmalloc(
+      header.num_tls_segments * sizeof(struct tls_segment));
+  memcpy(metadata + header.tls_offset, (char *)new_proc->tls_segments,
+         header.num_tls_segments * sizeof(struct tls_segment));
+  new_proc->tls_segment_index = header.tls_segment_index;
+
+  new_proc->brk = header.brk;
+  new_proc->actual_brk = header.actual_brk;
+  new_proc->lower_brk = header.lower_brk;
+
+  new_proc->argc = 0;
+  new_proc->argv = (char **)kmalloc(sizeof(char *));
+  new_proc->argv[0] = nullptr;
+  new_proc->envp = nullptr;
+
+  // Standard streams come from whoever restored us, like execve
+  new_proc->standard_in = current_process->standard_in;
+  new_proc->standard_out = current_process->standard_out;
+  new_proc->standard_error = current_process->standard_error;
+  current_process->standard_in = nullptr;
+  current_process->standard_out = nullptr;
+  current_process->standard_error = nullptr;
+
+  new_proc->open_files = nullptr;
+  new_proc->next_file_descriptor = header.next_file_descriptor;
+  struct snapshot_file *saved_files =
+      (struct snapshot_file *)(metadata + header.files_offset);
+  for (int i = 0; i < header.num_files; i++) {
+    struct file *reopened =
+        open_backing_file(metadata + saved_files[i].path_offset);
+    if (!reopened) {
+      continue;
+    }
+    reopened->offset = saved_files[i].offset;
+
+    struct file_descriptor *new_fd =
+        (struct file_descriptor *)kmalloc(sizeof(struct file_descriptor));
+    new_fd->num = saved_files[i].num;
+    new_fd->file = reopened;
+    new_fd->prev = nullptr;
+    new_fd->next = new_proc->open_files;
+    if (new_proc->open_files) {
+      new_proc->open_files->prev = new_fd;
+    }
+    new_proc->open_files = new_fd;
+  }
+
+  // Rebuild the kernel stack the way SAVE_PROCESSOR_STATE would have left it
+  uint32_t *frame = (uint32_t *)(new_proc->kernel_stack_top -
+                                 SAVED_FRAME_WORDS * sizeof(uint32_t));
+  memcpy((char *)header.frame, (char *)frame,
+         SAVED_FRAME_WORDS * sizeof(uint32_t));
+  // Always back to ring 3 with interrupts on, whatever the file says
+  frame[FRAME_CS] = USER_CODE_SELECTOR;
+  frame[FRAME_SS] = USER_DATA_SELECTOR;
+  frame[FRAME_EFLAGS] = (frame[FRAME_EFLAGS] & USER_EFLAGS) | INTERRUPT_FLAG;
+  new_proc->esp = (uint32_t)frame;
+  init_fpu_state(new_proc);
+  if (is_sse_enabled) {
+    set_legacy_fpu_state(new_proc, (char *)header.fpu_state);
+  }
+
+  kfree(metadata);
+
+  new_proc->process_state = RUNNABLE;
+  new_proc->wait = nullptr;
+  inherit_process_identity(current_process, new_proc);
+  new_proc->vfork_parent = nullptr;
+  new_proc->vfork_kernel_stack = nullptr;
+  new_proc->is_kernel_thread = 0;
+  new_proc->in_syscall = 0;
+  new_proc->syscall_esp = 0;
+  map_vdso(new_proc);
+
+  add_process(new_proc);
+
+  current_process->process_state = STOPPED;
+
+  return 0;
+}
+
+} // namespace proc
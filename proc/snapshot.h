@@ -0,0 +1,21 @@
+#ifndef PROC_SNAPSHOT_H
+#define PROC_SNAPSHOT_H
+
+#include <stdint.h>
+
+namespace proc {
+
+// Writes the calling process's memory, registers, TLS segments and open files
+// to a file. Returns 0 to the caller and 1 when resumed from the snapshot.
+uint32_t snapshot(uint32_t path_addr, uint32_t reserved1, uint32_t reserved2,
+                  uint32_t reserved3, uint32_t reserved4, uint32_t reserved5);
+
+// Replaces the calling process with one resumed from a snapshot, much like
+// execve. Memory is faulted in from the snapshot file as it's touched.
+uint32_t restore_snapshot(uint32_t path_addr, uint32_t reserved1,
+                          uint32_t reserved2, uint32_t reserved3,
+                          uint32_t reserved4, uint32_t reserved5);
+
+} // namespace proc
+
+#endif
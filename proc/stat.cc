@@ -74,6 +74,16 @@ uint32_t fstat64(uint32_t fd, uint32_t stat_addr, uint32_t reserved1,
 
     if (current_fd->file->read_write_pipe) {
       dest_stat->mode = ((uint32_t)FIFO << 12) | ALL_RWX;
+    } else if (current_fd->file->timerfd) {
+      // Like Linux's anonymous inodes, it doesn't have a file type
+      dest_stat->mode = ALL_RWX;
+    } else if (!current_fd->file->inode && current_fd->file->buffer) {
+      // Pseudo files only exist in memory
+      dest_stat->size = current_fd->file->size;
+      dest_stat->block_size = 512;
+      dest_stat->num_blocks =
+          divide(dest_stat->size, dest_stat->block_size) + 1;
+      dest_stat->mode = ((uint32_t)REGULAR_FILE << 12) | ALL_RWX;
     } else if (!stat_internal(page_dir, current_fd->file->path, dest_stat)) {
       kfree(dest_stat);
       return -1;
@@ -0,0 +1,20 @@
+#include <stdint.h>
+
+#include "filesystem/fat32.h"
+#include "proc/sync.h"
+
+namespace proc {
+
+namespace {
+
+using filesystem::sync_fat32;
+
+} // namespace
+
+uint32_t sync(uint32_t reserved1, uint32_t reserved2, uint32_t reserved3,
+              uint32_t reserved4, uint32_t reserved5, uint32_t reserved6) {
+  sync_fat32();
+  return 0;
+}
+
+} // namespace proc
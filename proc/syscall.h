@@ -5,8 +5,17 @@
 
 namespace proc {
 
+// Sets up int 0x80, and SYSENTER too on this CPU if it has it
 void initialize_syscalls(uint32_t max_syscall_number);
 
+// Points this CPU's SYSENTER at the kernel, if the CPUs have it. The other
+// CPUs call this as they come up.
+void enable_fast_syscalls(void);
+
+// Returns where processes should make syscalls from, for AT_SYSINFO, or 0 if
+// they should stick to int 0x80
+uint32_t get_syscall_entry(void);
+
 void register_syscall(uint32_t number,
                       uint32_t (*syscall)(uint32_t, uint32_t, uint32_t,
                                           uint32_t, uint32_t, uint32_t));
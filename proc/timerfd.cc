@@ -0,0 +1,150 @@
+#include <stdint.h>
+
+#include "arch/i386/memory/paging.h"
+#include "filesystem/file.h"
+#include "filesystem/timerfd.h"
+#include "lib/std/memory.h"
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/open.h"
+#include "proc/process.h"
+#include "proc/timerfd.h"
+
+namespace proc {
+
+namespace {
+
+using arch::memory::physical_to_virtual_memcpy;
+using arch::memory::virtual_to_physical_memcpy;
+using filesystem::arm_timerfd;
+using filesystem::create_timerfd;
+using filesystem::file;
+using filesystem::file_descriptor;
+using filesystem::find_file_descriptor;
+using filesystem::timerfd;
+using filesystem::timerfd_remaining;
+using lib::std::add_time;
+using lib::std::boot_time;
+using lib::std::kmalloc;
+using lib::std::subtract_time;
+using lib::std::system_time;
+using lib::std::time;
+using lib::std::update_system_time;
+
+constexpr uint32_t CLOCK_REALTIME = 0;
+constexpr uint32_t CLOCK_MONOTONIC = 1;
+constexpr uint32_t CLOCK_BOOTTIME = 7;
+
+constexpr uint32_t TFD_NONBLOCK = 0x800;
+constexpr uint32_t TFD_TIMER_ABSTIME = 0x1;
+
+struct itimerspec {
+  struct time interval;
+  struct time value;
+};
+
+struct timerfd *find_timerfd(struct process *current_process, uint32_t fd) {
+  struct file_descriptor *descriptor =
+      find_file_descriptor(fd, current_process->open_files);
+  if (!descriptor) {
+    return nullptr;
+  }
+  return descriptor->file->timerfd;
+}
+
+char is_valid(const struct time &to_check) {
+  return to_check.nanoseconds < 1000000000;
+}
+
+} // namespace
+
+uint32_t timerfd_create(uint32_t clock_id, uint32_t flags, uint32_t reserved1,
+                        uint32_t reserved2, uint32_t reserved3,
+                        uint32_t reserved4) {
+  if (clock_id != CLOCK_REALTIME && clock_id != CLOCK_MONOTONIC &&
+      clock_id != CLOCK_BOOTTIME) {
+    return -1;
+  }
+
+  struct file *new_file = (struct file *)kmalloc(sizeof(struct file));
+  new_file->path = nullptr;
+  new_file->buffer = nullptr;
+  new_file->read_write_pipe = nullptr;
+  new_file->timerfd = create_timerfd(clock_id, (flags & TFD_NONBLOCK) != 0);
+  new_file->inode = 0;
+  new_file->size = 0;
+  new_file->offset = 0;
+  new_file->num_references = 1;
+
+  return add_file_descriptor(get_currently_executing_process(), new_file);
+}
+
+uint32_t timerfd_settime(uint32_t fd, uint32_t flags, uint32_t new_value_addr,
+                         uint32_t old_value_addr, uint32_t reserved1,
+                         uint32_t reserved2) {
+  struct process *current_process = get_currently_executing_process();
+  uint32_t *page_dir = current_process->page_dir;
+
+  struct timerfd *to_set = find_timerfd(current_process, fd);
+  if (!to_set) {
+    return -1;
+  }
+
+  struct itimerspec new_value;
+  virtual_to_physical_memcpy(page_dir, (char *)new_value_addr,
+                             (char *)&new_value, sizeof(struct itimerspec));
+  if (!is_valid(new_value.value) || !is_valid(new_value.interval)) {
+    return -1;
+  }
+
+  if (old_value_addr) {
+    struct itimerspec old_value;
+    old_value.interval = to_set->interval;
+    old_value.value = timerfd_remaining(to_set);
+    physical_to_virtual_memcpy(page_dir, (char *)&old_value,
+                               (char *)old_value_addr,
+                               sizeof(struct itimerspec));
+  }
+
+  struct time expires = {0, 0};
+  if (new_value.value.seconds || new_value.value.nanoseconds) {
+    update_system_time();
+    if (!(flags & TFD_TIMER_ABSTIME)) {
+      expires = add_time(system_time, new_value.value);
+    } else if (to_set->clock_id == CLOCK_REALTIME) {
+      expires = subtract_time(new_value.value, boot_time);
+    } else {
+      expires = new_value.value;
+    }
+
+    // A deadline that's already passed goes off straight away, but zero
+    // would disarm it
+    if (!expires.seconds && !expires.nanoseconds) {
+      expires.nanoseconds = 1;
+    }
+  }
+  arm_timerfd(to_set, expires, new_value.interval);
+
+  return 0;
+}
+
+uint32_t timerfd_gettime(uint32_t fd, uint32_t value_addr, uint32_t reserved1,
+                         uint32_t reserved2, uint32_t reserved3,
+                         uint32_t reserved4) {
+  struct process *current_process = get_currently_executing_process();
+
+  struct timerfd *to_get = find_timerfd(current_process, fd);
+  if (!to_get) {
+    return -1;
+  }
+
+  struct itimerspec value;
+  value.interval = to_get->interval;
+  value.value = timerfd_remaining(to_get);
+  physical_to_virtual_memcpy(current_process->page_dir, (char *)&value,
+                             (char *)value_addr, sizeof(struct itimerspec));
+
+  return 0;
+}
+
+} // namespace proc
@@ -0,0 +1,24 @@
+#ifndef PROC_TIMERFD_H
+#define PROC_TIMERFD_H
+
+#include <stdint.h>
+
+namespace proc {
+
+// Timers are kept in system_time, so every clock runs at the same rate. An
+// absolute CLOCK_REALTIME deadline is converted once when it's set.
+uint32_t timerfd_create(uint32_t clock_id, uint32_t flags, uint32_t reserved1,
+                        uint32_t reserved2, uint32_t reserved3,
+                        uint32_t reserved4);
+
+uint32_t timerfd_settime(uint32_t fd, uint32_t flags, uint32_t new_value_addr,
+                         uint32_t old_value_addr, uint32_t reserved1,
+                         uint32_t reserved2);
+
+uint32_t timerfd_gettime(uint32_t fd, uint32_t value_addr, uint32_t reserved1,
+                         uint32_t reserved2, uint32_t reserved3,
+                         uint32_t reserved4);
+
+} // namespace proc
+
+#endif
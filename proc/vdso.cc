@@ -0,0 +1,74 @@
+#include <stdint.h>
+
+#include "arch/i386/memory/paging.h"
+#include "arch/i386/vdso/vdso.h"
+#include "lib/std/memory.h"
+#include "lib/std/time.h"
+#include "proc/process.h"
+#include "proc/vdso.h"
+
+extern "C" {
+// The vDSO image, linked in by arch/i386/vdso/vdso_image.s
+extern char vdso_image_start[];
+extern char vdso_image_end[];
+}
+
+namespace proc {
+
+namespace {
+
+using arch::memory::map_memory_segment;
+using arch::memory::PAGE_SIZE;
+using arch::memory::user_read_only;
+using arch::memory::user_read_write;
+using arch::vdso::PROCESS_DATA_ADDRESS;
+using arch::vdso::process_data;
+using arch::vdso::VDSO_ADDRESS;
+using arch::vdso::VVAR_ADDRESS;
+using lib::std::clock_data;
+using lib::std::kfree;
+using lib::std::kmalloc_aligned;
+using lib::std::memset;
+
+// Where e_entry is in the image's ELF header
+constexpr uint32_t ELF_ENTRY_OFFSET = 24;
+
+} // namespace
+
+void map_vdso(struct process *proc) {
+  proc->vdso_data = kmalloc_aligned(PAGE_SIZE, PAGE_SIZE);
+  memset((char *)proc->vdso_data, PAGE_SIZE, 0);
+  set_vdso_owner(proc);
+
+  // The kernel is identity mapped, so these are physical addresses too
+  map_memory_segment(proc, (uint32_t)&clock_data, VVAR_ADDRESS, PAGE_SIZE,
+                     user_read_only);
+  map_memory_segment(proc, (uint32_t)proc->vdso_data, PROCESS_DATA_ADDRESS,
+                     PAGE_SIZE, user_read_only);
+  map_memory_segment(proc, (uint32_t)vdso_image_start, VDSO_ADDRESS,
+                     vdso_image_end - vdso_image_start, user_read_only);
+
+  // The page table's directory entry takes the permissions of whatever
+  // created it. Only the pages themselves should be read only.
+  proc->page_dir[VVAR_ADDRESS >> 22] |= user_read_write;
+}
+
+void free_vdso(struct process *proc) {
+  if (proc->vdso_data) {
+    kfree(proc->vdso_data);
+    proc->vdso_data = nullptr;
+  }
+}
+
+void set_vdso_owner(struct process *proc) {
+  ((struct process_data *)proc->vdso_data)->pid = proc->pid;
+}
+
+uint32_t get_vdso_address(void) { return VDSO_ADDRESS; }
+
+uint32_t get_vsyscall_address(void) {
+  // The image is linked at 0, so its entry point is an offset into it
+  return VDSO_ADDRESS + *(uint32_t *)(vdso_image_start + ELF_ENTRY_OFFSET);
+}
+
+} // namespace proc
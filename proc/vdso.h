@@ -0,0 +1,26 @@
+#ifndef PROC_VDSO_H
+#define PROC_VDSO_H
+
+#include "proc/process.h"
+
+namespace proc {
+
+// Maps the clock data, a page with the process's own data and the vDSO into a
+// new address space. The process's page is freed along with it.
+void map_vdso(struct process *proc);
+
+void free_vdso(struct process *proc);
+
+// A vfork child borrows its parent's page along with the address space, so
+// the page has to say which of them is using it
+void set_vdso_owner(struct process *proc);
+
+// Where the vDSO image is mapped, for AT_SYSINFO_EHDR
+uint32_t get_vdso_address(void);
+
+// Where __kernel_vsyscall is mapped
+uint32_t get_vsyscall_address(void);
+
+} // namespace proc
+
+#endif
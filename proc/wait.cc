@@ -0,0 +1,140 @@
+#include <stdint.h>
+
+#include "arch/i386/memory/paging.h"
+#include "lib/std/memory.h"
+#include "proc/process.h"
+#include "proc/rusage.h"
+#include "proc/wait.h"
+#include "proc/wait_queue.h"
+
+namespace proc {
+
+namespace {
+
+using arch::memory::physical_to_virtual_memcpy;
+using lib::std::kfree;
+using lib::std::kmalloc;
+
+constexpr uint32_t WNOHANG = 0x1;
+
+char is_match(int32_t wanted_pid, uint32_t pid) {
+  // Process groups aren't supported, so those just match any child
+  return wanted_pid <= 0 || (uint32_t)wanted_pid == pid;
+}
+
+char has_children(struct process *parent, int32_t wanted_pid) {
+  struct process *current_proc = parent;
+  do {
+    if (current_proc->parent_pid == parent->pid &&
+        is_match(wanted_pid, current_proc->pid)) {
+      return 1;
+    }
+    current_proc = current_proc->next;
+  } while (current_proc != parent);
+
+  return 0;
+}
+
+void deliver_exit(struct process *parent, uint32_t status_addr,
+                  uint32_t rusage_addr, struct exited_child *child) {
+  if (status_addr) {
+    physical_to_virtual_memcpy(parent->page_dir, (char *)&child->status,
+                               (char *)status_addr, sizeof(uint32_t));
+  }
+  if (rusage_addr) {
+    write_rusage(parent->page_dir, rusage_addr, &child->usage);
+  }
+}
+
+} // namespace
+
+void report_exit(struct process *child) {
+  if (!child->parent_pid) {
+    return;
+  }
+
+  struct process *parent = find_process_by_pid(child->parent_pid);
+  if (!parent || parent->process_state == STOPPED) {
+    return;
+  }
+
+  struct exited_child *exited =
+      (struct exited_child *)kmalloc(sizeof(struct exited_child));
+  exited->pid = child->pid;
+  // Encoded the way WIFEXITED and WIFSIGNALED expect
+  if (child->kill_signal) {
+    exited->status = child->kill_signal & 0x7F;
+  } else {
+    exited->status = (child->exit_status & 0xFF) << 8;
+  }
+  get_resource_usage(child, &exited->usage);
+  add_resource_usage(&exited->usage, &child->children_usage);
+  add_resource_usage(&parent->children_usage, &exited->usage);
+
+  struct child_wait *wait = (struct child_wait *)parent->wait;
+  if (parent->process_state == WAITING && wait &&
+      wait->type == CHILD_WAIT && is_match(wait->pid, exited->pid)) {
+    deliver_exit(parent, wait->status_addr, wait->rusage_addr, exited);
+    set_syscall_return(parent, exited->pid);
+    kfree(exited);
+    wake_waiter(wait);
+  } else {
+    exited->next = parent->exited_children;
+    parent->exited_children = exited;
+  }
+}
+
+void free_exited_children(struct process *proc) {
+  struct exited_child *exited = proc->exited_children;
+  while (exited) {
+    struct exited_child *next = exited->next;
+    kfree(exited);
+    exited = next;
+  }
+  proc->exited_children = nullptr;
+}
+
+uint32_t wait4(uint32_t pid, uint32_t status_addr, uint32_t options,
+               uint32_t rusage_addr, uint32_t reserved1, uint32_t reserved2) {
+  struct process *current_process = get_currently_executing_process();
+
+  struct exited_child **exited = &current_process->exited_children;
+  while (*exited && !is_match(pid, (*exited)->pid)) {
+    exited = &(*exited)->next;
+  }
+
+  if (*exited) {
+    struct exited_child *to_reap = *exited;
+    *exited = to_reap->next;
+    deliver_exit(current_process, status_addr, rusage_addr, to_reap);
+    uint32_t ret = to_reap->pid;
+    kfree(to_reap);
+    return ret;
+  }
+
+  if (!has_children(current_process, pid)) {
+    return -1;
+  }
+
+  if (options & WNOHANG) {
+    return 0;
+  }
+
+  // report_exit fills in the return value once a child exits
+  struct child_wait *wait =
+      (struct child_wait *)kmalloc(sizeof(struct child_wait));
+  init_wait_reason(wait, CHILD_WAIT, current_process);
+  wait->pid = pid;
+  wait->status_addr = status_addr;
+  wait->rusage_addr = rusage_addr;
+  wait_on(nullptr, wait);
+
+  return 0;
+}
+
+uint32_t waitpid(uint32_t pid, uint32_t status_addr, uint32_t options,
+                 uint32_t reserved1, uint32_t reserved2, uint32_t reserved3) {
+  return wait4(pid, status_addr, options, 0, 0, 0);
+}
+
+} // namespace proc
@@ -0,0 +1,40 @@
+#ifndef PROC_WAIT_H
+#define PROC_WAIT_H
+
+#include <stdint.h>
+
+#include "proc/process.h"
+
+namespace proc {
+
+constexpr uint32_t CHILD_WAIT = 0x6;
+
+struct child_wait : wait_reason {
+  int32_t pid; // -1 for any child
+  uint32_t status_addr;
+  uint32_t rusage_addr;
+};
+
+// An exited child its parent hasn't waited for yet
+struct exited_child {
+  uint32_t pid;
+  uint32_t status;
+  struct resource_usage usage;
+  struct exited_child *next;
+};
+
+// Tells the parent of a process that's going away about it, either by waking
+// the parent up if it's waiting or by leaving a note for later
+void report_exit(struct process *child);
+
+void free_exited_children(struct process *proc);
+
+uint32_t wait4(uint32_t pid, uint32_t status_addr, uint32_t options,
+               uint32_t rusage_addr, uint32_t reserved1, uint32_t reserved2);
+
+uint32_t waitpid(uint32_t pid, uint32_t status_addr, uint32_t options,
+                 uint32_t reserved1, uint32_t reserved2, uint32_t reserved3);
+
+} // namespace proc
+
+#endif
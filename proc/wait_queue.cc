@@ -0,0 +1,140 @@
+#include "proc/wait_queue.h"
+#include "lib/std/memory.h"
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/process.h"
+
+namespace proc {
+
+namespace {
+
+using lib::std::add_timer;
+using lib::std::cancel_timer;
+using lib::std::init_timer;
+using lib::std::kfree;
+
+void unlink_entry(struct wait_queue_entry *entry) {
+  struct wait_queue *queue = entry->queue;
+  if (!queue) {
+    return;
+  }
+
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    queue->head = entry->next;
+  }
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  } else {
+    queue->tail = entry->prev;
+  }
+
+  entry->queue = nullptr;
+  entry->next = nullptr;
+  entry->prev = nullptr;
+}
+
+// Returns the process so the caller can decide how to wake it
+struct process *end_wait(struct wait_reason *reason) {
+  struct process *waiter = reason->queue_entry.waiter;
+  if (waiter->wait == reason) {
+    waiter->wait = nullptr;
+  }
+  free_wait(reason);
+  return waiter;
+}
+
+void wait_timed_out(void *data) { wake_waiter((struct wait_reason *)data); }
+
+} // namespace
+
+void init_wait_queue(struct wait_queue *queue) {
+  queue->head = nullptr;
+  queue->tail = nullptr;
+}
+
+void init_wait_reason(struct wait_reason *reason, uint32_t type,
+                      struct process *waiter) {
+  reason->type = type;
+  reason->queue_entry.waiter = waiter;
+  reason->queue_entry.queue = nullptr;
+  reason->queue_entry.next = nullptr;
+  reason->queue_entry.prev = nullptr;
+  reason->chained = nullptr;
+  init_timer(&reason->queue_entry.timeout, wait_timed_out, reason);
+}
+
+void wait_on(struct wait_queue *queue, struct wait_reason *reason) {
+  struct wait_queue_entry *entry = &reason->queue_entry;
+  if (queue) {
+    entry->queue = queue;
+    entry->next = nullptr;
+    entry->prev = queue->tail;
+    if (queue->tail) {
+      queue->tail->next = entry;
+    } else {
+      queue->head = entry;
+    }
+    queue->tail = entry;
+  }
+
+  entry->waiter->wait = reason;
+  entry->waiter->process_state = WAITING;
+}
+
+void wait_on_timeout(struct wait_queue *queue, struct wait_reason *reason,
+                     const struct time &deadline) {
+  wait_on(queue, reason);
+  reason->queue_entry.timeout.expires = deadline;
+  add_timer(&reason->queue_entry.timeout);
+}
+
+struct wait_reason *first_waiter(struct wait_queue *queue) {
+  if (!queue->head) {
+    return nullptr;
+  }
+  return (struct wait_reason *)((char *)queue->head -
+                                offsetof(struct wait_reason, queue_entry));
+}
+
+char wake_one(struct wait_queue *queue) {
+  struct wait_reason *reason = first_waiter(queue);
+  if (!reason) {
+    return 0;
+  }
+  wake_waiter(reason);
+  return 1;
+}
+
+uint32_t wake_all(struct wait_queue *queue) {
+  uint32_t woken = 0;
+  while (wake_one(queue)) {
+    woken++;
+  }
+  return woken;
+}
+
+void wake_waiter(struct wait_reason *reason) {
+  wake_process(end_wait(reason));
+}
+
+void wake_waiter_handoff(struct wait_reason *reason) {
+  wake_process_handoff(end_wait(reason));
+}
+
+void remove_waiter(struct wait_reason *reason) {
+  unlink_entry(&reason->queue_entry);
+  cancel_timer(&reason->queue_entry.timeout);
+}
+
+void free_wait(struct wait_reason *reason) {
+  while (reason) {
+    struct wait_reason *chained = reason->chained;
+    remove_waiter(reason);
+    kfree(reason);
+    reason = chained;
+  }
+}
+
+} // namespace proc
@@ -0,0 +1,79 @@
+#ifndef PROC_WAIT_QUEUE_H
+#define PROC_WAIT_QUEUE_H
+
+#include <stdint.h>
+
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+
+namespace proc {
+
+namespace {
+
+using lib::std::time;
+using lib::std::timer;
+
+} // namespace
+
+struct process;
+struct wait_reason;
+struct wait_queue;
+
+// Links a blocked process into whatever it's waiting on. Lives inside the
+// process's wait_reason, so it goes away when the wait does.
+struct wait_queue_entry {
+  struct process *waiter;
+  struct wait_queue *queue; // nullptr if it's not on one
+  struct timer timeout;
+  struct wait_queue_entry *next;
+  struct wait_queue_entry *prev;
+};
+
+// Processes blocked on the same event, oldest first. Waking only ever looks
+// at the queue for the event that happened.
+struct wait_queue {
+  struct wait_queue_entry *head;
+  struct wait_queue_entry *tail;
+};
+
+void init_wait_queue(struct wait_queue *queue);
+
+// Fills in the parts of a freshly allocated wait_reason every wait needs
+void init_wait_reason(struct wait_reason *reason, uint32_t type,
+                      struct process *waiter);
+
+// Blocks the waiter until it's woken. queue may be nullptr for waits that only
+// ever end through wake_waiter, like a vfork parent. The reason becomes the
+// waiter's wait and is freed when it's woken.
+void wait_on(struct wait_queue *queue, struct wait_reason *reason);
+
+// Same as wait_on, but wakes the waiter at deadline if nothing else has
+void wait_on_timeout(struct wait_queue *queue, struct wait_reason *reason,
+                     const struct time &deadline);
+
+// Returns the longest waiting reason without waking it, or nullptr
+struct wait_reason *first_waiter(struct wait_queue *queue);
+
+// Wakes the longest waiting process. Returns 0 if nobody was waiting.
+char wake_one(struct wait_queue *queue);
+
+// Wakes everybody on the queue and returns how many there were
+uint32_t wake_all(struct wait_queue *queue);
+
+// Ends a particular wait, frees it and wakes its process
+void wake_waiter(struct wait_reason *reason);
+
+// Same as wake_waiter, but hands the CPU to the woken process if that's fair
+void wake_waiter_handoff(struct wait_reason *reason);
+
+// Takes a wait off its queue and disarms its timeout without waking anyone.
+// For waits that are going away with their process.
+void remove_waiter(struct wait_reason *reason);
+
+// Takes a wait and everything chained behind it off their queues and frees
+// them, without waking anyone
+void free_wait(struct wait_reason *reason);
+
+} // namespace proc
+
+#endif
@@ -0,0 +1,128 @@
+#include "proc/workqueue.h"
+#include "lib/std/memory.h"
+#include "lib/std/time.h"
+#include "lib/std/timer.h"
+#include "proc/kthread.h"
+#include "proc/process.h"
+#include "proc/wait_queue.h"
+
+namespace proc {
+
+namespace {
+
+using lib::std::add_time;
+using lib::std::add_timer;
+using lib::std::init_timer;
+using lib::std::kmalloc;
+using lib::std::system_time;
+using lib::std::update_system_time;
+
+struct workqueue system_workqueue = {nullptr, nullptr, {nullptr, nullptr},
+                                     nullptr};
+
+void worker_thread(void *data) {
+  struct workqueue *queue = (struct workqueue *)data;
+  while (1) {
+    struct work *to_run = queue->head;
+    if (!to_run) {
+      struct wait_reason *wait =
+          (struct wait_reason *)kmalloc(sizeof(struct wait_reason));
+      init_wait_reason(wait, WORK_WAIT, queue->worker);
+      wait_on(&queue->idle_worker, wait);
+      schedule();
+      continue;
+    }
+
+    queue->head = to_run->next;
+    if (!queue->head) {
+      queue->tail = nullptr;
+    }
+
+    // Cleared first so the work can queue itself again
+    to_run->pending = 0;
+    to_run->func(to_run->data);
+
+    cond_resched();
+  }
+}
+
+void delayed_work_timer(void *data) {
+  struct delayed_work *delayed = (struct delayed_work *)data;
+  delayed->work.pending = 0;
+  queue_work(delayed->queue, &delayed->work);
+}
+
+} // namespace
+
+void init_work(struct work *to_init, void (*func)(void *data), void *data) {
+  to_init->func = func;
+  to_init->data = data;
+  to_init->pending = 0;
+  to_init->next = nullptr;
+}
+
+void init_delayed_work(struct delayed_work *to_init, void (*func)(void *data),
+                       void *data) {
+  init_work(&to_init->work, func, data);
+  init_timer(&to_init->delay_timer, delayed_work_timer, to_init);
+  to_init->queue = nullptr;
+}
+
+struct workqueue *create_workqueue(const char *name) {
+  struct workqueue *queue =
+      (struct workqueue *)kmalloc(sizeof(struct workqueue));
+  queue->head = nullptr;
+  queue->tail = nullptr;
+  init_wait_queue(&queue->idle_worker);
+  queue->worker = spawn_kernel_thread(name, worker_thread, queue);
+  return queue;
+}
+
+char queue_work(struct workqueue *queue, struct work *to_queue) {
+  if (to_queue->pending) {
+    return 0;
+  }
+
+  to_queue->pending = 1;
+  to_queue->next = nullptr;
+  if (queue->tail) {
+    queue->tail->next = to_queue;
+  } else {
+    queue->head = to_queue;
+  }
+  queue->tail = to_queue;
+
+  wake_one(&queue->idle_worker);
+  return 1;
+}
+
+char queue_delayed_work(struct workqueue *queue, struct delayed_work *to_queue,
+                        const struct time &delay) {
+  // pending covers the time on the timer too
+  if (to_queue->work.pending) {
+    return 0;
+  }
+
+  to_queue->work.pending = 1;
+  to_queue->queue = queue;
+  update_system_time();
+  to_queue->delay_timer.expires = add_time(system_time, delay);
+  add_timer(&to_queue->delay_timer);
+  return 1;
+}
+
+char schedule_work(struct work *to_schedule) {
+  return queue_work(&system_workqueue, to_schedule);
+}
+
+char schedule_delayed_work(struct delayed_work *to_schedule,
+                           const struct time &delay) {
+  return queue_delayed_work(&system_workqueue, to_schedule, delay);
+}
+
+void init_workqueues(void) {
+  system_workqueue.worker =
+      spawn_kernel_thread("kworker", worker_thread, &system_workqueue);
+}
+
+} // namespace proc
@@ -0,0 +1,74 @@
+#ifndef PROC_WORKQUEUE_H
+#define PROC_WORKQUEUE_H
+
+#include <stdint.h>
+
+#include "lib/std/timer.h"
+#include "proc/process.h"
+
+namespace proc {
+
+namespace {
+
+using lib::std::time;
+using lib::std::timer;
+
+} // namespace
+
+constexpr uint32_t WORK_WAIT = 0x7;
+
+// A function to run later from a kernel thread, outside of whatever interrupt
+// or syscall queued it. Callers own the work and must keep it alive until it's
+// run.
+struct work {
+  void (*func)(void *data);
+  void *data;
+
+  // Managed by the work queue code
+  char pending;
+  struct work *next;
+};
+
+// Work that's queued once a timer goes off
+struct delayed_work {
+  struct work work;
+  struct timer delay_timer;
+  struct workqueue *queue;
+};
+
+// Work items run one at a time, in order, on the queue's worker thread
+struct workqueue {
+  struct work *head;
+  struct work *tail;
+  struct wait_queue idle_worker;
+  struct process *worker;
+};
+
+void init_work(struct work *to_init, void (*func)(void *data), void *data);
+
+void init_delayed_work(struct delayed_work *to_init, void (*func)(void *data),
+                       void *data);
+
+// Starts a worker thread for a new queue
+struct workqueue *create_workqueue(const char *name);
+
+// Returns 0 if the work was already queued
+char queue_work(struct workqueue *queue, struct work *to_queue);
+
+// Queues work once delay has passed. Returns 0 if it was already waiting.
+char queue_delayed_work(struct workqueue *queue, struct delayed_work *to_queue,
+                        const struct time &delay);
+
+// Same as queue_work, on the shared system queue
+char schedule_work(struct work *to_schedule);
+
+char schedule_delayed_work(struct delayed_work *to_schedule,
+                           const struct time &delay);
+
+// Starts the system queue's worker. Work can be queued before this, it just
+// won't run until after.
+void init_workqueues(void);
+
+} // namespace proc
+
+#endif
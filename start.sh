@@ -1,2 +1,2 @@
 #!/bin/bash
-qemu-system-i386 -s -cpu SandyBridge -drive file=test_disk.img -kernel moonshine.bin
+qemu-system-i386 -s -cpu SandyBridge -smp 4 -drive file=test_disk.img -kernel moonshine.bin
@@ -0,0 +1,66 @@
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Measures the cost of getting in and out of the kernel and between processes.
+// getppid comes straight back to the same process, sched_yield goes through
+// the scheduler and back to the same process when nothing else wants to run,
+// and a pipe ping pong switches to another process and back every round trip.
+
+constexpr int ITERATIONS = 100000;
+
+uint64_t now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void report(const char *name, uint64_t start, int iterations) {
+  uint64_t elapsed = now() - start;
+  printf("%s: %llu ns\n", name, (unsigned long long)(elapsed / iterations));
+}
+
+int main(void) {
+  uint64_t start = now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    // Not getpid, which the vDSO answers without a syscall
+    syscall(SYS_getppid);
+  }
+  report("syscall", start, ITERATIONS);
+
+  start = now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    sched_yield();
+  }
+  report("yield to self", start, ITERATIONS);
+
+  int ping[2];
+  int pong[2];
+  pipe(ping);
+  pipe(pong);
+
+  char byte = 0;
+  pid_t child = fork();
+  if (!child) {
+    for (int i = 0; i < ITERATIONS; i++) {
+      read(ping[0], &byte, 1);
+      write(pong[1], &byte, 1);
+    }
+    _exit(0);
+  }
+
+  start = now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    write(ping[1], &byte, 1);
+    read(pong[0], &byte, 1);
+  }
+  // Two switches per round trip
+  report("process switch", start, ITERATIONS * 2);
+
+  waitpid(child, nullptr, 0);
+  return 0;
+}
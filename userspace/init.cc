@@ -9,10 +9,11 @@ int main(void) {
 
   pipe(pipefd);
 
-  if (!fork()) {
+  if (!vfork()) {
     dup2(pipefd[0], fileno(stdin));
     char *argv[2] = {"test.exe", nullptr};
     execv("test.exe", argv);
+    _exit(1);
   } else {
     while (1) {
       char *message = "Hello from child!\n";
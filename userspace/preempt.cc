@@ -0,0 +1,125 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Checks that the scheduler preempts. Two processes spin on the CPU at once,
+// which only gets both of them anywhere if ticks take the CPU away, while a
+// third writes and reads back a big file, which should give up the CPU between
+// clusters rather than hold it for the whole transfer. Exits 1 on failure.
+
+constexpr int SPINNERS = 2;
+constexpr uint64_t SPIN_NANOS = 2000000000;
+constexpr int FILE_SIZE = 0x100000;
+
+uint64_t now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Returns the number after name in /proc/sched_latency, or -1
+long read_stat(const char *name) {
+  char buf[256];
+  int fd = open("/proc/sched_latency", O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  int len = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (len <= 0) {
+    return -1;
+  }
+  buf[len] = 0;
+
+  char *found = strstr(buf, name);
+  if (!found) {
+    return -1;
+  }
+  return strtol(found + strlen(name) + 1, nullptr, 10);
+}
+
+// Counts loop iterations until the deadline and reports them in the exit
+// status, as 0 if it never got past the first check
+void spin(void) {
+  uint64_t deadline = now() + SPIN_NANOS;
+  uint64_t iterations = 0;
+  while (now() < deadline) {
+    iterations++;
+  }
+  _exit(iterations > 1000 ? 0 : 1);
+}
+
+// Writes and reads back a file big enough to take many clusters
+void copy_file(void) {
+  char *buf = (char *)malloc(FILE_SIZE);
+  for (int i = 0; i < FILE_SIZE; i++) {
+    buf[i] = (char)i;
+  }
+
+  int fd = open("/preempt.tmp", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || write(fd, buf, FILE_SIZE) != FILE_SIZE) {
+    _exit(1);
+  }
+  close(fd);
+
+  memset(buf, 0, FILE_SIZE);
+  fd = open("/preempt.tmp", O_RDONLY);
+  if (fd < 0 || read(fd, buf, FILE_SIZE) != FILE_SIZE) {
+    _exit(1);
+  }
+  close(fd);
+  unlink("/preempt.tmp");
+
+  for (int i = 0; i < FILE_SIZE; i++) {
+    if (buf[i] != (char)i) {
+      _exit(1);
+    }
+  }
+  _exit(0);
+}
+
+int main(void) {
+  long reschedules_before = read_stat("reschedules");
+  if (reschedules_before < 0) {
+    printf("FAIL: can't read /proc/sched_latency\n");
+    return 1;
+  }
+
+  pid_t children[SPINNERS + 1];
+  for (int i = 0; i < SPINNERS; i++) {
+    children[i] = fork();
+    if (!children[i]) {
+      spin();
+    }
+  }
+  children[SPINNERS] = fork();
+  if (!children[SPINNERS]) {
+    copy_file();
+  }
+
+  int failed = 0;
+  for (int i = 0; i <= SPINNERS; i++) {
+    int status;
+    waitpid(children[i], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+      printf("FAIL: child %d\n", i);
+      failed = 1;
+    }
+  }
+
+  long reschedules = read_stat("reschedules") - reschedules_before;
+  long max_latency = read_stat("max_latency");
+  printf("reschedules %ld max_latency %ld ns\n", reschedules, max_latency);
+  if (reschedules <= 0) {
+    printf("FAIL: nothing was preempted\n");
+    failed = 1;
+  }
+
+  printf(failed ? "FAIL\n" : "PASS\n");
+  return failed;
+}